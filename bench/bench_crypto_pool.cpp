@@ -0,0 +1,111 @@
+// Custom1 0x501 login decrypt throughput. The baseline is the old per-login
+// path: load the PEM, build a context, decrypt. Then one "I/O thread" feeds
+// CryptoPools of growing size in batches, the way workers do, and counts
+// completed decrypts.
+//
+// Usage: bench_crypto_pool [seconds=2] [max_threads=hardware threads]
+#include "crypto_pool.hpp"
+#include "custom1_handlers.hpp"
+#include "logger.hpp"
+#include <openssl/rsa.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Jobs the feeder keeps in flight, and how many it hands over per flush
+#define BENCH_IN_FLIGHT 512
+#define BENCH_BATCH 32
+
+std::vector<unsigned char> encrypt_to(EVP_PKEY* key, const char* plain, size_t len) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    EVP_PKEY_encrypt_init(ctx);
+    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
+    size_t outlen = 0;
+    EVP_PKEY_encrypt(ctx, nullptr, &outlen, reinterpret_cast<const unsigned char*>(plain), len);
+    std::vector<unsigned char> out(outlen);
+    EVP_PKEY_encrypt(ctx, out.data(), &outlen, reinterpret_cast<const unsigned char*>(plain), len);
+    out.resize(outlen);
+    EVP_PKEY_CTX_free(ctx);
+    return out;
+}
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Decrypts per second the way handle_custom1_login used to: everything per call
+double run_baseline(const std::vector<unsigned char>& blob, int seconds) {
+    long done = 0;
+    auto start = Clock::now();
+    std::vector<unsigned char> out;
+    while (seconds_since(start) < seconds) {
+        EVP_PKEY* key = load_private_key(CUSTOM1_PRIVATE_KEY_PATH, nullptr);
+        if (key && rsa_oaep_decrypt(key, blob, out, nullptr)) ++done;
+        EVP_PKEY_free(key);
+    }
+    return done / seconds_since(start);
+}
+
+// Decrypts per second through a pool of `threads`
+double run_pool(KeyManager& keys, const std::vector<unsigned char>& blob, int threads, int seconds) {
+    CryptoPool pool(keys, threads, BENCH_IN_FLIGHT);
+    std::atomic<long> done{0};
+    std::atomic<long> failed{0};
+    auto callback = [&](bool ok, std::vector<unsigned char>&, const std::string&) {
+        (ok ? done : failed).fetch_add(1, std::memory_order_relaxed);
+    };
+    long submitted = 0;
+    auto start = Clock::now();
+    while (seconds_since(start) < seconds) {
+        long in_flight = submitted - done.load(std::memory_order_relaxed) - failed.load(std::memory_order_relaxed);
+        if (in_flight + BENCH_BATCH > BENCH_IN_FLIGHT) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (int i = 0; i < BENCH_BATCH; ++i) pool.queue(CryptoPool::Job{blob, callback});
+        CryptoPool::flush_pending();
+        submitted += BENCH_BATCH;
+    }
+    double elapsed = seconds_since(start);
+    if (failed.load() > 0) std::fprintf(stderr, "%ld decrypts failed\n", failed.load());
+    return done.load() / elapsed;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 2;
+    int max_threads = argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (seconds <= 0) seconds = 2;
+    if (max_threads <= 0) max_threads = 1;
+    // Keep key-load logging out of the measurement
+    Logger::set_destination(LogDest::FILE, "/dev/null");
+
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    auto set = keys.keys();
+    if (set->keys.empty()) {
+        std::fprintf(stderr, "Cannot load %s\n", CUSTOM1_PRIVATE_KEY_PATH);
+        return 1;
+    }
+    // A session key record as the client sends it: length, key, expiry
+    const char record[] = "\x00\x20" "0123456789abcdef0123456789abcdef" "\x00\x00\x0e\x10";
+    std::vector<unsigned char> blob = encrypt_to(set->keys[0].get(), record, sizeof(record) - 1);
+
+    std::printf("%-16s %12s %10s\n", "path", "logins/sec", "speedup");
+    double baseline = run_baseline(blob, seconds);
+    std::printf("%-16s %12.0f %9.2fx\n", "per-call (old)", baseline, 1.0);
+    // Powers of two, then max_threads itself
+    std::vector<int> sizes;
+    for (int threads = 1; threads < max_threads; threads *= 2) sizes.push_back(threads);
+    sizes.push_back(max_threads);
+    for (int threads : sizes) {
+        double rate = run_pool(keys, blob, threads, seconds);
+        std::printf("pool %-11d %12.0f %9.2fx\n", threads, rate, rate / baseline);
+    }
+    return 0;
+}
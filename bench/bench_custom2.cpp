@@ -0,0 +1,198 @@
+// Custom2 small-message throughput on persistent connections, for the epoll
+// and io_uring worker backends. Every connection keeps `depth` pings in
+// flight and sends a new one for each reply, so with depth > 1 each read
+// the server does holds several frames whose replies go out together.
+//
+// Usage: bench_custom2 [seconds=3] [connections=256] [depth=4] [payload=16] [threads=2]
+#include "Server.hpp"
+#include "custom2_protocol.hpp"
+#include "epoll_worker.hpp"
+#include "uring_worker.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+struct BenchConfig {
+    int seconds = 3;
+    int connections = 256;
+    int depth = 4;
+    int payload = 16;
+    int threads = 2;
+};
+
+int connect_once(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+struct Totals {
+    std::atomic<long> replies{0};
+    std::atomic<long> failed{0};
+};
+
+// One client thread: an epoll loop over its share of the connections
+void run_thread(uint16_t port, int connections, const BenchConfig& config, const std::atomic<bool>& stop,
+                Totals& totals) {
+    std::string ping;
+    custom2_append_frame(ping, CUSTOM2_PING, 0, std::string(config.payload, 'x'));
+    // Replies echo the payload, so they are the size of the ping
+    const size_t reply_size = ping.size();
+    std::string burst;
+    for (int i = 0; i < config.depth; ++i) burst += ping;
+
+    int ep = epoll_create1(0);
+    std::vector<int> fds;
+    // Bytes of a reply cut off at the end of the last read, per connection
+    std::vector<size_t> partial;
+    for (int i = 0; i < connections; ++i) {
+        int fd = connect_once(port);
+        if (fd < 0 || send(fd, burst.data(), burst.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(burst.size())) {
+            if (fd >= 0) close(fd);
+            totals.failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(fds.size());
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        fds.push_back(fd);
+        partial.push_back(0);
+    }
+
+    long replies = 0;
+    char buf[16384];
+    std::string next;
+    epoll_event events[64];
+    while (!stop.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(ep, events, 64, 50);
+        for (int e = 0; e < n; ++e) {
+            uint32_t i = events[e].data.u32;
+            ssize_t got = recv(fds[i], buf, sizeof(buf), 0);
+            if (got <= 0) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, fds[i], nullptr);
+                totals.failed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            size_t bytes = partial[i] + static_cast<size_t>(got);
+            size_t done = bytes / reply_size;
+            partial[i] = bytes % reply_size;
+            replies += static_cast<long>(done);
+            // One new ping per reply, sent together
+            next.clear();
+            for (size_t r = 0; r < done; ++r) next += ping;
+            if (!next.empty() && send(fds[i], next.data(), next.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(next.size())) {
+                epoll_ctl(ep, EPOLL_CTL_DEL, fds[i], nullptr);
+                totals.failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    totals.replies.fetch_add(replies, std::memory_order_relaxed);
+    for (int fd : fds) close(fd);
+    close(ep);
+}
+
+// Runs the client load for config.seconds and returns the replies received
+long run_clients(uint16_t port, const BenchConfig& config, long* failed) {
+    Totals totals;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < config.threads; ++t) {
+        int share = config.connections / config.threads + (t < config.connections % config.threads ? 1 : 0);
+        threads.emplace_back(run_thread, port, share, std::cref(config), std::cref(stop), std::ref(totals));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(config.seconds));
+    stop = true;
+    for (auto& t : threads) t.join();
+    *failed = totals.failed.load();
+    return totals.replies.load();
+}
+
+// Forks a server child running one worker of the given backend on an ephemeral port
+pid_t start_server(bool use_uring, uint16_t& port) {
+    Server server;
+    int listener = server.create_listener(0);
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    getsockname(listener, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    pid_t pid = fork();
+    if (pid == 0) {
+        Logger::set_destination(LogDest::FILE, "/dev/null");
+        signal(SIGPIPE, SIG_IGN);
+        std::unique_ptr<Worker> worker;
+        if (use_uring) {
+            auto uring = std::make_unique<UringWorker>(0, -1);
+            if (!uring->init()) _exit(2);
+            worker = std::move(uring);
+        } else {
+            worker = std::make_unique<EpollWorker>(0, -1);
+        }
+        worker->add_listener(listener, Protocol::CUSTOM2);
+        worker->run();
+        _exit(0);
+    }
+    close(listener);
+    return pid;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (argc > 1) config.seconds = atoi(argv[1]);
+    if (argc > 2) config.connections = atoi(argv[2]);
+    if (argc > 3) config.depth = atoi(argv[3]);
+    if (argc > 4) config.payload = atoi(argv[4]);
+    if (argc > 5) config.threads = atoi(argv[5]);
+    if (config.seconds <= 0 || config.connections <= 0 || config.depth <= 0 || config.payload < 0 ||
+        config.payload > 0xFFFF || config.threads <= 0) {
+        fprintf(stderr, "Usage: bench_custom2 [seconds=3] [connections=256] [depth=4] [payload=16] [threads=2]\n");
+        return 2;
+    }
+    printf("%d connections, %d pings in flight each, %d-byte payloads, %d client threads\n", config.connections,
+           config.depth, config.payload, config.threads);
+    printf("%-10s %12s %12s %8s\n", "backend", "replies", "replies/s", "failed");
+    for (bool use_uring : {false, true}) {
+        const char* name = use_uring ? "io_uring" : "epoll";
+        if (use_uring && !UringWorker::supported()) {
+            printf("%-10s %12s %12s %8s\n", name, "-", "unsupported", "-");
+            continue;
+        }
+        uint16_t port = 0;
+        pid_t pid = start_server(use_uring, port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        long failed = 0;
+        long replies = run_clients(port, config, &failed);
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        printf("%-10s %12ld %12.0f %8ld\n", name, replies, static_cast<double>(replies) / config.seconds, failed);
+    }
+    return 0;
+}
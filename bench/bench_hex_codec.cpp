@@ -0,0 +1,112 @@
+// Hex codec microbenchmarks at the sizes the server uses: Field2 decode
+// (256 digits), session key and session ID encode (32 bytes), and the
+// receive log line for a login frame (~300 bytes). Each line compares the
+// helper the call site used before with every codec this CPU can run.
+//
+// Usage: bench_hex_codec [iterations=200000]
+#include "hex_codec.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimiser from dropping a result
+volatile size_t sink;
+
+template <typename Fn>
+double ns_per_op(long iterations, Fn fn) {
+    auto start = Clock::now();
+    for (long i = 0; i < iterations; ++i) fn();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+// The per-byte std::stoi that hex_to_bin used
+bool legacy_decode(const std::string& hex, std::vector<unsigned char>& out) {
+    out.clear();
+    out.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        if (!isxdigit(hex[i]) || !isxdigit(hex[i + 1])) return false;
+        out.push_back(static_cast<unsigned char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return true;
+}
+
+// The snprintf loop the session key and packet log used
+std::string legacy_snprintf(const std::vector<uint8_t>& bytes) {
+    std::string out;
+    for (uint8_t b : bytes) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", b);
+        out += hex;
+    }
+    return out;
+}
+
+// The stringstream the session ID used
+std::string legacy_stream(const std::vector<uint8_t>& bytes) {
+    std::stringstream ss;
+    for (uint8_t b : bytes) ss << std::hex << std::setw(2) << std::setfill('0') << (int)b;
+    return ss.str();
+}
+
+std::vector<uint8_t> pattern(size_t n) {
+    std::vector<uint8_t> bytes(n);
+    for (size_t i = 0; i < n; ++i) bytes[i] = static_cast<uint8_t>(i * 131 + 7);
+    return bytes;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+    if (iterations <= 0) iterations = 200000;
+
+    std::vector<uint8_t> field2 = pattern(128);
+    std::string field2_hex = hex_encode(std::string_view(reinterpret_cast<const char*>(field2.data()), field2.size()));
+    std::vector<uint8_t> key = pattern(32);
+    std::vector<uint8_t> frame = pattern(300);
+    std::vector<HexImpl> impls;
+    for (HexImpl impl : {HexImpl::SCALAR, HexImpl::SSE2, HexImpl::AVX2}) {
+        if (hex_set_impl(impl)) impls.push_back(impl);
+    }
+
+    std::printf("%-28s %10s\n", "case", "ns/op");
+    std::vector<unsigned char> decoded;
+    std::printf("%-28s %10.1f\n", "field2 decode: stoi", ns_per_op(iterations, [&] {
+        legacy_decode(field2_hex, decoded);
+        sink = decoded.size();
+    }));
+    uint8_t out[300];
+    for (HexImpl impl : impls) {
+        hex_set_impl(impl);
+        std::printf("field2 decode: %-13s %10.1f\n", hex_impl_name(impl), ns_per_op(iterations, [&] {
+            sink = hex_decode(field2_hex.data(), field2.size(), out);
+        }));
+    }
+
+    std::printf("%-28s %10.1f\n", "session key: snprintf", ns_per_op(iterations, [&] { sink = legacy_snprintf(key).size(); }));
+    std::printf("%-28s %10.1f\n", "session ID: stringstream", ns_per_op(iterations, [&] { sink = legacy_stream(key).size(); }));
+    char text[600];
+    for (HexImpl impl : impls) {
+        hex_set_impl(impl);
+        std::printf("32-byte encode: %-12s %10.1f\n", hex_impl_name(impl), ns_per_op(iterations, [&] {
+            hex_encode(key.data(), key.size(), text);
+            sink = static_cast<size_t>(text[0]);
+        }));
+    }
+
+    std::printf("%-28s %10.1f\n", "frame log: snprintf", ns_per_op(iterations, [&] { sink = legacy_snprintf(frame).size(); }));
+    for (HexImpl impl : impls) {
+        hex_set_impl(impl);
+        std::printf("frame log: %-17s %10.1f\n", hex_impl_name(impl), ns_per_op(iterations, [&] {
+            hex_encode(frame.data(), frame.size(), text);
+            sink = static_cast<size_t>(text[0]);
+        }));
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Compares the epoll and io_uring worker backends on connection churn:
+// each client connects, sends one CUSTOM2 ping, reads the reply, closes,
+// and reconnects.
+//
+// Usage: bench_io_backend [seconds=3] [clients=8]
+#include "Server.hpp"
+#include "custom2_protocol.hpp"
+#include "epoll_worker.hpp"
+#include "uring_worker.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+int connect_once(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Runs the client load for `seconds` and returns completed request/response cycles
+long run_clients(uint16_t port, int clients, int seconds) {
+    std::atomic<long> done{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&] {
+            std::string ping;
+            custom2_append_frame(ping, CUSTOM2_PING, 0, "ping");
+            char buf[256];
+            while (!stop.load(std::memory_order_relaxed)) {
+                int fd = connect_once(port);
+                if (fd < 0) continue;
+                if (send(fd, ping.data(), ping.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(ping.size())) {
+                    // The reply is the same size as the ping
+                    size_t got = 0;
+                    ssize_t n;
+                    while (got < ping.size() && (n = recv(fd, buf, sizeof(buf), 0)) > 0) got += n;
+                    if (got == ping.size()) done.fetch_add(1, std::memory_order_relaxed);
+                }
+                close(fd);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : threads) t.join();
+    return done.load();
+}
+
+// Forks a server child running one worker of the given backend on an ephemeral port
+pid_t start_server(bool use_uring, uint16_t& port) {
+    Server server;
+    int listener = server.create_listener(0);
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    getsockname(listener, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    pid_t pid = fork();
+    if (pid == 0) {
+        Logger::set_destination(LogDest::FILE, "/dev/null");
+        signal(SIGPIPE, SIG_IGN);
+        std::unique_ptr<Worker> worker;
+        if (use_uring) {
+            auto uring = std::make_unique<UringWorker>(0, -1);
+            if (!uring->init()) _exit(2);
+            worker = std::move(uring);
+        } else {
+            worker = std::make_unique<EpollWorker>(0, -1);
+        }
+        worker->add_listener(listener, Protocol::CUSTOM2);
+        worker->run();
+        _exit(0);
+    }
+    close(listener);
+    return pid;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    printf("%-10s %12s %12s\n", "backend", "requests", "req/s");
+    for (bool use_uring : {false, true}) {
+        const char* name = use_uring ? "io_uring" : "epoll";
+        if (use_uring && !UringWorker::supported()) {
+            printf("%-10s %12s %12s\n", name, "-", "unsupported");
+            continue;
+        }
+        uint16_t port = 0;
+        pid_t pid = start_server(use_uring, port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        long done = run_clients(port, clients, seconds);
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        printf("%-10s %12ld %12.0f\n", name, done, static_cast<double>(done) / seconds);
+    }
+    return 0;
+}
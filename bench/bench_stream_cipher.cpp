@@ -0,0 +1,74 @@
+// Custom1 traffic cipher cost with many connections, each with its own
+// StreamCipher: frames go round-robin over the connections so key schedules
+// come from memory the way a busy worker's would. The baseline sets up a
+// cipher context for every frame instead of once per connection.
+//
+// Usage: bench_stream_cipher [frames=2000000]
+#include "stream_cipher.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimiser from dropping a result
+volatile uint8_t sink;
+
+double ns_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Per-frame setup: what a handler without a stored engine would do
+double per_frame_setup(const uint8_t* key, std::vector<uint8_t>& frame, long frames) {
+    auto start = Clock::now();
+    for (long i = 0; i < frames; ++i) {
+        StreamCipher cipher;
+        cipher.init(key, 32, nullptr);
+        cipher.decrypt(frame.data(), frame.size());
+    }
+    sink = frame[0];
+    return ns_since(start) / frames;
+}
+
+double per_connection(std::vector<std::unique_ptr<StreamCipher>>& conns, std::vector<uint8_t>& frame, long frames) {
+    auto start = Clock::now();
+    size_t next = 0;
+    for (long i = 0; i < frames; ++i) {
+        conns[next]->decrypt(frame.data(), frame.size());
+        if (++next == conns.size()) next = 0;
+    }
+    sink = frame[0];
+    return ns_since(start) / frames;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    long frames = argc > 1 ? std::atol(argv[1]) : 2000000;
+    if (frames <= 0) frames = 2000000;
+    uint8_t key[32];
+    for (int i = 0; i < 32; ++i) key[i] = static_cast<uint8_t>(i * 7 + 1);
+    std::printf("AES instructions: %s\n", StreamCipher::hardware_accelerated() ? "yes" : "no");
+    std::printf("%-26s %8s %10s %8s\n", "case", "bytes", "ns/frame", "GB/s");
+    for (size_t size : {64, 512, 4096}) {
+        std::vector<uint8_t> frame(size, 0x5a);
+        long n = frames / static_cast<long>(size / 64);
+        double ns = per_frame_setup(key, frame, n / 10);
+        std::printf("%-26s %8zu %10.1f %8.2f\n", "setup per frame", size, ns, size / ns);
+        for (size_t count : {1, 1000, 10000}) {
+            std::vector<std::unique_ptr<StreamCipher>> conns;
+            for (size_t c = 0; c < count; ++c) {
+                conns.push_back(std::make_unique<StreamCipher>());
+                key[0] = static_cast<uint8_t>(c);
+                conns.back()->init(key, sizeof(key), nullptr);
+            }
+            ns = per_connection(conns, frame, n);
+            std::string label = "stored, " + std::to_string(count) + " conns";
+            std::printf("%-26s %8zu %10.1f %8.2f\n", label.c_str(), size, ns, size / ns);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Compare an oxide_bench JSON run against a baseline.
+
+    compare_bench.py BASELINE RUN [--threshold 0.25]
+    compare_bench.py BASELINE RUN --update
+
+Both files are Google Benchmark JSON (--benchmark_out_format=json). When a
+run has repetitions, the median of each benchmark is compared; otherwise the
+single result is. Exits 1 if any benchmark in the baseline got slower by more
+than the threshold (a fraction: 0.25 = 25%), or is missing from the run
+(pass --allow-missing for a run made with --benchmark_filter).
+
+A benchmark whose repetitions vary a lot is given more room: the allowed
+slowdown is at least twice the larger coefficient of variation (the "cv"
+aggregate) of the two runs, so a noisy benchmark has to move well past its own
+jitter to fail.
+
+--update rewrites BASELINE from RUN, keeping only what the comparison reads.
+Timings depend on the machine, so refresh the baseline on the machine that
+runs the check.
+"""
+import argparse
+import json
+import sys
+
+NS_PER_UNIT = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def times(doc):
+    """name -> real time in ns, preferring medians of repeated runs"""
+    entries = doc.get("benchmarks", [])
+    medians = {}
+    singles = {}
+    for entry in entries:
+        if entry.get("error_occurred"):
+            continue
+        ns = entry["real_time"] * NS_PER_UNIT[entry.get("time_unit", "ns")]
+        if entry.get("run_type") == "aggregate":
+            if entry.get("aggregate_name") == "median":
+                medians[entry["run_name"]] = ns
+        else:
+            # Repetitions repeat the name; the median covers them
+            singles.setdefault(entry.get("run_name", entry["name"]), ns)
+    return medians if medians else singles
+
+
+def spreads(doc):
+    """name -> coefficient of variation across repetitions, where known"""
+    result = {}
+    for entry in doc.get("benchmarks", []):
+        if entry.get("run_type") == "aggregate" and entry.get("aggregate_name") == "cv":
+            result[entry["run_name"]] = entry["real_time"]
+        elif "cv" in entry:
+            # A baseline written by --update carries it on the entry
+            result[entry.get("run_name", entry["name"])] = entry["cv"]
+    return result
+
+
+def update(baseline_path, run):
+    cvs = spreads(run)
+    benchmarks = []
+    for name, ns in sorted(times(run).items()):
+        entry = {"name": name, "run_name": name, "run_type": "iteration", "real_time": round(ns, 3), "time_unit": "ns"}
+        if name in cvs:
+            entry["cv"] = round(cvs[name], 4)
+        benchmarks.append(entry)
+    reduced = {
+        "context": {key: run.get("context", {}).get(key) for key in ("num_cpus", "mhz_per_cpu")},
+        "benchmarks": benchmarks,
+    }
+    with open(baseline_path, "w") as f:
+        json.dump(reduced, f, indent=2)
+        f.write("\n")
+    print(f"wrote {len(reduced['benchmarks'])} benchmarks to {baseline_path}")
+
+
+def compare(baseline, run, threshold, allow_missing):
+    base = times(baseline)
+    current = times(run)
+    base_cv = spreads(baseline)
+    current_cv = spreads(run)
+    failures = 0
+    width = max((len(name) for name in base), default=10)
+    print(f"{'benchmark':<{width}} {'baseline':>12} {'current':>12} {'change':>8} {'allowed':>8}")
+    for name, base_ns in sorted(base.items()):
+        if name not in current:
+            if not allow_missing:
+                print(f"{name:<{width}} {base_ns:>10.1f}ns {'missing':>12}          FAIL")
+                failures += 1
+            continue
+        ns = current[name]
+        change = ns / base_ns - 1.0
+        allowed = max(threshold, 2.0 * max(base_cv.get(name, 0.0), current_cv.get(name, 0.0)))
+        verdict = "FAIL" if change > allowed else ""
+        if verdict:
+            failures += 1
+        print(f"{name:<{width}} {base_ns:>10.1f}ns {ns:>10.1f}ns {change:>+7.1%} {allowed:>7.0%} {verdict}")
+    for name in sorted(set(current) - set(base)):
+        print(f"{name:<{width}} {'new':>12} {current[name]:>10.1f}ns")
+    if failures:
+        print(f"{failures} benchmark(s) regressed beyond their allowance")
+        return 1
+    print(f"no regressions beyond {threshold:.0%}")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("run")
+    parser.add_argument("--threshold", type=float, default=0.25, help="allowed slowdown as a fraction (default 0.25)")
+    parser.add_argument("--allow-missing", action="store_true", help="skip baseline entries the run doesn't have")
+    parser.add_argument("--update", action="store_true", help="write RUN to BASELINE instead of comparing")
+    args = parser.parse_args()
+    run = load(args.run)
+    if args.update:
+        update(args.baseline, run)
+        return 0
+    return compare(load(args.baseline), run, args.threshold, args.allow_missing)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
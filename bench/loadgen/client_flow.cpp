@@ -0,0 +1,496 @@
+#include "client_flow.hpp"
+#include "custom1_handlers.hpp"
+#include "custom1_packet.hpp"
+#include "hex_codec.hpp"
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+// Distinct Field2 values each thread encrypts up front and cycles through,
+// so client-side RSA doesn't cap the rate
+#define LOADGEN_FIELD2_POOL 16
+// Session key carried in Field2
+#define LOADGEN_SESSION_KEY_BYTES 32
+#define LOADGEN_MAX_EVENTS 256
+
+void LoadResult::add(const LoadResult& other) {
+    if (stages.size() < other.stages.size()) stages.resize(other.stages.size());
+    for (size_t i = 0; i < other.stages.size(); ++i) {
+        stages[i].latency_ns.add(other.stages[i].latency_ns);
+        stages[i].errors += other.stages[i].errors;
+    }
+    flows_done += other.flows_done;
+    flows_failed += other.flows_failed;
+    flows_unstarted += other.flows_unstarted;
+    seconds = std::max(seconds, other.seconds);
+}
+
+size_t load_stage_count(const LoadConfig& config) {
+    return STAGE_CUSTOM1_LOGIN + config.custom1_ports.size();
+}
+
+std::string load_stage_name(const LoadConfig& config, size_t stage) {
+    switch (stage) {
+    case STAGE_CONNECT: return "connect";
+    case STAGE_AUTH_LOGIN: return "AuthLogin";
+    case STAGE_SHARD_LIST: return "ShardList";
+    case STAGE_FLOW: return "flow";
+    default: return "0x501 :" + std::to_string(config.custom1_ports[stage - STAGE_CUSTOM1_LOGIN]);
+    }
+}
+
+namespace {
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A Field2 value: the session key's length, the key, and its expiry,
+// RSA-OAEP encrypted to the server's key and hex encoded
+bool make_field2(EVP_PKEY* key, std::string* hex, std::string* err) {
+    unsigned char plain[2 + LOADGEN_SESSION_KEY_BYTES + 4];
+    write_u16(plain, LOADGEN_SESSION_KEY_BYTES);
+    if (RAND_bytes(plain + 2, LOADGEN_SESSION_KEY_BYTES) != 1) {
+        *err = "RAND_bytes failed";
+        return false;
+    }
+    write_u32(plain + 2 + LOADGEN_SESSION_KEY_BYTES, static_cast<uint32_t>(time(nullptr) + 3600));
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    std::vector<unsigned char> out;
+    size_t len = 0;
+    bool ok = ctx && EVP_PKEY_encrypt_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) > 0 &&
+              EVP_PKEY_encrypt(ctx, nullptr, &len, plain, sizeof(plain)) > 0;
+    if (ok) {
+        out.resize(len);
+        ok = EVP_PKEY_encrypt(ctx, out.data(), &len, plain, sizeof(plain)) > 0;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        *err = "RSA-OAEP encryption to the server key failed";
+        return false;
+    }
+    *hex = hex_encode(std::string_view(reinterpret_cast<const char*>(out.data()), len));
+    return true;
+}
+
+// The 0x501 login for ticket
+std::string login_frame(std::string_view ticket, std::string_view field2) {
+    Custom1PacketView login;
+    login.message_id = 0x501;
+    login.version = 0x0101;
+    login.field1 = ticket;
+    login.field2 = field2;
+    login.field3 = "2176";
+    size_t size = login.packed_size();
+    login.packet_length = static_cast<uint16_t>(size);
+    login.packet_length_4 = static_cast<uint32_t>(size);
+    std::string out(size, '\0');
+    // A real CRC-32 trailer, so a server run with OXIDE_CUSTOM1_VERIFY_CRC
+    // takes it too
+    login.pack_into(reinterpret_cast<uint8_t*>(&out[0]), size, true);
+    return out;
+}
+
+// Whether buf starts with a whole response; if so sets its status and body
+bool parse_http_response(std::string_view buf, int* status, std::string_view* body) {
+    size_t head_end = buf.find("\r\n\r\n");
+    if (head_end == std::string_view::npos) return false;
+    std::string_view head = buf.substr(0, head_end);
+    size_t length = 0;
+    size_t line = head.find("\r\n");
+    while (line != std::string_view::npos) {
+        size_t next = head.find("\r\n", line + 2);
+        std::string_view header = head.substr(line + 2, next == std::string_view::npos ? std::string_view::npos : next - line - 2);
+        if (header.size() > 15 && strncasecmp(header.data(), "Content-Length:", 15) == 0) {
+            length = strtoul(std::string(header.substr(15)).c_str(), nullptr, 10);
+        }
+        line = next;
+    }
+    if (buf.size() < head_end + 4 + length) return false;
+    *status = head.size() > 12 && head.substr(0, 5) == "HTTP/" ? atoi(head.data() + 9) : 0;
+    *body = buf.substr(head_end + 4, length);
+    return true;
+}
+
+// The ticket from an AuthLogin body ("Valid=TRUE\nTicket=...\n"); empty if
+// the login failed
+std::string_view ticket_of(std::string_view body) {
+    if (body.substr(0, 10) != "Valid=TRUE") return std::string_view();
+    size_t start = body.find("Ticket=");
+    if (start == std::string_view::npos) return std::string_view();
+    start += 7;
+    size_t end = body.find('\n', start);
+    return body.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+}
+
+// Whether buf holds the whole reply to a 0x501; if so sets whether its
+// session key was stored
+bool parse_login_reply(std::string_view buf, bool* stored) {
+    std::string_view ok(CUSTOM1_REPLY_OK);
+    std::string_view failed(CUSTOM1_REPLY_LOGIN_FAILED);
+    if (buf.substr(0, ok.size()) == ok) {
+        *stored = true;
+        return true;
+    }
+    if (buf.substr(0, failed.size()) == failed) {
+        *stored = false;
+        return true;
+    }
+    return false;
+}
+
+// One event loop driving its share of the clients, each a state machine
+// over non-blocking sockets
+class LoadThread {
+public:
+    LoadThread(const LoadConfig& config, const sockaddr_in& http, const sockaddr_in& custom1,
+               std::vector<std::string> field2s, int index, uint64_t start_ns)
+        : config_(config), http_addr_(http), custom1_addr_(custom1), field2s_(std::move(field2s)),
+          result_(load_stage_count(config)) {
+        int threads = config.threads;
+        int slots = config.concurrency / threads + (index < config.concurrency % threads ? 1 : 0);
+        flows_.resize(std::max(slots, 1));
+        warm_ns_ = start_ns + static_cast<uint64_t>(config.warmup_s) * 1000000000ull;
+        end_ns_ = warm_ns_ + static_cast<uint64_t>(config.duration_s) * 1000000000ull;
+        // The threads' arrivals interleave rather than land together
+        interval_ns_ = static_cast<uint64_t>(1e9 * threads / config.rate);
+        next_arrival_ns_ = start_ns + interval_ns_ * index / threads;
+        next_user_ = index;
+        result_.seconds = config.duration_s;
+    }
+
+    ~LoadThread() {
+        if (epfd_ >= 0) close(epfd_);
+    }
+
+    bool run(std::string* err) {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0) {
+            *err = std::string("epoll_create1: ") + strerror(errno);
+            return false;
+        }
+        epoll_event events[LOADGEN_MAX_EVENTS];
+        while (true) {
+            uint64_t now = now_ns();
+            if (now >= end_ns_) break;
+            start_due(now);
+            expire(now);
+            // Wake for the next arrival; otherwise often enough to see timeouts
+            uint64_t wait_ns = 10000000;
+            if (config_.open_loop && next_arrival_ns_ > now) wait_ns = std::min(wait_ns, next_arrival_ns_ - now);
+            int n = epoll_wait(epfd_, events, LOADGEN_MAX_EVENTS, static_cast<int>((wait_ns + 999999) / 1000000));
+            for (int i = 0; i < n; ++i) on_event(flows_[events[i].data.u32], events[i].events);
+        }
+        // Flows still running are neither done nor failed
+        for (Flow& flow : flows_) close_fd(flow);
+        for (uint64_t due : due_) {
+            if (due >= warm_ns_) ++result_.flows_unstarted;
+        }
+        return true;
+    }
+
+    const LoadResult& result() const { return result_; }
+
+private:
+    enum class Step { IDLE, HTTP_CONNECTING, AUTH_LOGIN, SHARD_LIST, CUSTOM1_CONNECTING, CUSTOM1_LOGIN };
+
+    struct Flow {
+        Step step = Step::IDLE;
+        int fd = -1;
+        // When the flow was due, and when its current stage began
+        uint64_t due_ns = 0;
+        uint64_t stage_ns = 0;
+        uint64_t deadline_ns = 0;
+        // Due after the warmup, so counted
+        bool recorded = false;
+        size_t port = 0;
+        int user = 0;
+        const std::string* field2 = nullptr;
+        std::string out;
+        size_t sent = 0;
+        std::string in;
+        std::string ticket;
+    };
+
+    void start_due(uint64_t now) {
+        if (config_.open_loop) {
+            for (; next_arrival_ns_ <= now && next_arrival_ns_ < end_ns_; next_arrival_ns_ += interval_ns_) {
+                due_.push_back(next_arrival_ns_);
+            }
+        }
+        for (Flow& flow : flows_) {
+            if (flow.step != Step::IDLE) continue;
+            if (!config_.open_loop) {
+                start(flow, now, now);
+            } else if (!due_.empty()) {
+                start(flow, due_.front(), now);
+                due_.pop_front();
+            } else {
+                break;
+            }
+        }
+    }
+
+    void start(Flow& flow, uint64_t due, uint64_t now) {
+        flow.due_ns = due;
+        flow.recorded = due >= warm_ns_;
+        flow.user = next_user_ % config_.users;
+        next_user_ += config_.threads;
+        flow.field2 = &field2s_[next_field2_++ % field2s_.size()];
+        open(flow, http_addr_, Step::HTTP_CONNECTING, now);
+    }
+
+    void open(Flow& flow, sockaddr_in addr, Step step, uint64_t now) {
+        flow.step = step;
+        flow.stage_ns = now;
+        flow.deadline_ns = now + static_cast<uint64_t>(config_.timeout_ms) * 1000000ull;
+        flow.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (flow.fd < 0) {
+            fail(flow, STAGE_CONNECT);
+            return;
+        }
+        int one = 1;
+        setsockopt(flow.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (step == Step::CUSTOM1_CONNECTING) addr.sin_port = htons(config_.custom1_ports[flow.port]);
+        if (connect(flow.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            fail(flow, STAGE_CONNECT);
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = static_cast<uint32_t>(&flow - flows_.data());
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, flow.fd, &ev);
+    }
+
+    void on_event(Flow& flow, uint32_t events) {
+        if (flow.step == Step::IDLE) return;
+        uint64_t now = now_ns();
+        if (flow.step == Step::HTTP_CONNECTING || flow.step == Step::CUSTOM1_CONNECTING) {
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            getsockopt(flow.fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+            if (so_error != 0) {
+                fail(flow, STAGE_CONNECT);
+                return;
+            }
+            if (!(events & EPOLLOUT)) return;
+            record(flow, STAGE_CONNECT, now - flow.stage_ns);
+            if (flow.step == Step::HTTP_CONNECTING) {
+                begin(flow, Step::AUTH_LOGIN, "GET /AuthLogin?username=loadgen" + std::to_string(flow.user) +
+                      "&password=" + config_.password + " HTTP/1.1\r\nHost: " + config_.host + "\r\n\r\n", now);
+            } else {
+                begin(flow, Step::CUSTOM1_LOGIN, login_frame(flow.ticket, *flow.field2), now);
+            }
+            return;
+        }
+        if ((events & EPOLLOUT) && !flush(flow)) return;
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(flow, now);
+    }
+
+    // Sends a stage's request; the stage is timed from here, after connecting
+    void begin(Flow& flow, Step step, std::string request, uint64_t now) {
+        flow.step = step;
+        flow.stage_ns = now;
+        flow.deadline_ns = now + static_cast<uint64_t>(config_.timeout_ms) * 1000000ull;
+        flow.out = std::move(request);
+        flow.sent = 0;
+        flow.in.clear();
+        flush(flow);
+    }
+
+    bool flush(Flow& flow) {
+        while (flow.sent < flow.out.size()) {
+            ssize_t n = send(flow.fd, flow.out.data() + flow.sent, flow.out.size() - flow.sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                flow.sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            fail(flow, stage_of(flow));
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = flow.sent < flow.out.size() ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(&flow - flows_.data());
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, flow.fd, &ev);
+        return true;
+    }
+
+    void receive(Flow& flow, uint64_t now) {
+        char buf[16384];
+        bool closed = false;
+        while (true) {
+            ssize_t n = recv(flow.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                flow.in.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+        LoadStage stage = stage_of(flow);
+        int status = 0;
+        std::string_view body;
+        bool stored = false;
+        switch (flow.step) {
+        case Step::AUTH_LOGIN:
+            if (!parse_http_response(flow.in, &status, &body)) break;
+            flow.ticket = std::string(ticket_of(body));
+            if (status != 200 || flow.ticket.empty()) {
+                fail(flow, stage);
+                return;
+            }
+            record(flow, stage, now - flow.stage_ns);
+            begin(flow, Step::SHARD_LIST, "GET /ShardList/ HTTP/1.1\r\nHost: " + config_.host + "\r\n\r\n", now);
+            return;
+        case Step::SHARD_LIST:
+            if (!parse_http_response(flow.in, &status, &body)) break;
+            if (status != 200 || body.find('[') == std::string_view::npos) {
+                fail(flow, stage);
+                return;
+            }
+            record(flow, stage, now - flow.stage_ns);
+            close_fd(flow);
+            flow.port = 0;
+            open(flow, custom1_addr_, Step::CUSTOM1_CONNECTING, now);
+            return;
+        case Step::CUSTOM1_LOGIN:
+            if (!parse_login_reply(flow.in, &stored)) break;
+            if (!stored) {
+                fail(flow, stage);
+                return;
+            }
+            record(flow, stage, now - flow.stage_ns);
+            close_fd(flow);
+            if (++flow.port < config_.custom1_ports.size()) {
+                open(flow, custom1_addr_, Step::CUSTOM1_CONNECTING, now);
+            } else {
+                finish(flow, true, now);
+            }
+            return;
+        default:
+            break;
+        }
+        if (closed) fail(flow, stage);
+    }
+
+    LoadStage stage_of(const Flow& flow) const {
+        switch (flow.step) {
+        case Step::AUTH_LOGIN: return STAGE_AUTH_LOGIN;
+        case Step::SHARD_LIST: return STAGE_SHARD_LIST;
+        case Step::CUSTOM1_LOGIN: return static_cast<LoadStage>(STAGE_CUSTOM1_LOGIN + flow.port);
+        default: return STAGE_CONNECT;
+        }
+    }
+
+    void expire(uint64_t now) {
+        for (Flow& flow : flows_) {
+            if (flow.step != Step::IDLE && now >= flow.deadline_ns) fail(flow, stage_of(flow));
+        }
+    }
+
+    void record(const Flow& flow, LoadStage stage, uint64_t ns) {
+        if (flow.recorded) result_.stages[stage].latency_ns.record(ns);
+    }
+
+    void fail(Flow& flow, LoadStage stage) {
+        if (flow.recorded) ++result_.stages[stage].errors;
+        finish(flow, false, 0);
+    }
+
+    // The slot is free again; start_due() refills it
+    void finish(Flow& flow, bool ok, uint64_t now) {
+        close_fd(flow);
+        flow.step = Step::IDLE;
+        if (!flow.recorded) return;
+        if (ok) {
+            result_.stages[STAGE_FLOW].latency_ns.record(now - flow.due_ns);
+            ++result_.flows_done;
+        } else {
+            ++result_.flows_failed;
+        }
+    }
+
+    void close_fd(Flow& flow) {
+        if (flow.fd < 0) return;
+        // Closing drops it from the epoll set
+        close(flow.fd);
+        flow.fd = -1;
+    }
+
+    const LoadConfig& config_;
+    sockaddr_in http_addr_;
+    sockaddr_in custom1_addr_;
+    std::vector<std::string> field2s_;
+    LoadResult result_;
+    std::vector<Flow> flows_;
+    std::deque<uint64_t> due_;
+    int epfd_ = -1;
+    uint64_t warm_ns_ = 0;
+    uint64_t end_ns_ = 0;
+    uint64_t interval_ns_ = 0;
+    uint64_t next_arrival_ns_ = 0;
+    int next_user_ = 0;
+    size_t next_field2_ = 0;
+};
+} // namespace
+
+bool run_load(const LoadConfig& config, EVP_PKEY* server_key, LoadResult* result, std::string* err) {
+    if (config.threads < 1 || config.concurrency < config.threads || config.users < 1 ||
+        config.custom1_ports.empty() || (config.open_loop && config.rate <= 0)) {
+        *err = "need threads >= 1, concurrency >= threads, users >= 1, a Custom1 port, and a positive rate";
+        return false;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    if (inet_pton(AF_INET, config.host.c_str(), &addr.sin_addr) != 1) {
+        *err = "host must be an IPv4 address: " + config.host;
+        return false;
+    }
+    sockaddr_in http = addr;
+    http.sin_port = htons(config.http_port);
+    std::vector<std::vector<std::string>> field2s(config.threads, std::vector<std::string>(LOADGEN_FIELD2_POOL));
+    for (auto& pool : field2s) {
+        for (std::string& field2 : pool) {
+            if (!make_field2(server_key, &field2, err)) return false;
+        }
+    }
+    std::vector<std::unique_ptr<LoadThread>> loads;
+    uint64_t start_ns = now_ns();
+    for (int i = 0; i < config.threads; ++i) {
+        loads.push_back(std::make_unique<LoadThread>(config, http, addr, std::move(field2s[i]), i, start_ns));
+    }
+    std::vector<std::string> errors(loads.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < loads.size(); ++i) {
+        threads.emplace_back([&loads, &errors, i] { loads[i]->run(&errors[i]); });
+    }
+    for (auto& t : threads) t.join();
+    *result = LoadResult(load_stage_count(config));
+    for (size_t i = 0; i < loads.size(); ++i) {
+        if (!errors[i].empty()) {
+            *err = errors[i];
+            return false;
+        }
+        result->add(loads[i]->result());
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef CLIENT_FLOW_HPP
+#define CLIENT_FLOW_HPP
+
+#include "hdr_histogram.hpp"
+#include <openssl/evp.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What each simulated client does, in order: log in over HTTP for a ticket,
+// fetch the shard list on the same connection, then open every Custom1 port
+// in turn and log in there with a 0x501 frame carrying the ticket and an
+// RSA-OAEP encrypted session key. Stages are indexed like this; the Custom1
+// logins follow STAGE_CUSTOM1_LOGIN, one per port.
+enum LoadStage {
+    // TCP connect, for every connection a flow opens
+    STAGE_CONNECT,
+    STAGE_AUTH_LOGIN,
+    STAGE_SHARD_LIST,
+    // The whole flow, from when it was due to start
+    STAGE_FLOW,
+    STAGE_CUSTOM1_LOGIN
+};
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    uint16_t http_port = 3000;
+    std::vector<uint16_t> custom1_ports = {8226, 8228, 7003};
+    // Closed loop: `concurrency` clients, each starting its next flow as soon
+    // as the last one ends. Open loop: flows arrive at `rate` per second
+    // whatever the server's pace, at most `concurrency` at a time; a flow
+    // that waits for a slot is timed from when it was due, so a stalled
+    // server shows up in the percentiles instead of slowing the clients.
+    bool open_loop = false;
+    int concurrency = 16;
+    double rate = 100.0;
+    // Event-loop threads the clients are spread over
+    int threads = 2;
+    // Flows due before warmup_s are run but not recorded
+    int duration_s = 10;
+    int warmup_s = 1;
+    // A stage that takes longer fails its flow
+    int timeout_ms = 5000;
+    // Users loadgen0..loadgen<users-1>, all with this password (URL-safe)
+    int users = 64;
+    std::string password = "loadgen";
+};
+
+struct StageStats {
+    HdrHistogram latency_ns;
+    uint64_t errors = 0;
+};
+
+struct LoadResult {
+    // Indexed by LoadStage
+    std::vector<StageStats> stages;
+    uint64_t flows_done = 0;
+    uint64_t flows_failed = 0;
+    // Open loop: flows still waiting for a slot when the run ended
+    uint64_t flows_unstarted = 0;
+    double seconds = 0.0;
+
+    explicit LoadResult(size_t stage_count = 0) : stages(stage_count) {}
+    void add(const LoadResult& other);
+};
+
+size_t load_stage_count(const LoadConfig& config);
+// "connect", "AuthLogin", ..., "0x501 :8226"
+std::string load_stage_name(const LoadConfig& config, size_t stage);
+
+// Runs the load and returns every thread's results merged. server_key is
+// the public half of the server's Custom1 key (data/pub.key). False with
+// err set if the clients couldn't be set up.
+bool run_load(const LoadConfig& config, EVP_PKEY* server_key, LoadResult* result, std::string* err);
+
+#endif // CLIENT_FLOW_HPP
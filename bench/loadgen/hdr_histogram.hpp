@@ -0,0 +1,112 @@
+#ifndef HDR_HISTOGRAM_HPP
+#define HDR_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// log2 of the linear sub-buckets in each power-of-two bucket: 2048 keeps
+// every reported value within 0.1% of what was recorded (three significant
+// digits)
+#define HDR_SUB_BUCKET_BITS 11
+
+// Latency histogram in the HdrHistogram layout. Values are bucketed by power
+// of two, and each bucket is split into 2^HDR_SUB_BUCKET_BITS linear
+// sub-buckets, so recording is a shift and an increment and the memory is
+// fixed by the largest value tracked (about 264 KiB for an hour in ns).
+// Not thread-safe: keep one per thread and add() them together.
+class HdrHistogram {
+public:
+    // Values above highest are counted as highest
+    explicit HdrHistogram(uint64_t highest = 3600ull * 1000 * 1000 * 1000) : highest_(highest) {
+        int buckets = 1;
+        uint64_t untrackable = SUB_BUCKET_COUNT;
+        while (untrackable <= highest && buckets < 64 - HDR_SUB_BUCKET_BITS) {
+            untrackable <<= 1;
+            ++buckets;
+        }
+        counts_.assign(static_cast<size_t>(buckets + 1) * SUB_BUCKET_HALF, 0);
+    }
+
+    void record(uint64_t value) {
+        value = std::min(value, highest_);
+        ++counts_[index_of(value)];
+        ++total_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // other must track the same highest value
+    void add(const HdrHistogram& other) {
+        for (size_t i = 0; i < counts_.size() && i < other.counts_.size(); ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0.0; }
+
+    // The value at or below which `percentile` percent of the recorded
+    // values fall, to the histogram's precision (never above max()); 0 if
+    // nothing was recorded
+    uint64_t value_at_percentile(double percentile) const {
+        if (total_ == 0) return 0;
+        double p = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * total_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+private:
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ull << HDR_SUB_BUCKET_BITS;
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr int HALF_BITS = HDR_SUB_BUCKET_BITS - 1;
+
+    // Bucket 0 covers [0, SUB_BUCKET_COUNT) one by one; bucket b > 0 covers
+    // [SUB_BUCKET_HALF << b, SUB_BUCKET_COUNT << b) in steps of 1 << b
+    static int bucket_of(uint64_t value) {
+        return 63 - __builtin_clzll(value | (SUB_BUCKET_COUNT - 1)) - HALF_BITS;
+    }
+    static size_t index_of(uint64_t value) {
+        int bucket = bucket_of(value);
+        uint64_t sub = value >> bucket;
+        return (static_cast<size_t>(bucket + 1) << HALF_BITS) + (sub - SUB_BUCKET_HALF);
+    }
+    // The largest value that lands in counts_[index]
+    static uint64_t highest_equivalent(size_t index) {
+        int bucket = static_cast<int>(index >> HALF_BITS) - 1;
+        uint64_t sub = (index & (SUB_BUCKET_HALF - 1)) + SUB_BUCKET_HALF;
+        if (bucket < 0) {
+            sub -= SUB_BUCKET_HALF;
+            bucket = 0;
+        }
+        return (sub << bucket) + (1ull << bucket) - 1;
+    }
+
+    uint64_t highest_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+#endif // HDR_HISTOGRAM_HPP
@@ -0,0 +1,234 @@
+// oxide_loadgen: drives oxide through the whole client login at a set
+// concurrency or arrival rate and reports per-stage latency percentiles.
+// Each flow does AuthLogin, ShardList, then a 0x501 login on every Custom1
+// port (see client_flow.hpp).
+//
+//   ./oxide_loadgen                                    # closed loop, 16 clients, 10 s
+//   ./oxide_loadgen --mode=open --rate=500 --concurrency=256
+//   ./oxide_loadgen --external --host=10.0.0.5        # a server already running
+//   ./oxide_loadgen --write-db=users.db --users=1000  # just the users, for --external
+//
+// By default it starts its own oxide (see throwaway_server.hpp) in a scratch
+// directory with a fresh users database, so run it from the repository root
+// where data/pub.key and data/private_key.pem are, with the usual ports
+// free. --external skips all that; the server then needs the load users
+// (made with --write-db) and an AuthLogin throttle loose enough for the
+// rate. Either way a 0x501 login only counts if the server's reply says its
+// session key was stored.
+#include "client_flow.hpp"
+#include "hex_codec.hpp"
+#include "logger.hpp"
+#include "throwaway_server.hpp"
+#include <openssl/x509.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+struct Options {
+    LoadConfig load;
+    bool external = false;
+    bool keep = false;
+    int bcrypt_cost = 10;
+    std::string pub_key = "data/pub.key";
+    std::string private_key = "data/private_key.pem";
+    std::string write_db;
+};
+
+void usage() {
+    fprintf(stderr,
+            "Usage: oxide_loadgen [options]\n"
+            "  --mode=closed|open      closed: fixed clients back to back; open: fixed arrival rate (closed)\n"
+            "  --concurrency=N         clients (closed) or most flows in flight (open) (16)\n"
+            "  --rate=N                open loop: flows started per second (100)\n"
+            "  --threads=N             client event loops (2)\n"
+            "  --duration=S            measured seconds, after the warmup (10)\n"
+            "  --warmup=S              seconds run but not recorded (1)\n"
+            "  --timeout-ms=N          a stage slower than this fails its flow (5000)\n"
+            "  --users=N               distinct users the flows cycle through (64)\n"
+            "  --password=P            their password, URL-safe (loadgen)\n"
+            "  --bcrypt-cost=N         work factor of their hashes (10)\n"
+            "  --host=IP               server address (127.0.0.1)\n"
+            "  --http-port=N           AuthLogin/ShardList port, with --external (3000)\n"
+            "  --custom1-ports=A,B,..  ports for the 0x501 logins, with --external (8226,8228,7003)\n"
+            "  --pub-key=PATH          server's Custom1 public key, hex DER (data/pub.key)\n"
+            "  --private-key=PATH      key the started server decrypts with (data/private_key.pem)\n"
+            "  --external              don't start a server; use the one at --host\n"
+            "  --keep                  keep the started server's scratch directory\n"
+            "  --write-db=PATH         write the load users to PATH and exit\n");
+}
+
+// Splits "--name=value"; false if arg isn't --name
+bool option(const char* arg, const char* name, std::string* value) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0) return false;
+    if (arg[len] == '\0') {
+        value->clear();
+        return true;
+    }
+    if (arg[len] != '=') return false;
+    *value = arg + len + 1;
+    return true;
+}
+
+bool parse_ports(const std::string& list, std::vector<uint16_t>* ports) {
+    ports->clear();
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int port = atoi(item.c_str());
+        if (port <= 0 || port > 65535) return false;
+        ports->push_back(static_cast<uint16_t>(port));
+    }
+    return !ports->empty();
+}
+
+bool parse_args(int argc, char** argv, Options* opts) {
+    LoadConfig& load = opts->load;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        std::string v;
+        if (option(arg, "--mode", &v) && (v == "open" || v == "closed")) {
+            load.open_loop = v == "open";
+        } else if (option(arg, "--concurrency", &v)) {
+            load.concurrency = atoi(v.c_str());
+        } else if (option(arg, "--rate", &v)) {
+            load.rate = atof(v.c_str());
+        } else if (option(arg, "--threads", &v)) {
+            load.threads = atoi(v.c_str());
+        } else if (option(arg, "--duration", &v)) {
+            load.duration_s = atoi(v.c_str());
+        } else if (option(arg, "--warmup", &v)) {
+            load.warmup_s = atoi(v.c_str());
+        } else if (option(arg, "--timeout-ms", &v)) {
+            load.timeout_ms = atoi(v.c_str());
+        } else if (option(arg, "--users", &v)) {
+            load.users = atoi(v.c_str());
+        } else if (option(arg, "--password", &v) && !v.empty()) {
+            load.password = v;
+        } else if (option(arg, "--bcrypt-cost", &v)) {
+            opts->bcrypt_cost = atoi(v.c_str());
+        } else if (option(arg, "--host", &v) && !v.empty()) {
+            load.host = v;
+        } else if (option(arg, "--http-port", &v)) {
+            load.http_port = static_cast<uint16_t>(atoi(v.c_str()));
+        } else if (option(arg, "--custom1-ports", &v)) {
+            if (!parse_ports(v, &load.custom1_ports)) return false;
+        } else if (option(arg, "--pub-key", &v) && !v.empty()) {
+            opts->pub_key = v;
+        } else if (option(arg, "--private-key", &v) && !v.empty()) {
+            opts->private_key = v;
+        } else if (option(arg, "--external", &v)) {
+            opts->external = true;
+        } else if (option(arg, "--keep", &v)) {
+            opts->keep = true;
+        } else if (option(arg, "--write-db", &v) && !v.empty()) {
+            opts->write_db = v;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            return false;
+        } else {
+            fprintf(stderr, "Unknown or malformed option: %s\n", arg);
+            return false;
+        }
+    }
+    // A started server listens where oxide always does
+    if (!opts->external && (load.http_port != LoadConfig().http_port || load.custom1_ports != LoadConfig().custom1_ports)) {
+        fprintf(stderr, "--http-port and --custom1-ports need --external\n");
+        return false;
+    }
+    return load.duration_s > 0 && load.warmup_s >= 0 && load.timeout_ms > 0 && load.users > 0;
+}
+
+// data/pub.key is the DER SubjectPublicKeyInfo as one line of hex
+EVP_PKEY* load_public_key(const std::string& path, std::string* err) {
+    std::ifstream in(path);
+    std::string hex;
+    char c;
+    while (in.get(c)) {
+        if (!isspace(static_cast<unsigned char>(c))) hex.push_back(c);
+    }
+    if (hex.empty() || hex.size() % 2 != 0) {
+        *err = "Cannot read a hex key from " + path;
+        return nullptr;
+    }
+    std::vector<uint8_t> der(hex.size() / 2);
+    if (!hex_decode(hex.data(), der.size(), der.data())) {
+        *err = path + " is not hex";
+        return nullptr;
+    }
+    const unsigned char* p = der.data();
+    EVP_PKEY* key = d2i_PUBKEY(nullptr, &p, static_cast<long>(der.size()));
+    if (!key) *err = path + " does not hold a DER public key";
+    return key;
+}
+
+void print_report(const LoadConfig& config, const LoadResult& result) {
+    if (config.open_loop) {
+        printf("open loop, %.0f flows/s, at most %d in flight", config.rate, config.concurrency);
+    } else {
+        printf("closed loop, %d clients", config.concurrency);
+    }
+    printf(", %d threads, %d s after %d s warmup\n", config.threads, config.duration_s, config.warmup_s);
+    printf("flows: %llu done (%.1f/s), %llu failed", static_cast<unsigned long long>(result.flows_done),
+           result.flows_done / result.seconds, static_cast<unsigned long long>(result.flows_failed));
+    if (config.open_loop) printf(", %llu never started", static_cast<unsigned long long>(result.flows_unstarted));
+    printf("\n\n%-14s %9s %7s %10s %10s %10s %10s\n", "stage (ms)", "count", "errors", "p50", "p99", "p999", "max");
+    for (size_t i = 0; i < result.stages.size(); ++i) {
+        const StageStats& stage = result.stages[i];
+        const HdrHistogram& h = stage.latency_ns;
+        printf("%-14s %9llu %7llu %10.3f %10.3f %10.3f %10.3f\n", load_stage_name(config, i).c_str(),
+               static_cast<unsigned long long>(h.count()), static_cast<unsigned long long>(stage.errors),
+               h.value_at_percentile(50.0) / 1e6, h.value_at_percentile(99.0) / 1e6,
+               h.value_at_percentile(99.9) / 1e6, h.max() / 1e6);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_args(argc, argv, &opts)) {
+        usage();
+        return 2;
+    }
+    // The client links the server's modules; keep their logging quiet
+    Logger::set_destination(LogDest::FILE, "/dev/null");
+    std::string err;
+    if (!opts.write_db.empty()) {
+        if (!write_users_db(opts.write_db, opts.load.users, opts.load.password, opts.bcrypt_cost, &err)) {
+            fprintf(stderr, "%s\n", err.c_str());
+            return 1;
+        }
+        printf("wrote users loadgen0..loadgen%d to %s\n", opts.load.users - 1, opts.write_db.c_str());
+        return 0;
+    }
+    EVP_PKEY* key = load_public_key(opts.pub_key, &err);
+    if (!key) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    ThrowawayServer server;
+    if (!opts.external) {
+        if (opts.keep) server.keep();
+        if (!server.start(opts.load.users, opts.load.password, opts.bcrypt_cost, opts.private_key, opts.load.http_port, &err)) {
+            fprintf(stderr, "%s\n", err.c_str());
+            EVP_PKEY_free(key);
+            return 1;
+        }
+        printf("oxide started in %s\n", server.dir().c_str());
+    }
+    LoadResult result;
+    bool ok = run_load(opts.load, key, &result, &err);
+    EVP_PKEY_free(key);
+    server.stop();
+    if (!ok) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    print_report(opts.load, result);
+    return result.flows_done > 0 ? 0 : 1;
+}
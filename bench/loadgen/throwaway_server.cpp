@@ -0,0 +1,176 @@
+#include "throwaway_server.hpp"
+#include "Server.hpp"
+#include "logger.hpp"
+#include "server_config.hpp"
+#include "third_party/libbcrypt/bcrypt.h"
+#include <sqlite3.h>
+#include <arpa/inet.h>
+#include <ftw.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+// How long the server gets to start listening
+#define THROWAWAY_START_TIMEOUT_MS 10000
+
+namespace {
+bool port_accepts(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bool ok = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return ok;
+}
+
+bool copy_file(const std::string& from, const std::string& to, std::string* err) {
+    std::ifstream in(from, std::ios::binary);
+    if (!in) {
+        *err = "Cannot read " + from;
+        return false;
+    }
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+    if (!out) {
+        *err = "Cannot write " + to;
+        return false;
+    }
+    return true;
+}
+
+int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+} // namespace
+
+bool write_users_db(const std::string& path, int users, const std::string& password, int bcrypt_cost, std::string* err) {
+    // Salted separately, as the hash column is unique
+    std::vector<std::string> hashes(users);
+    std::atomic<int> next{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    unsigned workers = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned>(users)));
+    for (unsigned t = 0; t < workers; ++t) {
+        threads.emplace_back([&] {
+            for (int i = next++; i < users; i = next++) {
+                char salt[BCRYPT_HASHSIZE];
+                char hash[BCRYPT_HASHSIZE];
+                if (bcrypt_gensalt(bcrypt_cost, salt) != 0 || bcrypt_hashpw(password.c_str(), salt, hash) != 0) {
+                    failed = true;
+                    return;
+                }
+                hashes[i] = hash;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    if (failed) {
+        *err = "bcrypt hashing failed";
+        return false;
+    }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        *err = "Cannot open " + path + ": " + sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return false;
+    }
+    // The schema create_admin.sh uses
+    const char* schema =
+        "CREATE TABLE IF NOT EXISTS users (username TEXT PRIMARY KEY, password_hash TEXT UNIQUE NOT NULL, "
+        "customer_id INTEGER UNIQUE NOT NULL); BEGIN;";
+    sqlite3_stmt* insert = nullptr;
+    bool ok = sqlite3_exec(db, schema, nullptr, nullptr, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO users (username, password_hash, customer_id) VALUES (?, ?, ?)",
+                                 -1, &insert, nullptr) == SQLITE_OK;
+    for (int i = 0; ok && i < users; ++i) {
+        std::string username = "loadgen" + std::to_string(i);
+        sqlite3_bind_text(insert, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert, 2, hashes[i].c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(insert, 3, 1000000 + i);
+        ok = sqlite3_step(insert) == SQLITE_DONE;
+        sqlite3_reset(insert);
+    }
+    ok = ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) *err = "Cannot write users to " + path + ": " + sqlite3_errmsg(db);
+    sqlite3_finalize(insert);
+    sqlite3_close(db);
+    return ok;
+}
+
+ThrowawayServer::~ThrowawayServer() {
+    stop();
+    if (!dir_.empty() && !keep_) nftw(dir_.c_str(), remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+bool ThrowawayServer::start(int users, const std::string& password, int bcrypt_cost, const std::string& private_key_path,
+                            int http_port, std::string* err) {
+    if (port_accepts(http_port)) {
+        *err = "Port " + std::to_string(http_port) + " is already in use; stop that server or pass --external";
+        return false;
+    }
+    char dir[] = "/tmp/oxide-loadgen.XXXXXX";
+    if (!mkdtemp(dir)) {
+        *err = std::string("mkdtemp: ") + strerror(errno);
+        return false;
+    }
+    dir_ = dir;
+    if (mkdir((dir_ + "/data").c_str(), 0700) != 0) {
+        *err = std::string("mkdir: ") + strerror(errno);
+        return false;
+    }
+    if (!copy_file(private_key_path, dir_ + "/data/private_key.pem", err)) return false;
+    if (!write_users_db(dir_ + "/data/lotus.db", users, password, bcrypt_cost, err)) return false;
+
+    pid_ = fork();
+    if (pid_ < 0) {
+        *err = std::string("fork: ") + strerror(errno);
+        return false;
+    }
+    if (pid_ == 0) {
+        if (chdir(dir_.c_str()) != 0) _exit(2);
+        Logger::set_destination(LogDest::FILE, "oxide.log");
+        ServerConfig config = ServerConfig::from_env();
+        config.login_ip_burst = 0;
+        config.login_max_failures = 0;
+        Server server(config);
+        server.run();
+        _exit(0);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(THROWAWAY_START_TIMEOUT_MS);
+    while (!port_accepts(http_port)) {
+        if (waitpid(pid_, nullptr, WNOHANG) == pid_) {
+            pid_ = -1;
+            *err = "oxide exited during startup; see " + dir_ + "/oxide.log";
+            keep_ = true;
+            return false;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            *err = "oxide did not start listening on port " + std::to_string(http_port);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+void ThrowawayServer::stop() {
+    if (pid_ <= 0) return;
+    kill(pid_, SIGTERM);
+    waitpid(pid_, nullptr, 0);
+    pid_ = -1;
+}
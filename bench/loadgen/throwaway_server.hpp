@@ -0,0 +1,41 @@
+#ifndef THROWAWAY_SERVER_HPP
+#define THROWAWAY_SERVER_HPP
+
+#include <string>
+#include <sys/types.h>
+
+// Writes (or extends) a users table at path with users loadgen0 ..
+// loadgen<users-1>, all with `password` hashed at bcrypt_cost, and customer
+// ids from 1000000. Hashing runs on every core. False with err set on
+// failure.
+bool write_users_db(const std::string& path, int users, const std::string& password, int bcrypt_cost, std::string* err);
+
+// oxide running in a scratch directory made for it: data/lotus.db holds the
+// load users and data/private_key.pem is a copy of the real key, so the
+// server's relative paths resolve there and nothing under data/ is touched.
+// The server is a forked child on the usual ports, with the AuthLogin
+// throttle off (one address logs in at load rates); its log is
+// <dir>/oxide.log. The other settings come from OXIDE_* as usual.
+class ThrowawayServer {
+public:
+    ThrowawayServer() = default;
+    // Stops the server and removes the directory unless keep() was called
+    ~ThrowawayServer();
+    ThrowawayServer(const ThrowawayServer&) = delete;
+    ThrowawayServer& operator=(const ThrowawayServer&) = delete;
+
+    // Returns once the server accepts on http_port. False with err set if
+    // the port is already taken, or the server didn't come up.
+    bool start(int users, const std::string& password, int bcrypt_cost, const std::string& private_key_path,
+               int http_port, std::string* err);
+    void stop();
+    void keep() { keep_ = true; }
+    const std::string& dir() const { return dir_; }
+
+private:
+    std::string dir_;
+    pid_t pid_ = -1;
+    bool keep_ = false;
+};
+
+#endif // THROWAWAY_SERVER_HPP
@@ -0,0 +1,103 @@
+// Custom1 login path: frame (un)packing, Field2 hex decode, RSA-OAEP decrypt
+#include "custom1_handlers.hpp"
+#include "custom1_packet.hpp"
+#include <benchmark/benchmark.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <string>
+#include <vector>
+
+namespace {
+// A 0x501 login as the client sends it: session id, 256 hex digits of
+// RSA-encrypted key, and a 4-byte trailer
+std::vector<uint8_t> login_frame() {
+    static const std::string session_id = "9001672051401428250";
+    static const std::string field2(256, 'A');
+    static const std::string field3 = "2176";
+    Custom1PacketView view;
+    view.message_id = 0x501;
+    view.version = 0x101;
+    view.field1 = session_id;
+    view.field2 = field2;
+    view.field3 = field3;
+    view.packet_length = static_cast<uint16_t>(view.packed_size());
+    view.packet_length_4 = view.packet_length;
+    std::vector<uint8_t> frame(view.packed_size());
+    view.pack_into(frame.data(), frame.size());
+    return frame;
+}
+
+// 1024-bit key, as the client's Field2 is 128 bytes
+EVP_PKEY* make_key() {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    EVP_PKEY* key = nullptr;
+    if (ctx && EVP_PKEY_keygen_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 1024) > 0) EVP_PKEY_keygen(ctx, &key);
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+std::vector<unsigned char> oaep_encrypt(EVP_PKEY* key, const std::vector<unsigned char>& plain) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    std::vector<unsigned char> out;
+    size_t len = 0;
+    if (ctx && EVP_PKEY_encrypt_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) > 0 &&
+        EVP_PKEY_encrypt(ctx, nullptr, &len, plain.data(), plain.size()) > 0) {
+        out.resize(len);
+        if (EVP_PKEY_encrypt(ctx, out.data(), &len, plain.data(), plain.size()) > 0) out.resize(len); else out.clear();
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return out;
+}
+} // namespace
+
+static void BM_Custom1Unpack(benchmark::State& state) {
+    std::vector<uint8_t> frame = login_frame();
+    Custom1PacketPacker packer;
+    for (auto _ : state) benchmark::DoNotOptimize(packer.unpack(frame));
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_Custom1Unpack);
+
+// What the dispatcher does instead: no copies
+static void BM_Custom1ParseView(benchmark::State& state) {
+    std::vector<uint8_t> frame = login_frame();
+    std::string_view bytes(reinterpret_cast<const char*>(frame.data()), frame.size());
+    Custom1PacketView view;
+    for (auto _ : state) benchmark::DoNotOptimize(view.parse(bytes, nullptr));
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_Custom1ParseView);
+
+static void BM_Custom1Pack(benchmark::State& state) {
+    Custom1PacketPacker packer;
+    Custom1Packet pkt = packer.unpack(login_frame());
+    for (auto _ : state) benchmark::DoNotOptimize(packer.pack(pkt));
+}
+BENCHMARK(BM_Custom1Pack);
+
+static void BM_HexToBin(benchmark::State& state) {
+    // Field2: 256 hex digits
+    std::string hex;
+    for (int i = 0; i < 128; ++i) hex += "a5";
+    std::vector<unsigned char> out;
+    for (auto _ : state) benchmark::DoNotOptimize(hex_to_bin(hex, out, nullptr));
+    state.SetBytesProcessed(state.iterations() * hex.size());
+}
+BENCHMARK(BM_HexToBin);
+
+static void BM_RsaOaepDecrypt(benchmark::State& state) {
+    EVP_PKEY* key = make_key();
+    // Session key length, 16-byte key, expiry
+    std::vector<unsigned char> plain = {0, 16};
+    plain.resize(22, 0x42);
+    std::vector<unsigned char> cipher = key ? oaep_encrypt(key, plain) : std::vector<unsigned char>();
+    if (cipher.empty()) {
+        state.SkipWithError("RSA key setup failed");
+        EVP_PKEY_free(key);
+        return;
+    }
+    std::vector<unsigned char> out;
+    for (auto _ : state) benchmark::DoNotOptimize(rsa_oaep_decrypt(key, cipher, out, nullptr));
+    EVP_PKEY_free(key);
+}
+BENCHMARK(BM_RsaOaepDecrypt)->Unit(benchmark::kMicrosecond);
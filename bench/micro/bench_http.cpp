@@ -0,0 +1,69 @@
+// HTTP request path: request-line and query parsing, route dispatch, and
+// rendering the shard list
+#include "http_handlers.hpp"
+#include "http_request.hpp"
+#include "net_io.hpp"
+#include "shard_manager.hpp"
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+const char LOGIN_REQUEST[] =
+    "GET /AuthLogin?username=some%20player&password=p%40ss%26word&serviceID=MCO&version=2.0 HTTP/1.1\r\n"
+    "Host: localhost\r\nUser-Agent: MCO/1.0\r\n";
+const char SHARD_REQUEST[] = "GET /ShardList/ HTTP/1.1\r\nHost: localhost\r\n";
+const char UNKNOWN_REQUEST[] = "GET /nothing/here HTTP/1.1\r\nHost: localhost\r\n";
+
+// Route lookup and handler, with the response captured instead of sent
+void route(benchmark::State& state, const char* raw, size_t len) {
+    std::vector<char> buf(raw, raw + len);
+    HttpRequestView request;
+    if (!parse_http_request(buf.data(), len, request)) {
+        state.SkipWithError("request did not parse");
+        return;
+    }
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        SendCapture capture(-1, out);
+        benchmark::DoNotOptimize(handle_http_request(-1, request));
+    }
+}
+} // namespace
+
+// Parsing decodes in place, so every pass starts from a fresh copy
+static void BM_HttpParseQuery(benchmark::State& state) {
+    size_t len = sizeof(LOGIN_REQUEST) - 1;
+    std::vector<char> buf(len);
+    HttpRequestView request;
+    for (auto _ : state) {
+        std::memcpy(buf.data(), LOGIN_REQUEST, len);
+        benchmark::DoNotOptimize(parse_http_request(buf.data(), len, request));
+        benchmark::DoNotOptimize(request.param("password"));
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_HttpParseQuery);
+
+static void BM_HttpRouteShardList(benchmark::State& state) {
+    route(state, SHARD_REQUEST, sizeof(SHARD_REQUEST) - 1);
+}
+BENCHMARK(BM_HttpRouteShardList);
+
+static void BM_HttpRouteUnknown(benchmark::State& state) {
+    route(state, UNKNOWN_REQUEST, sizeof(UNKNOWN_REQUEST) - 1);
+}
+BENCHMARK(BM_HttpRouteUnknown);
+
+static void BM_FormatShardsResponse(benchmark::State& state) {
+    std::vector<ShardInfo> shards;
+    for (int i = 0; i < state.range(0); ++i) {
+        std::string n = std::to_string(i);
+        shards.push_back({n, "Shard " + n, "Benchmark shard " + n, "10.0.0." + n, "8226", "10.0.0." + n, "7003",
+                          "10.0.0." + n, "0", "", "Group-1", "100", "10", "rusty-motors.com", "80"});
+    }
+    for (auto _ : state) benchmark::DoNotOptimize(format_shards_response(shards));
+}
+BENCHMARK(BM_FormatShardsResponse)->Arg(1)->Arg(16);
@@ -0,0 +1,24 @@
+// Log line cost, with output going to /dev/null (see main.cpp)
+#include "logger.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+static void BM_LoggerLog(benchmark::State& state) {
+    for (auto _ : state) Logger::log("Received HTTP request: /ShardList/");
+}
+BENCHMARK(BM_LoggerLog)->ThreadRange(1, 4)->UseRealTime();
+
+// How most call sites build their message
+static void BM_LoggerLogConcat(benchmark::State& state) {
+    int fd = 42;
+    std::string path = "/ShardList/";
+    for (auto _ : state) LOG("Handled connection on fd " + std::to_string(fd) + " for " + path);
+}
+BENCHMARK(BM_LoggerLogConcat);
+
+static void BM_LoggerLogParts(benchmark::State& state) {
+    int fd = 42;
+    std::string path = "/ShardList/";
+    for (auto _ : state) LOG_PARTS("Handled connection on fd ", fd, " for ", path);
+}
+BENCHMARK(BM_LoggerLogParts);
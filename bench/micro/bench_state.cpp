@@ -0,0 +1,68 @@
+// Shared session and connection tables the handlers look up on every login
+#include "connection_manager.hpp"
+#include "session_manager.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#define SESSION_COUNT 10000
+
+namespace {
+std::vector<std::string> make_ids(const char* prefix, size_t count) {
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    for (size_t i = 0; i < count; ++i) ids.push_back(prefix + std::to_string(i));
+    return ids;
+}
+
+SessionManager sessions;
+const std::vector<std::string> session_ids = make_ids("session-", SESSION_COUNT);
+
+bool seed_sessions() {
+    for (size_t i = 0; i < session_ids.size(); ++i) sessions.set(session_ids[i], "customer-" + std::to_string(i));
+    return true;
+}
+const bool sessions_seeded = seed_sessions();
+} // namespace
+
+// Every thread hits the one lock; ->Threads() shows how it scales
+static void BM_SessionGet(benchmark::State& state) {
+    size_t i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sessions.get(session_ids[i % session_ids.size()]));
+        ++i;
+    }
+}
+BENCHMARK(BM_SessionGet)->ThreadRange(1, 8)->UseRealTime();
+
+// One writer in every four operations, as logins refresh sessions
+static void BM_SessionGetSet(benchmark::State& state) {
+    size_t i = state.thread_index() * 7919;
+    for (auto _ : state) {
+        const std::string& id = session_ids[i % session_ids.size()];
+        if (i % 4 == 0) {
+            sessions.set(id, "customer");
+        } else {
+            benchmark::DoNotOptimize(sessions.get(id));
+        }
+        ++i;
+    }
+}
+BENCHMARK(BM_SessionGetSet)->ThreadRange(1, 8)->UseRealTime();
+
+// A customer with no connection: the lookup walks the whole table
+static void BM_SessionKeyByCustomerId(benchmark::State& state) {
+    ConnectionManager connections;
+    int count = static_cast<int>(state.range(0));
+    for (int fd = 0; fd < count; ++fd) {
+        connections.add_connection(fd);
+        connections.update_connection(fd, [fd](ConnectionInfo& info) {
+            info.customer_id = "customer-" + std::to_string(fd);
+            info.session_key = "key-" + std::to_string(fd);
+        });
+    }
+    std::string wanted = "customer-offline";
+    for (auto _ : state) benchmark::DoNotOptimize(connections.get_session_key_by_customer_id(wanted));
+    state.counters["connections"] = count;
+}
+BENCHMARK(BM_SessionKeyByCustomerId)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,20 @@
+// oxide_bench: Google Benchmark microbenchmarks for the request hot paths.
+//
+//   ./oxide_bench                                  # everything, to the console
+//   ./oxide_bench --benchmark_filter=Custom1       # one area
+//   ./oxide_bench --benchmark_out=run.json --benchmark_out_format=json
+//
+// bench/compare_bench.py checks a JSON run against bench/baseline.json;
+// `cmake --build . --target bench_check` does both.
+#include "logger.hpp"
+#include <benchmark/benchmark.h>
+
+int main(int argc, char** argv) {
+    // Handlers log every request; measure the work, not the terminal
+    Logger::set_destination(LogDest::FILE, "/dev/null");
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -2,7 +2,7 @@
 #include "src/Server.hpp"
 
 int main() {
-    Server server;
+    Server server(ServerConfig::from_env());
     server.run();
     return 0;
 }
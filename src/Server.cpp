@@ -1,44 +1,70 @@
 #include "logger.hpp"
 #include "Server.hpp"
-#include "http_handlers.hpp"
-#include "custom1_handlers.hpp"
-#include "custom2_handlers.hpp"
-#include "logger.hpp"
 #include "connection_manager.hpp"
 #include "session_manager.hpp"
+#include "http_handlers.hpp"
+#include "custom1_handlers.hpp"
+#include "key_manager.hpp"
+#include "epoll_worker.hpp"
+#include "uring_worker.hpp"
 #include <iostream>
+#include <thread>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <linux/filter.h>
 #include <unistd.h>
+#include <csignal>
+#include <cerrno>
 #include <cstring>
 #include <algorithm>
+#include <random>
 
 #define HTTP_PORT 3000
 #define CUSTOM_PROTO2_PORT 43300
-#define MAX_CONN 10
+// How long either side of a hot restart waits for the other
+#define HANDOFF_TIMEOUT_MS 10000
 
-// Global instance for all translation units
+// Global instances for all translation units. All are internally locked and
+// shared by every worker thread.
 ConnectionManager custom1_conn_mgr;
+ConnectionManager custom2_conn_mgr;
 SessionManager session_manager;
 
 Server::Server() {
     // No side effects or socket creation in constructor
 }
 
+Server::Server(const ServerConfig& config) : config_(config) {}
+
 Server::~Server() {
+    int handoff_fd = handoff_listener_.load();
+    // Wakes the control thread out of accept()
+    if (handoff_fd >= 0) shutdown(handoff_fd, SHUT_RDWR);
+    if (handoff_thread_.joinable()) handoff_thread_.join();
+    set_auth_pool(nullptr);
+    auth_pool_.reset();
+    set_custom1_crypto_pool(nullptr);
+    crypto_pool_.reset();
+    set_login_limiter(nullptr);
+    workers_.clear();
     for (const auto& l : listeners) close(l.first);
 }
 
-int Server::create_listener(int port) {
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+int Server::create_listener(int port, bool reuse_port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0) {
         perror("socket");
         exit(EXIT_FAILURE);
     }
     int opt = 1;
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuse_port && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt(SO_REUSEPORT)");
+        close(sockfd);
+        exit(EXIT_FAILURE);
+    }
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
@@ -48,7 +74,7 @@ int Server::create_listener(int port) {
         close(sockfd);
         exit(EXIT_FAILURE);
     }
-    if (listen(sockfd, MAX_CONN) < 0) {
+    if (listen(sockfd, config_.listen_backlog) < 0) {
         perror("listen");
         close(sockfd);
         exit(EXIT_FAILURE);
@@ -56,76 +82,197 @@ int Server::create_listener(int port) {
     return sockfd;
 }
 
+bool Server::attach_cpu_steering(int listener_fd) {
+    // A = cpu the packet arrived on; return A as the socket index in the group.
+    // Out-of-range indexes make the kernel fall back to its hash.
+    sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog prog{};
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(listener_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        LOG_ERROR("SO_ATTACH_REUSEPORT_CBPF failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
 void Server::run() {
     LOG("Starting multi-port server...");
-    // HTTP server
-    int http_listener = create_listener(HTTP_PORT);
-    // Custom protocol 1 servers
+    // Handlers write with plain send(); a peer that hangs up early must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+    // SIGHUP re-reads the Custom1 private key; the handler only sets a flag
+    struct sigaction hup{};
+    hup.sa_handler = [](int) { KeyManager::request_reload(); };
+    hup.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &hup, nullptr);
+    KeyManager& custom1_keys = KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH);
+    custom1_keys.set_rotation_window_ms(static_cast<uint64_t>(std::max(config_.key_rotation_window_ms, 0)));
+    std::string key_err;
+    if (!custom1_keys.reload(&key_err)) LOG_ERROR(key_err);
+    set_custom1_verify_crc(config_.custom1_verify_crc);
+    int worker_count = config_.resolved_workers();
+    // Hot restart: take the listeners of a running server instead of binding
+    Handoff takeover;
+    std::vector<Handoff::ListenerGroup> inherited;
+    if (!config_.handoff_path.empty()) {
+        takeover = Handoff::connect(config_.handoff_path);
+        if (takeover.valid() && !takeover.receive_listeners(inherited)) {
+            LOG_ERROR("Listener handoff failed; starting cold");
+            for (const auto& group : inherited) {
+                for (const auto& l : group) close(l.first);
+            }
+            inherited.clear();
+            takeover = Handoff();
+        }
+        if (!inherited.empty()) {
+            LOG("Took over " + std::to_string(inherited.size()) + " listener groups from the running server");
+            if (static_cast<int>(inherited.size()) != worker_count) {
+                LOG("Using " + std::to_string(inherited.size()) + " workers to match the inherited listeners");
+            }
+            worker_count = static_cast<int>(inherited.size());
+        }
+    }
+    bool reuse_port = worker_count > 1;
     std::vector<int> custom_proto_ports = {8226, 8228, 7003};
-    for (int port : custom_proto_ports) {
-        listeners.emplace_back(create_listener(port), "CUSTOM1");
+    // Listeners are created worker by worker so that socket index N in every
+    // SO_REUSEPORT group belongs to worker N (and, when pinned, CPU N).
+    bool use_uring = config_.io_backend == IoBackend::IO_URING;
+    if (use_uring && !UringWorker::supported()) {
+        LOG_ERROR("io_uring backend requested but not supported by this kernel; falling back to epoll");
+        use_uring = false;
+    }
+    long cpus = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    for (int w = 0; w < worker_count; ++w) {
+        int cpu = (config_.pin_workers && worker_count > 1) ? static_cast<int>(w % cpus) : -1;
+        auto worker = make_worker(w, cpu, use_uring);
+        if (!inherited.empty()) {
+            for (const auto& [fd, protocol] : inherited[w]) {
+                listeners.emplace_back(fd, protocol);
+                worker->add_listener(fd, protocol);
+            }
+            workers_.push_back(std::move(worker));
+            continue;
+        }
+        // HTTP server
+        int http_listener = create_listener(HTTP_PORT, reuse_port);
+        // Custom protocol 1 servers
+        for (int port : custom_proto_ports) {
+            int fd = create_listener(port, reuse_port);
+            listeners.emplace_back(fd, Protocol::CUSTOM1);
+            worker->add_listener(fd, Protocol::CUSTOM1);
+        }
+        listeners.emplace_back(http_listener, Protocol::HTTP);
+        worker->add_listener(http_listener, Protocol::HTTP);
+        // Custom protocol 2 server
+        int custom_proto2_listener = create_listener(CUSTOM_PROTO2_PORT, reuse_port);
+        listeners.emplace_back(custom_proto2_listener, Protocol::CUSTOM2);
+        worker->add_listener(custom_proto2_listener, Protocol::CUSTOM2);
+        // Any protocol, told apart by its first bytes
+        if (config_.sniff_port > 0) {
+            int sniff_listener = create_listener(config_.sniff_port, reuse_port);
+            listeners.emplace_back(sniff_listener, Protocol::AUTO);
+            worker->add_listener(sniff_listener, Protocol::AUTO);
+        }
+        workers_.push_back(std::move(worker));
+    }
+    // Inherited groups keep the program the previous process attached
+    if (reuse_port && config_.reuseport_cbpf && inherited.empty()) {
+        // The program is per group, so attaching to worker 0's sockets is enough
+        for (size_t i = 0; i < listeners.size() / worker_count; ++i) {
+            attach_cpu_steering(listeners[i].first);
+        }
     }
-    listeners.emplace_back(http_listener, "HTTP");
-    // Custom protocol 2 server
-    int custom_proto2_listener = create_listener(CUSTOM_PROTO2_PORT);
-    listeners.emplace_back(custom_proto2_listener, "CUSTOM2");
     LOG(std::string("Listening on:\n") +
         "  HTTP: " + std::to_string(HTTP_PORT) + "\n" +
         "  CUSTOM1: 8226, 8228, 7003\n" +
-        "  CUSTOM2: " + std::to_string(CUSTOM_PROTO2_PORT));
+        "  CUSTOM2: " + std::to_string(CUSTOM_PROTO2_PORT) + "\n" +
+        (config_.sniff_port > 0 ? "  AUTO: " + std::to_string(config_.sniff_port) + "\n" : std::string()) +
+        "  Workers: " + std::to_string(worker_count));
+    std::string proxies_err;
+    if (!set_login_trusted_proxies(config_.login_trusted_proxies, &proxies_err)) {
+        LOG_ERROR(proxies_err + "; trusting no proxy headers");
+    }
+    if (config_.login_ip_burst > 0 || config_.login_max_failures > 0) {
+        LoginLimiter::Settings limits;
+        limits.ip_burst = std::max(config_.login_ip_burst, 0);
+        limits.ip_refill_ms = std::max(config_.login_ip_refill_ms, 0);
+        limits.max_failures = std::max(config_.login_max_failures, 0);
+        limits.failure_decay_ms = std::max(config_.login_failure_decay_ms, 0);
+        limits.slots = std::max(config_.login_limiter_slots, 1);
+        std::random_device rd;
+        login_limiter_ = std::make_unique<LoginLimiter>(limits, (static_cast<uint64_t>(rd()) << 32) | rd());
+        set_login_limiter(login_limiter_.get());
+    }
+    if (config_.auth_threads > 0) {
+        auth_pool_ = std::make_unique<TaskPool>("Auth pool", config_.auth_threads, config_.auth_queue_depth);
+        set_auth_pool(auth_pool_.get());
+    }
+    if (config_.crypto_threads > 0) {
+        crypto_pool_ = std::make_unique<CryptoPool>(custom1_keys, config_.crypto_threads,
+                                                     static_cast<size_t>(std::max(config_.crypto_queue_depth, 1)));
+        set_custom1_crypto_pool(crypto_pool_.get());
+    }
+    if (!config_.handoff_path.empty()) {
+        handoff_thread_ = std::thread(&Server::serve_handoff, this, std::move(takeover));
+    }
     handle_connections();
 }
 
-void Server::handle_connections() {
-    fd_set master_set, read_fds;
-    FD_ZERO(&master_set);
-    int fdmax = 0;
-    for (const auto& [fd, protocol] : listeners) {
-        FD_SET(fd, &master_set);
-        if (fd > fdmax) fdmax = fd;
+void Server::serve_handoff(Handoff takeover) {
+    if (takeover.valid()) {
+        // The old process stops accepting on READY; our workers are starting
+        takeover.complete(session_manager, HANDOFF_TIMEOUT_MS);
+        takeover = Handoff();
     }
+    int listen_fd = Handoff::listen(config_.handoff_path);
+    if (listen_fd < 0) return;
+    handoff_listener_.store(listen_fd);
     while (true) {
-        read_fds = master_set;
-        if (select(fdmax+1, &read_fds, nullptr, nullptr, nullptr) < 0) {
-            perror("select");
-            break;
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // shut down by ~Server
         }
-        for (const auto& [fd, protocol] : listeners) {
-            if (FD_ISSET(fd, &read_fds)) {
-                sockaddr_in client_addr;
-                socklen_t addrlen = sizeof(client_addr);
-                int client_fd = accept(fd, (sockaddr*)&client_addr, &addrlen);
-                LOG("New connection on local port " + std::to_string(ntohs(client_addr.sin_port)) + " from " + inet_ntoa(client_addr.sin_addr) + " (" + protocol + ")");
-                if (client_fd < 0) {
-                    perror("accept");
-                    continue;
-                }
-                if (protocol == "CUSTOM1") {
-                    custom1_conn_mgr.add_connection(client_fd);
-                }
-                if (protocol == "HTTP") {
-                    char buffer[1024] = {0};
-                    ssize_t bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-                    std::string request(buffer, bytes > 0 ? bytes : 0);
-                    handle_http_request(client_fd, request);
-                } else if (protocol == "CUSTOM1") {
-                    char buffer[1024] = {0};
-                    ssize_t bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-                    std::string data(buffer, bytes > 0 ? bytes : 0);
-                    // Pass client_fd as connection_id for now
-                    handle_custom1_packet(client_fd, data, client_fd);
-                } else if (protocol == "CUSTOM2") {
-                    char buffer[1024] = {0};
-                    ssize_t bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-                    std::string data(buffer, bytes > 0 ? bytes : 0);
-                    handle_custom2_packet(client_fd, data);
-                }
-                if (protocol == "CUSTOM1") {
-                    custom1_conn_mgr.remove_connection(client_fd);
-                }
-                close(client_fd);
-                LOG(std::string("Handled connection on port ") + std::to_string(ntohs(client_addr.sin_port)) + " (" + protocol + ")");
-            }
+        Handoff next(fd);
+        LOG("Hot restart requested; handing listeners to the new process");
+        std::vector<Handoff::ListenerGroup> groups;
+        for (const auto& worker : workers_) groups.push_back(worker->listeners());
+        if (!next.send_listeners(groups) || !next.wait_ready(HANDOFF_TIMEOUT_MS)) {
+            LOG_ERROR("New process did not take over; still serving");
+            continue;
         }
+        // Sessions created by connections still draining here after this
+        // snapshot are not carried over
+        for (const auto& worker : workers_) worker->drain(config_.drain_timeout_ms);
+        next.send_sessions(session_manager);
+        break;
+    }
+    handoff_listener_.store(-1);
+    close(listen_fd);
+}
+
+std::unique_ptr<Worker> Server::make_worker(int id, int cpu, bool use_uring) {
+    if (use_uring) {
+        auto worker = std::make_unique<UringWorker>(id, cpu, config_);
+        if (worker->init()) return worker;
+        LOG_ERROR("Worker " + std::to_string(id) + " could not set up io_uring; falling back to epoll");
+    }
+    return std::make_unique<EpollWorker>(id, cpu, config_);
+}
+
+void Server::handle_connections() {
+    if (workers_.size() == 1) {
+        workers_[0]->run();
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(workers_.size());
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        threads.emplace_back([w] { w->run(); });
     }
+    for (auto& t : threads) t.join();
 }
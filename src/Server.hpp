@@ -1,20 +1,46 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
+#include "crypto_pool.hpp"
+#include "hot_restart.hpp"
+#include "login_limiter.hpp"
+#include "server_config.hpp"
+#include "task_pool.hpp"
+#include "worker.hpp"
 
 class Server {
 public:
     // Construction does not bind or listen on any ports
     Server();
+    explicit Server(const ServerConfig& config);
     ~Server();
     void run();
     // Expose for testing
-    int create_listener(int port);
+    int create_listener(int port, bool reuse_port = false);
+    // Steers new connections on a SO_REUSEPORT group to the socket whose
+    // index equals the receiving CPU. Expose for testing.
+    static bool attach_cpu_steering(int listener_fd);
 private:
+    // Builds a worker for the configured backend, falling back to epoll
+    std::unique_ptr<Worker> make_worker(int id, int cpu, bool use_uring);
     void handle_connections();
-    std::vector<std::pair<int, std::string>> listeners;
+    // Control thread for hot restarts: finishes taking over from the previous
+    // process (if any), then waits to hand this one over to its replacement
+    void serve_handoff(Handoff takeover);
+    ServerConfig config_;
+    std::vector<std::pair<int, Protocol>> listeners;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    // Posts answers back to workers_, so it is stopped first
+    std::unique_ptr<TaskPool> auth_pool_;
+    std::unique_ptr<CryptoPool> crypto_pool_;
+    std::unique_ptr<LoginLimiter> login_limiter_;
+    std::thread handoff_thread_;
+    std::atomic<int> handoff_listener_{-1};
 };
 
 #endif // SERVER_HPP
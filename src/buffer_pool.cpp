@@ -0,0 +1,133 @@
+#include "buffer_pool.hpp"
+#include <utility>
+#include <vector>
+
+namespace {
+size_t class_size(int index) {
+    return static_cast<size_t>(BUFFER_POOL_MIN_CLASS) << (2 * index);
+}
+
+// Smallest class holding n bytes; -1 if n is over the largest
+int class_for(size_t n) {
+    for (int i = 0; i < BUFFER_POOL_CLASSES; ++i) {
+        if (n <= class_size(i)) return i;
+    }
+    return -1;
+}
+
+// Largest class a buffer of this capacity can stand in for; -1 if it is
+// under the smallest or over the largest
+int class_of_capacity(size_t capacity) {
+    if (capacity > BUFFER_POOL_MAX_CLASS) return -1;
+    for (int i = BUFFER_POOL_CLASSES - 1; i >= 0; --i) {
+        if (capacity >= class_size(i)) return i;
+    }
+    return -1;
+}
+
+size_t class_limit(int index) {
+    return BUFFER_POOL_CLASS_BYTES / class_size(index);
+}
+
+struct Lists {
+    std::vector<char*> blocks[BUFFER_POOL_CLASSES];
+    std::vector<std::string> strings[BUFFER_POOL_CLASSES];
+    BufferPool::Stats stats;
+
+    Lists() {
+        // Returning a buffer never allocates
+        for (int i = 0; i < BUFFER_POOL_CLASSES; ++i) {
+            blocks[i].reserve(class_limit(i));
+            strings[i].reserve(class_limit(i));
+        }
+    }
+    ~Lists();
+};
+
+// Set once this thread's lists are destroyed; buffers released after that
+// (by thread_local or static objects destroyed later) go to the heap
+thread_local bool lists_gone = false;
+
+Lists::~Lists() {
+    lists_gone = true;
+    for (auto& list : blocks) {
+        for (char* block : list) delete[] block;
+    }
+}
+
+Lists* local_lists() {
+    if (lists_gone) return nullptr;
+    thread_local Lists lists;
+    return &lists;
+}
+} // namespace
+
+char* BufferPool::acquire(size_t n, size_t* capacity) {
+    int index = class_for(n);
+    Lists* lists = local_lists();
+    if (index < 0) {
+        if (lists) ++lists->stats.misses;
+        *capacity = n;
+        return new char[n];
+    }
+    *capacity = class_size(index);
+    if (lists && !lists->blocks[index].empty()) {
+        char* block = lists->blocks[index].back();
+        lists->blocks[index].pop_back();
+        lists->stats.cached_bytes -= *capacity;
+        ++lists->stats.hits;
+        return block;
+    }
+    if (lists) ++lists->stats.misses;
+    return new char[*capacity];
+}
+
+void BufferPool::release(char* block, size_t capacity) {
+    if (!block) return;
+    int index = class_for(capacity);
+    Lists* lists = local_lists();
+    if (lists && index >= 0 && class_size(index) == capacity && lists->blocks[index].size() < class_limit(index)) {
+        lists->blocks[index].push_back(block);
+        lists->stats.cached_bytes += capacity;
+        return;
+    }
+    delete[] block;
+}
+
+std::string BufferPool::acquire_string(size_t n) {
+    int index = class_for(n);
+    Lists* lists = local_lists();
+    if (lists && index >= 0) {
+        // A larger buffer beats a trip to the heap
+        for (int i = index; i < BUFFER_POOL_CLASSES; ++i) {
+            if (lists->strings[i].empty()) continue;
+            std::string s = std::move(lists->strings[i].back());
+            lists->strings[i].pop_back();
+            lists->stats.cached_bytes -= s.capacity();
+            ++lists->stats.hits;
+            return s;
+        }
+    }
+    if (lists) ++lists->stats.misses;
+    std::string s;
+    s.reserve(index >= 0 ? class_size(index) : n);
+    return s;
+}
+
+void BufferPool::release_string(std::string&& s) {
+    int index = class_of_capacity(s.capacity());
+    Lists* lists = local_lists();
+    if (!lists || index < 0 || lists->strings[index].size() >= class_limit(index)) {
+        // Freed here rather than by whatever still owns s
+        std::string().swap(s);
+        return;
+    }
+    s.clear();
+    lists->stats.cached_bytes += s.capacity();
+    lists->strings[index].push_back(std::move(s));
+}
+
+BufferPool::Stats BufferPool::stats() {
+    Lists* lists = local_lists();
+    return lists ? lists->stats : Stats();
+}
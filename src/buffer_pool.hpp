@@ -0,0 +1,45 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Smallest and largest pooled size classes; each class is 4x the one below
+#define BUFFER_POOL_MIN_CLASS 1024
+#define BUFFER_POOL_MAX_CLASS (64 * 1024)
+#define BUFFER_POOL_CLASSES 4
+// Bytes each class may keep on its free list per thread
+#define BUFFER_POOL_CLASS_BYTES (256 * 1024)
+
+// Receive and send buffers recycled per thread, so a connection's buffers
+// come from (and go back to) a free list instead of the global heap. Sizes
+// are rounded up to a 1, 4, 16 or 64 KiB class; a free list that already
+// holds BUFFER_POOL_CLASS_BYTES frees what is returned to it, and anything
+// over 64 KiB always goes straight to the heap.
+//
+// Every call works on the calling thread's lists, so no locking is needed.
+// A buffer may be released on another thread than the one that acquired
+// it; it just joins that thread's lists.
+class BufferPool {
+public:
+    // Raw storage of at least n bytes; *capacity is what was handed out and
+    // must be passed back to release()
+    static char* acquire(size_t n, size_t* capacity);
+    static void release(char* block, size_t capacity);
+
+    // An empty string with room for at least n bytes. Hand it back with
+    // release_string() once its contents are sent; the capacity is kept.
+    static std::string acquire_string(size_t n = 0);
+    static void release_string(std::string&& s);
+
+    // Calling thread only
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t cached_bytes = 0;
+    };
+    static Stats stats();
+};
+
+#endif // BUFFER_POOL_HPP
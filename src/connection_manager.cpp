@@ -2,7 +2,7 @@
 
 void ConnectionManager::add_connection(int socket_fd) {
     std::lock_guard<std::mutex> lock(mtx);
-    connections[socket_fd] = ConnectionInfo{socket_fd, "", ""};
+    connections[socket_fd] = ConnectionInfo{socket_fd};
 }
 
 void ConnectionManager::remove_connection(int socket_fd) {
@@ -6,9 +6,9 @@
 #include <functional> // For std::reference_wrapper
 
 struct ConnectionInfo {
-    int socket_fd; // Unique per connection
-    std::string session_key; // To be set after authentication
-    std::string customer_id; // To be set after authentication
+    int socket_fd = -1; // Unique per connection
+    std::string session_key{}; // To be set after authentication
+    std::string customer_id{}; // To be set after authentication
 };
 
 class ConnectionManager {
@@ -0,0 +1,170 @@
+#include "crc32.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_X86 1
+#endif
+
+namespace {
+// Reflected CRC-32 polynomial
+#define CRC32_POLY 0xEDB88320u
+// Shortest run worth folding; the fold needs four 16-byte lanes to start
+#define CRC32_FOLD_MIN 64
+
+// table[0] is the classic byte-at-a-time table; table[k][b] is the CRC of
+// byte b followed by k zero bytes, so eight lookups consume eight bytes
+struct SliceTables {
+    uint32_t table[8][256];
+    constexpr SliceTables() : table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit) c = (c >> 1) ^ ((c & 1) ? CRC32_POLY : 0);
+            table[0][i] = c;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i) {
+                uint32_t prev = table[k - 1][i];
+                table[k][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+            }
+        }
+    }
+};
+constexpr SliceTables SLICE;
+
+inline uint32_t load_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Works on the inverted register, like the fold below
+uint32_t slice8(uint32_t state, const uint8_t* p, size_t len) {
+    const auto& t = SLICE.table;
+    while (len >= 8) {
+        uint32_t one = state ^ load_le32(p);
+        uint32_t two = load_le32(p + 4);
+        state = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+                t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) state = (state >> 8) ^ t[0][(state ^ *p++) & 0xFF];
+    return state;
+}
+
+uint32_t update_slice8(uint32_t crc, const uint8_t* data, size_t len) {
+    return ~slice8(~crc, data, len);
+}
+
+#ifdef CRC32_X86
+// Multiplies both halves of x forward by the distance k encodes and adds in
+// the next 16 bytes
+__attribute__((target("pclmul,sse2"))) inline __m128i fold(__m128i x, __m128i k, __m128i next) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+}
+
+// Folds len bytes (a multiple of 16, at least 64) into the register with
+// carry-less multiplies, then Barrett-reduces to 32 bits. Constants are the
+// bit-reflected x^n mod P values from Intel's "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ".
+__attribute__((target("pclmul,sse2"))) uint32_t fold_pclmul(uint32_t state, const uint8_t* p, size_t len) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_cvtsi32_si128(static_cast<int>(state)));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+    p += 64;
+    len -= 64;
+
+    // Four independent lanes, 64 bytes per round
+    while (len >= 64) {
+        x1 = fold(x1, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        x2 = fold(x2, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)));
+        x3 = fold(x3, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)));
+        x4 = fold(x4, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)));
+        p += 64;
+        len -= 64;
+    }
+    // Down to one lane, then 16 bytes per round
+    x1 = fold(x1, k3k4, x2);
+    x1 = fold(x1, k3k4, x3);
+    x1 = fold(x1, k3k4, x4);
+    while (len >= 16) {
+        x1 = fold(x1, k3k4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        p += 16;
+        len -= 16;
+    }
+
+    // 128 bits to 64
+    __m128i t = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+    t = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5k0, 0x00), t);
+
+    // Barrett reduction to 32
+    t = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, low32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+}
+
+uint32_t update_pclmul(uint32_t crc, const uint8_t* data, size_t len) {
+    uint32_t state = ~crc;
+    if (len >= CRC32_FOLD_MIN) {
+        size_t folded = len & ~static_cast<size_t>(15);
+        state = fold_pclmul(state, data, folded);
+        data += folded;
+        len -= folded;
+    }
+    return ~slice8(state, data, len);
+}
+#endif
+
+struct Impl {
+    Crc32Impl impl;
+    uint32_t (*update)(uint32_t, const uint8_t*, size_t);
+};
+
+bool supported(Crc32Impl impl) {
+#ifdef CRC32_X86
+    // Runs during static initialisation, possibly before the CPU model is set up
+    __builtin_cpu_init();
+    if (impl == Crc32Impl::PCLMUL) return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+#endif
+    return impl == Crc32Impl::SLICE8;
+}
+
+Impl impl_for(Crc32Impl impl) {
+#ifdef CRC32_X86
+    if (impl == Crc32Impl::PCLMUL) return Impl{impl, update_pclmul};
+#endif
+    return Impl{Crc32Impl::SLICE8, update_slice8};
+}
+
+Impl pick_impl() {
+    return impl_for(supported(Crc32Impl::PCLMUL) ? Crc32Impl::PCLMUL : Crc32Impl::SLICE8);
+}
+
+Impl current = pick_impl();
+} // namespace
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+    return current.update(crc, data, len);
+}
+
+Crc32Impl crc32_impl() {
+    return current.impl;
+}
+
+bool crc32_set_impl(Crc32Impl impl) {
+    if (!supported(impl)) return false;
+    current = impl_for(impl);
+    return true;
+}
+
+const char* crc32_impl_name(Crc32Impl impl) {
+    return impl == Crc32Impl::PCLMUL ? "pclmul" : "slice8";
+}
@@ -0,0 +1,27 @@
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, reflected, the one zlib computes). On x86 with
+// PCLMULQDQ, runs of 64 bytes or more are folded 64 bytes at a time with
+// carry-less multiplies; the rest, and other CPUs, use slicing-by-8 tables.
+enum class Crc32Impl { SLICE8, PCLMUL };
+
+// Extends crc (0 to start) over len bytes, so crc32_update(crc32_update(0,
+// a), b) is the CRC of a followed by b
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len);
+
+inline uint32_t crc32(const void* data, size_t len) {
+    return crc32_update(0, static_cast<const uint8_t*>(data), len);
+}
+
+// The implementation in use, and a switch for tests and benchmarks. Returns
+// false (and changes nothing) if the CPU lacks it. Not thread-safe; call
+// before other threads use it.
+Crc32Impl crc32_impl();
+bool crc32_set_impl(Crc32Impl impl);
+const char* crc32_impl_name(Crc32Impl impl);
+
+#endif // CRC32_HPP
@@ -0,0 +1,172 @@
+#include "crypto_pool.hpp"
+#include "logger.hpp"
+#include <openssl/err.h>
+#include <openssl/rsa.h>
+#include <algorithm>
+
+// Most jobs one pass queues before they are submitted anyway, and most one
+// pool thread takes off the queue at a time
+#define CRYPTO_BATCH 32
+
+namespace {
+// Jobs an I/O thread has queued during its current pass
+struct PendingBatch {
+    CryptoPool* pool = nullptr;
+    std::vector<CryptoPool::Job> jobs;
+};
+thread_local PendingBatch pending;
+
+void fail_jobs(std::vector<CryptoPool::Job>& jobs, const std::string& err) {
+    std::vector<unsigned char> nothing;
+    for (CryptoPool::Job& job : jobs) job.done(false, nothing, err);
+    jobs.clear();
+}
+} // namespace
+
+OaepDecryptor::~OaepDecryptor() {
+    for (Context& c : contexts_) EVP_PKEY_CTX_free(c.ctx);
+}
+
+EVP_PKEY_CTX* OaepDecryptor::context_for(const KeyManager::Key& key, std::string* err) {
+    for (const Context& c : contexts_) {
+        if (c.key == key) return c.ctx;
+    }
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key.get(), nullptr);
+    if (!ctx) {
+        if (err) *err = "Failed to create EVP_PKEY_CTX";
+        return nullptr;
+    }
+    if (EVP_PKEY_decrypt_init(ctx) <= 0 || EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
+        if (err) *err = "Failed to set up RSA-OAEP decryption";
+        EVP_PKEY_CTX_free(ctx);
+        return nullptr;
+    }
+    contexts_.push_back(Context{key, ctx});
+    return ctx;
+}
+
+void OaepDecryptor::prune(const KeyManager::KeySet& keys) {
+    auto retired = [&keys](const Context& c) {
+        return std::find(keys.keys.begin(), keys.keys.end(), c.key) == keys.keys.end();
+    };
+    for (Context& c : contexts_) {
+        if (retired(c)) EVP_PKEY_CTX_free(c.ctx);
+    }
+    contexts_.erase(std::remove_if(contexts_.begin(), contexts_.end(), retired), contexts_.end());
+}
+
+bool OaepDecryptor::decrypt(const KeyManager::KeySet& keys, const std::vector<unsigned char>& in,
+                            std::vector<unsigned char>& out, std::string* err) {
+    if (contexts_.size() > keys.keys.size()) prune(keys);
+    if (keys.keys.empty()) {
+        if (err) *err = "No private key loaded";
+        return false;
+    }
+    for (const KeyManager::Key& key : keys.keys) {
+        EVP_PKEY_CTX* ctx = context_for(key, err);
+        if (!ctx) continue;
+        // The output can't be longer than the modulus
+        size_t outlen = static_cast<size_t>(EVP_PKEY_get_size(key.get()));
+        out.resize(outlen);
+        if (EVP_PKEY_decrypt(ctx, out.data(), &outlen, in.data(), in.size()) > 0) {
+            out.resize(outlen);
+            return true;
+        }
+        // Don't let a wrong key's errors pile up on the thread's queue
+        ERR_clear_error();
+        if (err) *err = "EVP_PKEY_decrypt failed";
+    }
+    out.clear();
+    return false;
+}
+
+CryptoPool::CryptoPool(KeyManager& keys, int threads, size_t max_queued)
+    : keys_(keys), max_queued_(max_queued) {
+    threads_.reserve(threads);
+    for (int i = 0; i < threads; ++i) threads_.emplace_back([this] { run(); });
+}
+
+CryptoPool::~CryptoPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    ready_.notify_all();
+    for (auto& t : threads_) t.join();
+    if (pending.pool == this) {
+        pending.pool = nullptr;
+        pending.jobs.clear();
+    }
+}
+
+bool CryptoPool::submit(std::vector<Job>& batch) {
+    if (batch.empty()) return true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() + batch.size() > max_queued_ || stopping_) {
+            rejected_.fetch_add(batch.size(), std::memory_order_relaxed);
+            return false;
+        }
+        for (Job& job : batch) queue_.push_back(std::move(job));
+    }
+    submitted_.fetch_add(batch.size(), std::memory_order_relaxed);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    // One job wakes one thread; a batch is shared out
+    if (batch.size() == 1) {
+        ready_.notify_one();
+    } else {
+        ready_.notify_all();
+    }
+    batch.clear();
+    return true;
+}
+
+void CryptoPool::queue(Job job) {
+    if (pending.pool != this) flush_pending();
+    pending.pool = this;
+    pending.jobs.push_back(std::move(job));
+    if (pending.jobs.size() >= CRYPTO_BATCH) flush_pending();
+}
+
+void CryptoPool::flush_pending() {
+    if (pending.jobs.empty()) return;
+    CryptoPool* pool = pending.pool;
+    if (!pool->submit(pending.jobs)) {
+        LOG_ERROR("Crypto pool queue full; failing " + std::to_string(pending.jobs.size()) + " decrypt(s)");
+        fail_jobs(pending.jobs, "Crypto pool queue full");
+    }
+}
+
+CryptoPool::Stats CryptoPool::stats() const {
+    return Stats{submitted_.load(std::memory_order_relaxed), rejected_.load(std::memory_order_relaxed),
+                 completed_.load(std::memory_order_relaxed), batches_.load(std::memory_order_relaxed)};
+}
+
+void CryptoPool::run() {
+    OaepDecryptor decryptor;
+    std::vector<Job> jobs;
+    std::vector<unsigned char> plain;
+    std::string err;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            // A fair share, so one thread doesn't take a whole burst while
+            // the others sleep
+            size_t take = std::min<size_t>(CRYPTO_BATCH, (queue_.size() + threads_.size() - 1) / threads_.size());
+            for (size_t i = 0; i < take; ++i) {
+                jobs.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        std::shared_ptr<const KeyManager::KeySet> keys = keys_.keys();
+        for (Job& job : jobs) {
+            bool ok = decryptor.decrypt(*keys, job.ciphertext, plain, &err);
+            job.done(ok, plain, err);
+        }
+        completed_.fetch_add(jobs.size(), std::memory_order_relaxed);
+        jobs.clear();
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef CRYPTO_POOL_HPP
+#define CRYPTO_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openssl/evp.h>
+#include "key_manager.hpp"
+
+// RSA-OAEP decryption with contexts set up once per key. An EVP_PKEY_CTX
+// that has been through decrypt_init and padding setup can decrypt any
+// number of times, so each thread keeps one per key and only builds a new
+// one after a key reload. Not thread-safe; give each thread its own.
+class OaepDecryptor {
+public:
+    OaepDecryptor() = default;
+    ~OaepDecryptor();
+    OaepDecryptor(const OaepDecryptor&) = delete;
+    OaepDecryptor& operator=(const OaepDecryptor&) = delete;
+
+    // Tries the set's keys newest first
+    bool decrypt(const KeyManager::KeySet& keys, const std::vector<unsigned char>& in,
+                 std::vector<unsigned char>& out, std::string* err);
+
+private:
+    struct Context {
+        KeyManager::Key key;  // keeps the pointer from being reused
+        EVP_PKEY_CTX* ctx;
+    };
+    EVP_PKEY_CTX* context_for(const KeyManager::Key& key, std::string* err);
+    // Frees contexts for keys that are no longer in the set
+    void prune(const KeyManager::KeySet& keys);
+
+    std::vector<Context> contexts_;
+};
+
+// Threads that decrypt Custom1 login blobs off the I/O workers. An I/O
+// thread queue()s jobs as it dispatches and flush_pending()s them as one
+// submission at the end of its pass, so a burst of logins costs one lock
+// and one wakeup. Each pool thread takes a share of the queue at a time,
+// fetches the key set once for it, and runs each job's callback on itself.
+class CryptoPool {
+public:
+    // ok is false if every key failed or the queue was full; plain then
+    // holds nothing and err says why
+    using Callback = std::function<void(bool ok, std::vector<unsigned char>& plain, const std::string& err)>;
+    struct Job {
+        std::vector<unsigned char> ciphertext;
+        Callback done;
+    };
+    struct Stats {
+        uint64_t submitted;
+        uint64_t rejected;
+        uint64_t completed;
+        uint64_t batches;  // submissions, each of one or more jobs
+    };
+
+    CryptoPool(KeyManager& keys, int threads, size_t max_queued);
+    // Jobs still queued are dropped; running ones finish first
+    ~CryptoPool();
+    CryptoPool(const CryptoPool&) = delete;
+    CryptoPool& operator=(const CryptoPool&) = delete;
+
+    // Thread-safe. Queues every job in the batch, or none of them if they
+    // don't fit; the batch is left untouched then.
+    bool submit(std::vector<Job>& batch);
+    // Adds a job to the calling thread's pending batch. A full batch is
+    // submitted straight away; jobs that don't fit fail through their
+    // callback.
+    void queue(Job job);
+    // Submits whatever the calling thread has queued
+    static void flush_pending();
+
+    KeyManager& keys() const { return keys_; }
+    int threads() const { return static_cast<int>(threads_.size()); }
+    Stats stats() const;
+
+private:
+    void run();
+
+    KeyManager& keys_;
+    size_t max_queued_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> batches_{0};
+};
+
+#endif // CRYPTO_POOL_HPP
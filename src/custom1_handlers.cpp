@@ -1,6 +1,7 @@
 #include "custom1_handlers.hpp"
 #include "logger.hpp"
 #include "custom1_packet.hpp"
+#include "net_io.hpp"
 #include <cstring>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -16,26 +17,27 @@
 #include "db_handler.hpp"
 #include "connection_manager.hpp"
 #include "session_manager.hpp"
+#include "key_manager.hpp"
+#include "crypto_pool.hpp"
+#include "deferred_response.hpp"
+#include "hex_codec.hpp"
+#include "request_arena.hpp"
+#include "protocol_dispatch.hpp"
 
 extern SessionManager session_manager;
 
 // Helper: decode hex string to binary
-bool hex_to_bin(const std::string& hex, std::vector<unsigned char>& out, std::string* err) {
+bool hex_to_bin(std::string_view hex, std::vector<unsigned char>& out, std::string* err) {
     if (hex.size() % 2 != 0) {
         if (err) *err = "Hex string has odd length";
         return false;
     }
-    out.clear();
-    out.reserve(hex.size() / 2);
-    for (size_t i = 0; i < hex.size(); i += 2) {
-        char hi = hex[i];
-        char lo = hex[i + 1];
-        if (!isxdigit(hi) || !isxdigit(lo)) {
-            if (err) *err = "Non-hex character at position " + std::to_string(i);
-            return false;
-        }
-        unsigned char byte = static_cast<unsigned char>(std::stoi(hex.substr(i, 2), nullptr, 16));
-        out.push_back(byte);
+    out.resize(hex.size() / 2);
+    size_t bad_pos = 0;
+    if (!hex_decode(hex.data(), out.size(), out.data(), &bad_pos)) {
+        if (err) *err = "Non-hex character at position " + std::to_string(bad_pos);
+        out.clear();
+        return false;
     }
     return true;
 }
@@ -87,74 +89,145 @@ bool rsa_oaep_decrypt(EVP_PKEY* pkey, const std::vector<unsigned char>& in, std:
     return true;
 }
 
+namespace {
+CryptoPool* crypto_pool = nullptr;
+bool verify_crc = false;
+
+// The raw session key from a decrypted Field2 record; false if the record is
+// too short to hold it and its expiration
+bool parse_session_key(const std::vector<unsigned char>& plain, const std::string& session_id, std::string& session_key) {
+    int decrypted_len = static_cast<int>(plain.size());
+    if (decrypted_len < 6) {
+        LOG_ERROR("Decrypted buffer too short to contain session key and expiration");
+        return false;
+    }
+    int session_key_len = (plain[0] << 8) | plain[1];
+    if (session_key_len <= 0 || session_key_len + 6 > decrypted_len) {
+        LOG_ERROR("Decrypted buffer too short or invalid session key length: " + std::to_string(session_key_len));
+        return false;
+    }
+    session_key.assign(reinterpret_cast<const char*>(plain.data()) + 2, session_key_len);
+    LOG("Session key successfully decrypted for user: " + session_id);
+    return true;
+}
+
+// Stores a session key, hex encoded, on the connection; false if the
+// connection isn't registered
+bool store_session_key(const std::string& session_key, const std::string& customer_id, int connection_id) {
+    std::string session_key_hex(2 * session_key.size(), '\0');
+    hex_encode(reinterpret_cast<const uint8_t*>(session_key.data()), session_key.size(), &session_key_hex[0]);
+    bool stored = false;
+    custom1_conn_mgr.update_connection(connection_id, [&](ConnectionInfo& conn_info) {
+        conn_info.session_key = session_key_hex;
+        conn_info.customer_id = customer_id;
+        LOG("Session key stored for customer ID: " + conn_info.customer_id);
+        stored = true;
+    });
+    if (!stored) LOG_ERROR_PARTS("No Custom Protocol 1 connection ", connection_id, " to store the session key on");
+    return stored;
+}
+
+// Keys the connection's traffic cipher with the session key. A key AES
+// can't take leaves the connection's traffic in the clear.
+void key_cipher(ConnContext& ctx, const std::string& session_key) {
+    std::string err;
+    if (!ctx.cipher.init(reinterpret_cast<const uint8_t*>(session_key.data()), session_key.size(), &err)) {
+        LOG_ERROR("Custom Protocol 1 traffic stays unencrypted: " + err);
+    }
+}
+
+// Sends a reply, encrypted once a login has keyed the connection's cipher
+void send_reply(int client_fd, ConnContext* ctx, const char* reply, size_t len) {
+    if (!ctx || !ctx->cipher.ready()) {
+        net_send(client_fd, reply, len);
+        return;
+    }
+    uint8_t* out = RequestArena::local().allocate_array<uint8_t>(len);
+    memcpy(out, reply, len);
+    ctx->cipher.encrypt(out, len);
+    net_send(client_fd, out, len);
+}
+} // namespace
+
+void set_custom1_crypto_pool(CryptoPool* pool) {
+    crypto_pool = pool;
+}
+
+void set_custom1_verify_crc(bool verify) {
+    verify_crc = verify;
+}
+
+Custom1LoginResult handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std::string& privkey_path, ConnContext* ctx)
+{
+    return handle_custom1_login(Custom1PacketView::of(pkt), connection_id, privkey_path, ctx);
+}
+
 // Handler for message_id 0x501 (login)
-void handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std::string& privkey_path)
+Custom1LoginResult handle_custom1_login(const Custom1PacketView &pkt, int connection_id, const std::string& privkey_path, ConnContext* ctx)
 {
     if (pkt.field1.empty()) {
         LOG_ERROR("Field1 (session_id) is empty, cannot process login.");
-        return;
+        return Custom1LoginResult::FAILED;
     }
-    std::string session_id(pkt.field1.begin(), pkt.field1.end());
-    LOG("Processing login for session_id: [" + session_id + "] (len=" + std::to_string(session_id.size()) + ")");
+    std::string session_id(pkt.field1);
+    LOG_PARTS("Processing login for session_id: [", session_id, "] (len=", session_id.size(), ")");
     auto customer_id_opt = session_manager.get(session_id);
     if (!customer_id_opt) {
-        LOG_ERROR("Session ID not found in SessionManager: [" + session_id + "] (len=" + std::to_string(session_id.size()) + ")");
-        return;
+        LOG_ERROR_PARTS("Session ID not found in SessionManager: [", session_id, "] (len=", session_id.size(), ")");
+        return Custom1LoginResult::FAILED;
     }
     if (pkt.field2.size() != 256) {
-        LOG_ERROR("Field2 hex string length is not 256, got: " + std::to_string(pkt.field2.size()));
-        return;
+        LOG_ERROR_PARTS("Field2 hex string length is not 256, got: ", pkt.field2.size());
+        return Custom1LoginResult::FAILED;
     }
     std::vector<unsigned char> field2_bin;
     std::string hex_err;
-    if (!hex_to_bin(std::string(pkt.field2.begin(), pkt.field2.end()), field2_bin, &hex_err)) {
+    if (!hex_to_bin(pkt.field2, field2_bin, &hex_err)) {
         LOG_ERROR("Aborting Field2 decryption: " + hex_err);
-        return;
+        return Custom1LoginResult::FAILED;
     }
-    std::string key_err;
-    EVP_PKEY* pkey = load_private_key(privkey_path, &key_err);
-    if (!pkey) {
-        LOG_ERROR(key_err);
-        return;
+    std::string customer_id = *customer_id_opt;
+    if (crypto_pool && can_defer_response() && &KeyManager::shared(privkey_path) == &crypto_pool->keys()) {
+        // The connection dispatches nothing more until the key is stored, so
+        // a later frame can't race the session key it depends on. The key is
+        // stored on the worker's thread, and only if this connection is still
+        // the one on connection_id, just before the login's reply goes out.
+        DeferredReply reply = defer_reply();
+        crypto_pool->queue(CryptoPool::Job{std::move(field2_bin),
+            [reply, session_id, customer_id, connection_id](bool ok, std::vector<unsigned char>& plain, const std::string& err) {
+                if (!ok) {
+                    LOG_ERROR(err);
+                    reply.post(CUSTOM1_REPLY_LOGIN_FAILED);
+                    return;
+                }
+                std::string session_key;
+                if (!parse_session_key(plain, session_id, session_key)) {
+                    reply.post(CUSTOM1_REPLY_LOGIN_FAILED);
+                    return;
+                }
+                reply.post(CUSTOM1_REPLY_OK, [session_key = std::move(session_key), customer_id, connection_id](ConnContext& ctx) {
+                    if (store_session_key(session_key, customer_id, connection_id)) key_cipher(ctx, session_key);
+                });
+            }});
+        return Custom1LoginResult::DEFERRED;
     }
+    // Parsed once and shared; the set holds its keys alive even if a reload
+    // replaces them mid-decrypt. A key retired by a rotation still decrypts
+    // during its window.
+    thread_local OaepDecryptor decryptor;
+    std::shared_ptr<const KeyManager::KeySet> keys = KeyManager::shared(privkey_path).keys();
     std::vector<unsigned char> decrypted;
     std::string dec_err;
-    if (!rsa_oaep_decrypt(pkey, field2_bin, decrypted, &dec_err)) {
-        LOG_ERROR(dec_err);
-        EVP_PKEY_free(pkey);
-        return;
+    if (!decryptor.decrypt(*keys, field2_bin, decrypted, &dec_err)) {
+        LOG_ERROR(dec_err + " (" + privkey_path + ")");
+        return Custom1LoginResult::FAILED;
     }
-    EVP_PKEY_free(pkey);
-    int decrypted_len = static_cast<int>(decrypted.size());
-    if (decrypted_len >= 6) {
-        int session_key_len = (decrypted[0] << 8) | decrypted[1];
-        if (session_key_len > 0 && session_key_len + 6 <= decrypted_len) {
-            std::string session_key_hex;
-            for (int i = 0; i < session_key_len; ++i) {
-                char hex[3];
-                snprintf(hex, sizeof(hex), "%02x", decrypted[2 + i]);
-                session_key_hex += hex;
-            }
-            uint32_t expires = (decrypted[2 + session_key_len] << 24) |
-                               (decrypted[2 + session_key_len + 1] << 16) |
-                               (decrypted[2 + session_key_len + 2] << 8) |
-                               (decrypted[2 + session_key_len + 3]);
-            LOG("Session key successfully decrypted for user: " + session_id);
-            ConnectionManager &conn_mgr = custom1_conn_mgr;
-            auto conn_info_opt = conn_mgr.get_connection(connection_id);
-            if (conn_info_opt) {
-                conn_mgr.update_connection(connection_id, [&](ConnectionInfo& conn_info) {
-                    conn_info.session_key = session_key_hex;
-                    conn_info.customer_id = *customer_id_opt;
-                    LOG("Session key stored for customer ID: " + conn_info.customer_id);
-                });
-            }
-        } else {
-            LOG_ERROR("Decrypted buffer too short or invalid session key length: " + std::to_string(session_key_len));
-        }
-    } else {
-        LOG_ERROR("Decrypted buffer too short to contain session key and expiration");
+    std::string session_key;
+    if (!parse_session_key(decrypted, session_id, session_key) ||
+        !store_session_key(session_key, customer_id, connection_id)) {
+        return Custom1LoginResult::FAILED;
     }
+    if (ctx) key_cipher(*ctx, session_key);
 
     // NOTE: If you encounter issues with decryption or session key extraction in the future,
     // check the following:
@@ -167,8 +240,54 @@ void handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std
     // 7. Use logs to compare the session_id at storage and lookup points if session lookup fails.
     //
     // This code is compatible with OpenSSL 3.0+ and avoids deprecated APIs.
+    return Custom1LoginResult::STORED;
 }
 
+namespace {
+// Decodes the frame with Codec and hands the message to Handle; the
+// message's byte fields point into the frame
+template <typename Codec, void (*Handle)(const typename Codec::Message&, const Custom1Request&)>
+bool decode_then(const Custom1Request& req) {
+    typename Codec::Message msg;
+    std::string err;
+    if (Codec::decode(req.frame, msg, &err) == 0) {
+        LOG_ERROR_PARTS("Failed to unpack Custom Protocol 1 message ", read_u16(reinterpret_cast<const uint8_t*>(req.frame.data())), ": ", err);
+        return false;
+    }
+    Handle(msg, req);
+    return true;
+}
+
+void route_login(const Custom1PacketView& pkt, const Custom1Request& req) {
+    LOG("Parsed Custom Protocol 1 packet:");
+    LOG_PARTS("  Message ID: ", pkt.message_id);
+    LOG_PARTS("  Packet Length: ", pkt.packet_length);
+    LOG_PARTS("  Version: ", pkt.version);
+    LOG_PARTS("  Reserved1: ", pkt.reserved1);
+    LOG_PARTS("  Packet Length 4: ", pkt.packet_length_4);
+    LOG_PARTS("  Field1 Length: ", pkt.field1.size());
+    LOG_PARTS("  Field1 Data: ", pkt.field1);
+    LOG_PARTS("  Reserved2: ", pkt.reserved2);
+    LOG_PARTS("  Field2 Length: ", pkt.field2.size());
+    LOG_PARTS("  Field2 Data: ", pkt.field2);
+    Custom1LoginResult result = handle_custom1_login(pkt, req.connection_id, CUSTOM1_PRIVATE_KEY_PATH, req.ctx);
+    if (result == Custom1LoginResult::DEFERRED) return;
+    // In the clear, like the deferred answer: the client learns the outcome
+    // before its traffic is encrypted
+    const char* reply = result == Custom1LoginResult::STORED ? CUSTOM1_REPLY_OK : CUSTOM1_REPLY_LOGIN_FAILED;
+    net_send(req.client_fd, reply, strlen(reply));
+}
+
+// Every Custom1 message the server understands. To add one, declare its
+// struct and custom1::Codec, write a handler taking the decoded message and
+// sending its reply, and list it here; CUSTOM1_ANY_VERSION matches versions
+// without their own entry.
+constexpr Custom1Route CUSTOM1_ROUTE_LIST[] = {
+    {0x501, CUSTOM1_ANY_VERSION, decode_then<Custom1PacketCodec, route_login>},
+};
+constexpr Custom1RouteTable<sizeof(CUSTOM1_ROUTE_LIST) / sizeof(CUSTOM1_ROUTE_LIST[0])> CUSTOM1_ROUTES(CUSTOM1_ROUTE_LIST);
+} // namespace
+
 /**
  * Example packet and it's custom format:
  *
@@ -186,10 +305,10 @@ void handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std
  * 31443538333746463532313545413135434432333341303546313141363139423144394433333541373538433937454533424637443441414630303645313044394445434241354245384337374230424634433437433834423338364642414633303230424337334245333131434530314132343446324445313133314530343937303542393546463543373133383136373731323645384330414235463941343432413545384332393038433344444342394441434436323732433244323037324635344646363642393146373235373441423336453042393736373435353044413737373730453431394638444233304330413741383243413835373532
  * 0004 // Length of the next field (2 bytes)
  * 32313736
- * fea31c19 // CRC32 checksum (4 bytes) - 0x1c19fea3
+ * fea31c19 // Trailer (4 bytes); every capture so far ends in these bytes, so its algorithm is unknown
  */
 
-bool handle_custom1_packet(int client_fd, const std::string &data, int connection_id)
+bool handle_custom1_packet(int client_fd, std::string_view data, int connection_id, ConnContext* ctx)
 {
 
     // Log the received data in hex for debugging with local port it was received on
@@ -197,17 +316,14 @@ bool handle_custom1_packet(int client_fd, const std::string &data, int connectio
     socklen_t addr_len = sizeof(addr);
     if (getpeername(client_fd, (struct sockaddr *)&addr, &addr_len) < 0)
     {
-        LOG_ERROR("Failed to get peer name for client_fd " + std::to_string(client_fd));
+        LOG_ERROR_PARTS("Failed to get peer name for client_fd ", client_fd);
         return false;
     }
-    std::string hex_data;
-    for (unsigned char c : data)
-    {
-        char hex[3];
-        snprintf(hex, sizeof(hex), "%02x", c);
-        hex_data += hex;
-    }
-    LOG("Received Custom Protocol 1 packet from " + std::string(inet_ntoa(addr.sin_addr)) + ":" + std::to_string(ntohs(addr.sin_port)) + " - Data: " + hex_data);
+    // Scratch for this frame only; the dispatcher rewinds the arena after it
+    char* hex_data = RequestArena::local().allocate_array<char>(2 * data.size());
+    hex_encode(reinterpret_cast<const uint8_t*>(data.data()), data.size(), hex_data);
+    LOG_PARTS("Received Custom Protocol 1 packet from ", inet_ntoa(addr.sin_addr), ':', ntohs(addr.sin_port),
+              " - Data: ", std::string_view(hex_data, 2 * data.size()));
 
     // Check the message id (first 2 bytes)
     if (data.size() < 2)
@@ -218,41 +334,24 @@ bool handle_custom1_packet(int client_fd, const std::string &data, int connectio
     uint16_t message_id = (static_cast<uint8_t>(data[0]) << 8) | static_cast<uint8_t>(data[1]);
 
     // Log the message ID
-    LOG("Custom Protocol 1 packet message ID: " + std::to_string(message_id));
+    LOG_PARTS("Custom Protocol 1 packet message ID: ", message_id);
 
-    // Try to parse and log the packet
-    std::vector<uint8_t> buf(data.begin(), data.end());
-    static Custom1PacketPacker packer; // Use the new class
-    try
+    // Opt-in: real clients' trailers don't match CRC-32 (see
+    // set_custom1_verify_crc). When on, mismatches stop here, before any
+    // decoding or RSA work.
+    if (verify_crc && !custom1_crc_valid(data))
     {
-        Custom1Packet pkt = packer.unpack(buf);
-        LOG("Parsed Custom Protocol 1 packet:");
-        LOG("  Message ID: " + std::to_string(pkt.message_id));
-        LOG("  Packet Length: " + std::to_string(pkt.packet_length));
-        LOG("  Version: " + std::to_string(pkt.reserved1));
-        LOG("  Reserved1: " + std::to_string(pkt.reserved1));
-        LOG("  Packet Length 4: " + std::to_string(pkt.packet_length_4));
-        LOG("  Field1 Length: " + std::to_string(pkt.field1.size()));
-        LOG("  Field1 Data: " + std::string(pkt.field1.begin(), pkt.field1.end()));
-        LOG("  Reserved2: " + std::to_string(pkt.reserved2));
-        LOG("  Field2 Length: " + std::to_string(pkt.field2.size()));
-        LOG("  Field2 Data: " + std::string(pkt.field2.begin(), pkt.field2.end()));
-        if (pkt.message_id == 0x501)
-        {
-            handle_custom1_login(pkt, connection_id);
-        }
-        else
-        {
-            LOG_ERROR("Custom Protocol 1 message ID " + std::to_string(pkt.message_id) + " not yet supported");
-        }
+        LOG_ERROR_PARTS("Dropping Custom Protocol 1 packet with bad CRC32 from ", inet_ntoa(addr.sin_addr));
+        return false;
     }
-    catch (const std::runtime_error &e)
+    uint16_t version = data.size() >= 6 ? read_u16(reinterpret_cast<const uint8_t*>(data.data()) + 4) : CUSTOM1_ANY_VERSION;
+    Custom1Handler handler = CUSTOM1_ROUTES.find(message_id, version);
+    if (handler)
     {
-        LOG_ERROR("Failed to unpack Custom Protocol 1 packet: " + std::string(e.what()));
-        return false;
+        // The handler answers the frame itself
+        return handler(Custom1Request{client_fd, connection_id, data, ctx});
     }
-    // Placeholder: always respond with a static message
-    const char *msg = "Custom Protocol 1 Connected\n";
-    send(client_fd, msg, strlen(msg), 0);
+    LOG_ERROR_PARTS("Custom Protocol 1 message ID ", message_id, " not yet supported");
+    send_reply(client_fd, ctx, CUSTOM1_REPLY_OK, sizeof(CUSTOM1_REPLY_OK) - 1);
     return true;
 }
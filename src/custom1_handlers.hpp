@@ -2,20 +2,67 @@
 #define CUSTOM1_HANDLERS_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <openssl/evp.h>
 #include "connection_manager.hpp"
+#include "crypto_pool.hpp"
 #include "custom1_packet.hpp"
 
-// Handles Custom Protocol 1 packets. Returns true if handled, false otherwise.
-bool handle_custom1_packet(int client_fd, const std::string& data, int connection_id);
+struct ConnContext;
 
-// Handler for message_id 0x501 (login)
-void handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std::string& privkey_path = "data/private_key.pem");
+// Handles one complete Custom Protocol 1 frame. Returns true if handled,
+// false otherwise. ctx is the connection's dispatch state; once a login has
+// keyed its cipher, replies go out encrypted. The caller decrypts the frame
+// (see CUSTOM1_CLEAR_HEADER).
+bool handle_custom1_packet(int client_fd, std::string_view data, int connection_id, ConnContext* ctx = nullptr);
+
+// After a login keys the connection's cipher, each frame from the client is
+// encrypted from this offset on; the header before it (message id, lengths,
+// version) stays in the clear so frames can still be split and routed.
+// Replies are encrypted whole.
+#define CUSTOM1_CLEAR_HEADER 12
+
+// Placeholder replies until the real Custom1 responses are known. A 0x501 is
+// answered once its session key is stored (CUSTOM1_REPLY_OK) or can't be
+// (CUSTOM1_REPLY_LOGIN_FAILED); a message with no handler gets
+// CUSTOM1_REPLY_OK. A frame that fails to decode gets nothing.
+#define CUSTOM1_REPLY_OK "Custom Protocol 1 Connected\n"
+#define CUSTOM1_REPLY_LOGIN_FAILED "Custom Protocol 1 Login failed\n"
+
+#define CUSTOM1_PRIVATE_KEY_PATH "data/private_key.pem"
+
+// Pool that decrypts 0x501 logins for the key file it was built on, so the
+// worker never runs RSA itself. Null (the default) decrypts inline. Set
+// before the workers start.
+void set_custom1_crypto_pool(CryptoPool* pool);
+
+// Whether frames whose trailer isn't the CRC-32 of their bytes are dropped
+// before any handler runs. Off by default: the trailer on real client
+// frames is not that CRC (two different captured logins both end in
+// fea31c19), so turning it on drops every real login. Only for clients
+// known to send CRC-32. Set before the workers start.
+void set_custom1_verify_crc(bool verify);
+
+enum class Custom1LoginResult {
+    STORED,   // the session key is on the connection
+    DEFERRED, // being decrypted; the deferred answer is the login's reply
+    FAILED
+};
+
+// Handler for message_id 0x501 (login). The key comes from
+// KeyManager::shared(privkey_path), parsed once and reloaded on change. The
+// stored session key also keys ctx->cipher, if there is a ctx; a deferred
+// login keys the ConnContext its delivery hook is given instead.
+Custom1LoginResult handle_custom1_login(const Custom1PacketView &pkt, int connection_id, const std::string& privkey_path = CUSTOM1_PRIVATE_KEY_PATH,
+                                        ConnContext* ctx = nullptr);
+// Same, for an owned packet
+Custom1LoginResult handle_custom1_login(const Custom1Packet &pkt, int connection_id, const std::string& privkey_path = CUSTOM1_PRIVATE_KEY_PATH,
+                                        ConnContext* ctx = nullptr);
 
 // Helper: decode hex string to binary
 // Expose for testing
-bool hex_to_bin(const std::string& hex, std::vector<unsigned char>& out, std::string* err);
+bool hex_to_bin(std::string_view hex, std::vector<unsigned char>& out, std::string* err);
 
 // Helper: load private key from file
 // Expose for testing
@@ -2,11 +2,15 @@
 #define CUSTOM1_PACKET_HPP
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include "custom1_schema.hpp"
 
-// Helper to read BE values from a buffer
-inline uint16_t read_u16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
-inline uint32_t read_u32(const uint8_t* p) { return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+// Fixed part of a frame: the 12-byte header, the three field lengths,
+// reserved2 and the CRC
+#define CUSTOM1_FIXED_SIZE 24
 
 struct Custom1Packet {
     uint16_t message_id;
@@ -18,48 +22,122 @@ struct Custom1Packet {
     uint16_t reserved2;
     std::vector<uint8_t> field2;
     std::vector<uint8_t> field3;
+    // As received; pack() computes its own
     uint32_t crc32;
 };
 
+// A Custom1 frame without copies: the fields point into the buffer the view
+// was parsed from (or, for pack_into(), wherever the caller keeps them), so
+// the view must not outlive it. This is the 0x501 login layout, which every
+// frame shared before messages got their own schemas; Custom1PacketCodec
+// below declares it.
+struct Custom1PacketView {
+    uint16_t message_id = 0;
+    uint16_t packet_length = 0;
+    uint16_t version = 0;
+    uint16_t reserved1 = 0;
+    uint32_t packet_length_4 = 0;
+    std::string_view field1;
+    uint16_t reserved2 = 0;
+    std::string_view field2;
+    std::string_view field3;
+    // The trailer the frame carries, as sent
+    uint32_t crc32 = 0;
+
+    // Checks every field length against the buffer before reading it.
+    // Returns false with err set if the frame is cut short; bytes after the
+    // CRC are ignored. The CRC is read but not checked; see crc_valid().
+    bool parse(std::string_view buf, std::string* err);
+    // Whether the trailer is the CRC-32 of the bytes before it. buf is what
+    // parse() saw.
+    bool crc_valid(std::string_view buf) const;
+    // Bytes pack_into() writes; 0 if a field is too long for its 16-bit length
+    size_t packed_size() const;
+    // Writes the frame into out, ending in the crc32 member, or with
+    // fill_crc in the CRC-32 of the frame for a peer that checks it
+    // (OXIDE_CUSTOM1_VERIFY_CRC). Returns the bytes written, or 0 (nothing
+    // written) if capacity is short or a field is too long.
+    size_t pack_into(uint8_t* out, size_t capacity, bool fill_crc = false) const;
+
+    // A view of pkt's fields, for packing an owned packet
+    static Custom1PacketView of(const Custom1Packet& pkt) {
+        auto bytes = [](const std::vector<uint8_t>& v) {
+            return std::string_view(reinterpret_cast<const char*>(v.data()), v.size());
+        };
+        Custom1PacketView view;
+        view.message_id = pkt.message_id;
+        view.packet_length = pkt.packet_length;
+        view.version = pkt.version;
+        view.reserved1 = pkt.reserved1;
+        view.packet_length_4 = pkt.packet_length_4;
+        view.field1 = bytes(pkt.field1);
+        view.reserved2 = pkt.reserved2;
+        view.field2 = bytes(pkt.field2);
+        view.field3 = bytes(pkt.field3);
+        view.crc32 = pkt.crc32;
+        return view;
+    }
+};
+
+using Custom1PacketCodec = custom1::Codec<Custom1PacketView,
+    custom1::U16<&Custom1PacketView::message_id>,
+    custom1::U16<&Custom1PacketView::packet_length>,
+    custom1::U16<&Custom1PacketView::version>,
+    custom1::U16<&Custom1PacketView::reserved1>,
+    custom1::U32<&Custom1PacketView::packet_length_4>,
+    custom1::Bytes<&Custom1PacketView::field1>,
+    custom1::U16<&Custom1PacketView::reserved2>,
+    custom1::Bytes<&Custom1PacketView::field2>,
+    custom1::Bytes<&Custom1PacketView::field3>,
+    custom1::Crc32<&Custom1PacketView::crc32>>;
+static_assert(Custom1PacketCodec::fixed_size == CUSTOM1_FIXED_SIZE, "login layout changed size");
+
+inline bool Custom1PacketView::parse(std::string_view buf, std::string* err) {
+    return Custom1PacketCodec::decode(buf, *this, err) != 0;
+}
+
+inline bool Custom1PacketView::crc_valid(std::string_view buf) const {
+    return custom1_crc_swap(custom1_frame_crc(reinterpret_cast<const uint8_t*>(buf.data()), packed_size() - 4)) == crc32;
+}
+
+inline size_t Custom1PacketView::packed_size() const {
+    return Custom1PacketCodec::encoded_size(*this);
+}
+
+inline size_t Custom1PacketView::pack_into(uint8_t* out, size_t capacity, bool fill_crc) const {
+    return Custom1PacketCodec::encode(*this, out, capacity, fill_crc);
+}
+
+// Owning packets, kept for existing callers; built on Custom1PacketView.
+// Throws std::runtime_error on a malformed buffer or an oversized field.
 class Custom1PacketPacker {
 public:
     virtual ~Custom1PacketPacker() = default;
     virtual Custom1Packet unpack(const std::vector<uint8_t>& buf) const {
+        Custom1PacketView view;
+        std::string err;
+        if (!view.parse(std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size()), &err)) {
+            throw std::runtime_error(err);
+        }
+        auto bytes = [](std::string_view f) { return std::vector<uint8_t>(f.begin(), f.end()); };
         Custom1Packet pkt;
-        size_t offset = 0;
-        if (buf.size() < 18) throw std::runtime_error("Packet too short");
-        pkt.message_id = read_u16(&buf[offset]); offset += 2;
-        pkt.packet_length = read_u16(&buf[offset]); offset += 2;
-        pkt.version = read_u16(&buf[offset]); offset += 2;
-        pkt.reserved1 = read_u16(&buf[offset]); offset += 2;
-        pkt.packet_length_4 = read_u32(&buf[offset]); offset += 4;
-        uint16_t field1_len = read_u16(&buf[offset]); offset += 2;
-        pkt.field1.assign(buf.begin() + offset, buf.begin() + offset + field1_len); offset += field1_len;
-        pkt.reserved2 = read_u16(&buf[offset]); offset += 2;
-        uint16_t field2_len = read_u16(&buf[offset]); offset += 2;
-        pkt.field2.assign(buf.begin() + offset, buf.begin() + offset + field2_len); offset += field2_len;
-        uint16_t field3_len = read_u16(&buf[offset]); offset += 2;
-        pkt.field3.assign(buf.begin() + offset, buf.begin() + offset + field3_len); offset += field3_len;
-        pkt.crc32 = read_u32(&buf[offset]); offset += 4;
+        pkt.message_id = view.message_id;
+        pkt.packet_length = view.packet_length;
+        pkt.version = view.version;
+        pkt.reserved1 = view.reserved1;
+        pkt.packet_length_4 = view.packet_length_4;
+        pkt.field1 = bytes(view.field1);
+        pkt.reserved2 = view.reserved2;
+        pkt.field2 = bytes(view.field2);
+        pkt.field3 = bytes(view.field3);
+        pkt.crc32 = view.crc32;
         return pkt;
     }
     virtual std::vector<uint8_t> pack(const Custom1Packet& pkt) const {
-        std::vector<uint8_t> buf;
-        auto write_u16 = [&](uint16_t v) { buf.push_back(v >> 8); buf.push_back(v & 0xFF); };
-        auto write_u32 = [&](uint32_t v) { buf.push_back((v >> 24) & 0xFF); buf.push_back((v >> 16) & 0xFF); buf.push_back((v >> 8) & 0xFF); buf.push_back(v & 0xFF); };
-        write_u16(pkt.message_id);
-        write_u16(pkt.packet_length);
-        write_u16(pkt.version);
-        write_u16(pkt.reserved1);
-        write_u32(pkt.packet_length_4);
-        write_u16(pkt.field1.size());
-        buf.insert(buf.end(), pkt.field1.begin(), pkt.field1.end());
-        write_u16(pkt.reserved2);
-        write_u16(pkt.field2.size());
-        buf.insert(buf.end(), pkt.field2.begin(), pkt.field2.end());
-        write_u16(pkt.field3.size());
-        buf.insert(buf.end(), pkt.field3.begin(), pkt.field3.end());
-        write_u32(pkt.crc32);
+        Custom1PacketView view = Custom1PacketView::of(pkt);
+        std::vector<uint8_t> buf(view.packed_size());
+        if (buf.empty()) throw std::runtime_error("Field too long to pack");
+        view.pack_into(buf.data(), buf.size());
         return buf;
     }
 };
@@ -0,0 +1,272 @@
+#ifndef CUSTOM1_SCHEMA_HPP
+#define CUSTOM1_SCHEMA_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "crc32.hpp"
+
+// Helper to read BE values from a buffer
+inline uint16_t read_u16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+inline uint32_t read_u32(const uint8_t* p) { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+inline void write_u16(uint8_t* p, uint16_t v) { p[0] = v >> 8; p[1] = v & 0xFF; }
+inline void write_u32(uint8_t* p, uint32_t v) { p[0] = v >> 24; p[1] = (v >> 16) & 0xFF; p[2] = (v >> 8) & 0xFF; p[3] = v & 0xFF; }
+
+// CRC-32 over every byte before the trailer, sent with its 16-bit halves
+// swapped: 0x1c19fea3 goes on the wire as fea31c19. The swap is its own
+// inverse, so it converts both ways. Real clients' trailers are not this
+// CRC (see set_custom1_verify_crc), so it is only checked or written when
+// asked for.
+inline uint32_t custom1_crc_swap(uint32_t v) { return (v << 16) | (v >> 16); }
+inline uint32_t custom1_frame_crc(const uint8_t* frame, size_t len_before_crc) {
+    return crc32_update(0, frame, len_before_crc);
+}
+// Whether a whole frame's last four bytes are the CRC of the rest
+inline bool custom1_crc_valid(std::string_view frame) {
+    if (frame.size() < 4) return false;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(frame.data());
+    return custom1_frame_crc(p, frame.size() - 4) == custom1_crc_swap(read_u32(p + frame.size() - 4));
+}
+
+// Custom1 messages declared as field lists. A message is a plain struct; its
+// codec names the members in wire order:
+//
+//     using LoginCodec = custom1::Codec<Login, custom1::U16<&Login::message_id>,
+//                                       custom1::Bytes<&Login::username>, ...,
+//                                       custom1::Crc32<&Login::crc32>>;
+//
+// Decoding checks the fixed-size fields once up front, then each length
+// prefix against what is left. Bytes fields are string_views into the
+// buffer, so nothing is copied and the message must not outlive it.
+namespace custom1 {
+
+template <typename T> struct MemberOf;
+template <typename C, typename V> struct MemberOf<V C::*> { using type = V; };
+
+struct Reader {
+    const uint8_t* p;
+    const char* data;
+    size_t offset;
+    // Bytes left for length-prefixed fields after every fixed field
+    size_t budget;
+    // Length-prefixed fields read so far, for error messages
+    int prefixed;
+    std::string* err;
+};
+
+struct Writer {
+    uint8_t* out;
+    size_t offset;
+    // Crc32 fields write the CRC-32 of the bytes before them instead of
+    // their member
+    bool fill_crc;
+};
+
+// Big-endian unsigned integers
+template <auto Member>
+struct U16 {
+    static_assert(std::is_same<typename MemberOf<decltype(Member)>::type, uint16_t>::value, "U16 needs a uint16_t member");
+    static constexpr size_t fixed_size = 2;
+    template <typename M> static bool read(Reader& r, M& m) {
+        m.*Member = read_u16(r.p + r.offset);
+        r.offset += 2;
+        return true;
+    }
+    template <typename M> static bool fits(const M&) { return true; }
+    template <typename M> static size_t size(const M&) { return 2; }
+    template <typename M> static void write(Writer& w, const M& m) {
+        write_u16(w.out + w.offset, m.*Member);
+        w.offset += 2;
+    }
+};
+
+template <auto Member>
+struct U32 {
+    static_assert(std::is_same<typename MemberOf<decltype(Member)>::type, uint32_t>::value, "U32 needs a uint32_t member");
+    static constexpr size_t fixed_size = 4;
+    template <typename M> static bool read(Reader& r, M& m) {
+        m.*Member = read_u32(r.p + r.offset);
+        r.offset += 4;
+        return true;
+    }
+    template <typename M> static bool fits(const M&) { return true; }
+    template <typename M> static size_t size(const M&) { return 4; }
+    template <typename M> static void write(Writer& w, const M& m) {
+        write_u32(w.out + w.offset, m.*Member);
+        w.offset += 4;
+    }
+};
+
+// A 16-bit length followed by that many bytes
+template <auto Member>
+struct Bytes {
+    static_assert(std::is_same<typename MemberOf<decltype(Member)>::type, std::string_view>::value,
+                  "Bytes needs a std::string_view member");
+    static constexpr size_t fixed_size = 2;
+    template <typename M> static bool read(Reader& r, M& m) {
+        uint16_t len = read_u16(r.p + r.offset);
+        r.offset += 2;
+        ++r.prefixed;
+        if (len > r.budget) {
+            if (r.err) *r.err = "Field" + std::to_string(r.prefixed) + " length runs past the end of the packet";
+            return false;
+        }
+        r.budget -= len;
+        m.*Member = std::string_view(r.data + r.offset, len);
+        r.offset += len;
+        return true;
+    }
+    template <typename M> static bool fits(const M& m) { return (m.*Member).size() <= 0xFFFF; }
+    template <typename M> static size_t size(const M& m) { return 2 + (m.*Member).size(); }
+    template <typename M> static void write(Writer& w, const M& m) {
+        std::string_view f = m.*Member;
+        write_u16(w.out + w.offset, static_cast<uint16_t>(f.size()));
+        if (!f.empty()) std::memcpy(w.out + w.offset + 2, f.data(), f.size());
+        w.offset += 2 + f.size();
+    }
+};
+
+// The 4-byte trailer. Decoding stores it as sent and encoding writes the
+// member back, so a parsed frame packs to the same bytes; with fill_crc,
+// encoding writes the CRC-32 of every byte before it (see custom1_crc_swap)
+// instead.
+template <auto Member>
+struct Crc32 {
+    static_assert(std::is_same<typename MemberOf<decltype(Member)>::type, uint32_t>::value, "Crc32 needs a uint32_t member");
+    static constexpr size_t fixed_size = 4;
+    template <typename M> static bool read(Reader& r, M& m) {
+        m.*Member = read_u32(r.p + r.offset);
+        r.offset += 4;
+        return true;
+    }
+    template <typename M> static bool fits(const M&) { return true; }
+    template <typename M> static size_t size(const M&) { return 4; }
+    template <typename M> static void write(Writer& w, const M& m) {
+        write_u32(w.out + w.offset, w.fill_crc ? custom1_crc_swap(custom1_frame_crc(w.out, w.offset)) : m.*Member);
+        w.offset += 4;
+    }
+};
+
+template <typename Msg, typename... Fields>
+struct Codec {
+    static_assert(sizeof...(Fields) > 0, "a message needs at least one field");
+    using Message = Msg;
+    // Bytes every encoding of the message has, whatever its field contents
+    static constexpr size_t fixed_size = (Fields::fixed_size + ...);
+
+    // Fills msg from the start of buf. Returns the bytes the message took
+    // (anything after them is left alone), or 0 with err set if buf is cut
+    // short.
+    static size_t decode(std::string_view buf, Msg& msg, std::string* err) {
+        if (buf.size() < fixed_size) {
+            if (err) *err = "Packet too short";
+            return 0;
+        }
+        Reader r{reinterpret_cast<const uint8_t*>(buf.data()), buf.data(), 0, buf.size() - fixed_size, 0, err};
+        // Left to right, stopping at the first failure
+        if (!(Fields::read(r, msg) && ...)) return 0;
+        return r.offset;
+    }
+
+    // Bytes encode() writes; 0 if a field is too long for its 16-bit length
+    static size_t encoded_size(const Msg& msg) {
+        if (!(Fields::fits(msg) && ...)) return 0;
+        return (Fields::size(msg) + ...);
+    }
+
+    // Returns the bytes written, or 0 (nothing written) if capacity is short
+    // or a field is too long. fill_crc computes Crc32 fields (see Crc32).
+    static size_t encode(const Msg& msg, uint8_t* out, size_t capacity, bool fill_crc = false) {
+        size_t size = encoded_size(msg);
+        if (size == 0 || size > capacity) return 0;
+        Writer w{out, 0, fill_crc};
+        (Fields::write(w, msg), ...);
+        return size;
+    }
+};
+
+} // namespace custom1
+
+// Matches a message whatever its version
+#define CUSTOM1_ANY_VERSION 0xFFFF
+
+struct ConnContext;
+
+// One complete frame and where it came from
+struct Custom1Request {
+    int client_fd;
+    int connection_id;
+    std::string_view frame;
+    // The connection's dispatch state; null outside a worker
+    ConnContext* ctx;
+};
+
+// Returns false if the frame couldn't be decoded
+using Custom1Handler = bool (*)(const Custom1Request&);
+
+struct Custom1Route {
+    uint16_t message_id;
+    uint16_t version;
+    Custom1Handler handler;
+};
+
+// Handlers keyed by (message_id, version), sorted when the table is built
+// so a lookup is a short binary search over one or two cache lines. Build
+// it constexpr; a duplicate key then fails to compile.
+template <size_t N>
+class Custom1RouteTable {
+public:
+    constexpr explicit Custom1RouteTable(const Custom1Route (&routes)[N]) : routes_() {
+        for (size_t i = 0; i < N; ++i) {
+            // Insertion sort; std::sort isn't constexpr until C++20
+            size_t j = i;
+            while (j > 0 && less(routes[i], routes_[j - 1])) {
+                routes_[j] = routes_[j - 1];
+                --j;
+            }
+            routes_[j] = routes[i];
+        }
+        for (size_t i = 1; i < N; ++i) {
+            if (!less(routes_[i - 1], routes_[i])) throw "duplicate Custom1 route";
+        }
+    }
+
+    // The handler for this exact version, else the one for any version
+    // (nullptr if neither)
+    constexpr Custom1Handler find(uint16_t message_id, uint16_t version) const {
+        Custom1Handler exact = lookup(message_id, version);
+        return exact ? exact : lookup(message_id, CUSTOM1_ANY_VERSION);
+    }
+
+    constexpr size_t size() const { return N; }
+
+private:
+    static constexpr bool less(const Custom1Route& a, const Custom1Route& b) {
+        return a.message_id != b.message_id ? a.message_id < b.message_id : a.version < b.version;
+    }
+
+    constexpr Custom1Handler lookup(uint16_t message_id, uint16_t version) const {
+        Custom1Route key{message_id, version, nullptr};
+        size_t lo = 0;
+        size_t hi = N;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (less(routes_[mid], key)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < N && routes_[lo].message_id == message_id && routes_[lo].version == version) return routes_[lo].handler;
+        return nullptr;
+    }
+
+    std::array<Custom1Route, N> routes_;
+};
+
+#endif // CUSTOM1_SCHEMA_HPP
@@ -1,10 +1,102 @@
 #include "custom2_handlers.hpp"
-#include <cstring>
-#include <sys/socket.h>
+#include "custom2_protocol.hpp"
+#include "logger.hpp"
+#include "session_manager.hpp"
 
-bool handle_custom2_packet(int client_fd, const std::string& data) {
-    // Placeholder: always respond with a static message
-    const char* msg = "Custom Protocol 2 Connected\n";
-    send(client_fd, msg, strlen(msg), 0);
+extern SessionManager session_manager;
+
+namespace {
+struct Custom2Request {
+    int client_fd;
+    const Custom2Frame& frame;
+    // Empty unless the route needs a login
+    std::string_view customer_id;
+};
+
+// False if it answered with an error
+using Custom2Handler = bool (*)(const Custom2Request& req, std::string& replies);
+
+struct Custom2Route {
+    uint16_t type;
+    bool needs_auth;
+    Custom2Handler handler;
+};
+
+void reply(std::string& replies, const Custom2Request& req, std::string_view payload) {
+    custom2_append_frame(replies, req.frame.type | CUSTOM2_REPLY, req.frame.seq, payload);
+}
+
+void reply_error(std::string& replies, uint16_t seq, std::string_view reason) {
+    custom2_append_frame(replies, CUSTOM2_ERROR, seq, reason);
+}
+
+bool route_ping(const Custom2Request& req, std::string& replies) {
+    reply(replies, req, req.frame.payload);
     return true;
 }
+
+// The ticket is the session id /AuthLogin handed out, so a client logs in
+// here with the same SessionManager entry its Custom1 login uses
+bool route_auth(const Custom2Request& req, std::string& replies) {
+    auto customer_id = session_manager.get(std::string(req.frame.payload));
+    if (!customer_id) {
+        LOG_ERROR_PARTS("Custom Protocol 2 AUTH with an unknown ticket on fd ", req.client_fd);
+        reply_error(replies, req.frame.seq, "unknown ticket");
+        return false;
+    }
+    bool stored = false;
+    custom2_conn_mgr.update_connection(req.client_fd, [&](ConnectionInfo& info) {
+        info.customer_id = *customer_id;
+        stored = true;
+    });
+    if (!stored) {
+        LOG_ERROR_PARTS("Custom Protocol 2 fd ", req.client_fd, " is not a registered connection");
+        reply_error(replies, req.frame.seq, "connection not registered");
+        return false;
+    }
+    LOG_PARTS("Custom Protocol 2 fd ", req.client_fd, " authenticated as customer ", *customer_id);
+    reply(replies, req, *customer_id);
+    return true;
+}
+
+bool route_whoami(const Custom2Request& req, std::string& replies) {
+    reply(replies, req, req.customer_id);
+    return true;
+}
+
+// Every Custom2 message the server understands. To add one, give it a type
+// in custom2_protocol.hpp, write a handler that appends its reply, and list
+// it here.
+constexpr Custom2Route CUSTOM2_ROUTES[] = {
+    {CUSTOM2_PING, false, route_ping},
+    {CUSTOM2_AUTH, false, route_auth},
+    {CUSTOM2_WHOAMI, true, route_whoami},
+};
+
+const Custom2Route* find_route(uint16_t type) {
+    for (const Custom2Route& route : CUSTOM2_ROUTES) {
+        if (route.type == type) return &route;
+    }
+    return nullptr;
+}
+} // namespace
+
+bool handle_custom2_frame(int client_fd, std::string_view frame, std::string& replies) {
+    Custom2Frame parsed = custom2_parse_frame(frame);
+    const Custom2Route* route = find_route(parsed.type);
+    if (!route) {
+        LOG_ERROR_PARTS("Custom Protocol 2 message type ", parsed.type, " not supported (fd ", client_fd, ")");
+        reply_error(replies, parsed.seq, "unknown message type");
+        return false;
+    }
+    std::string customer_id;
+    if (route->needs_auth) {
+        auto conn = custom2_conn_mgr.get_connection(client_fd);
+        if (!conn || conn->customer_id.empty()) {
+            reply_error(replies, parsed.seq, "not authenticated");
+            return false;
+        }
+        customer_id = std::move(conn->customer_id);
+    }
+    return route->handler(Custom2Request{client_fd, parsed, customer_id}, replies);
+}
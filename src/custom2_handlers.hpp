@@ -2,8 +2,18 @@
 #define CUSTOM2_HANDLERS_HPP
 
 #include <string>
+#include <string_view>
+#include "connection_manager.hpp"
 
-// Handles Custom Protocol 2 packets. Returns true if handled, false otherwise.
-bool handle_custom2_packet(int client_fd, const std::string& data);
+// Handles one complete Custom Protocol 2 frame (see custom2_protocol.hpp)
+// and appends its reply to `replies`, which the dispatcher sends once the
+// read is used up. frame points into the connection's receive buffer and is
+// only valid during the call. Returns false if the frame was answered with
+// an error.
+bool handle_custom2_frame(int client_fd, std::string_view frame, std::string& replies);
+
+// Custom2 connections by fd; customer_id is set once AUTH succeeds. Global
+// instance for all translation units.
+extern ConnectionManager custom2_conn_mgr;
 
 #endif // CUSTOM2_HANDLERS_HPP
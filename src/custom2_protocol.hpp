@@ -0,0 +1,59 @@
+#ifndef CUSTOM2_PROTOCOL_HPP
+#define CUSTOM2_PROTOCOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "custom1_schema.hpp"
+
+// Every Custom Protocol 2 frame, either way, is an 8-byte header and its
+// payload; all fields are big-endian:
+//
+//   u8  marker       always CUSTOM2_MARKER
+//   u8  reserved     0
+//   u16 type         message type; a reply carries the request's | CUSTOM2_REPLY
+//   u16 seq          picked by the client and echoed in the reply
+//   u16 payload_len  bytes after the header
+//
+// The marker is above 0x1f, so protocol sniffing never takes a frame for an
+// NPS header and routes it to the listener's own protocol.
+#define CUSTOM2_HEADER_SIZE 8
+#define CUSTOM2_MARKER 0xC2
+#define CUSTOM2_REPLY 0x8000
+
+// Message types
+#define CUSTOM2_PING 0x0001   // payload echoed back; needs no login
+#define CUSTOM2_AUTH 0x0002   // payload is an /AuthLogin ticket; the reply carries the customer id
+#define CUSTOM2_WHOAMI 0x0003 // the reply carries the customer id; needs AUTH first
+#define CUSTOM2_ERROR 0xFFFF  // reply only; the payload says why
+
+// One frame without copies: the payload points into the buffer the frame
+// was parsed from
+struct Custom2Frame {
+    uint16_t type = 0;
+    uint16_t seq = 0;
+    std::string_view payload;
+};
+
+// frame is one complete frame, as measured by custom2_frame_length()
+inline Custom2Frame custom2_parse_frame(std::string_view frame) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(frame.data());
+    Custom2Frame parsed;
+    parsed.type = read_u16(p + 2);
+    parsed.seq = read_u16(p + 4);
+    parsed.payload = frame.substr(CUSTOM2_HEADER_SIZE, read_u16(p + 6));
+    return parsed;
+}
+
+// Appends a frame to out. A payload longer than 16 bits can carry is cut.
+inline void custom2_append_frame(std::string& out, uint16_t type, uint16_t seq, std::string_view payload) {
+    if (payload.size() > 0xFFFF) payload = payload.substr(0, 0xFFFF);
+    uint8_t header[CUSTOM2_HEADER_SIZE] = {CUSTOM2_MARKER, 0};
+    write_u16(header + 2, type);
+    write_u16(header + 4, seq);
+    write_u16(header + 6, static_cast<uint16_t>(payload.size()));
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    out.append(payload.data(), payload.size());
+}
+
+#endif // CUSTOM2_PROTOCOL_HPP
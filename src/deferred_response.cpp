@@ -0,0 +1,44 @@
+#include "deferred_response.hpp"
+
+namespace {
+thread_local DeferScope* current_scope = nullptr;
+}
+
+DeferScope::DeferScope(DeferredSink& sink, int fd, uint64_t conn_id)
+    : prev_(current_scope), sink_(sink), fd_(fd), conn_id_(conn_id) {
+    current_scope = this;
+}
+
+DeferScope::~DeferScope() {
+    current_scope = prev_;
+}
+
+bool can_defer_response() {
+    return current_scope != nullptr;
+}
+
+bool defer_response(TaskPool& pool, std::function<std::string()> job) {
+    DeferScope* scope = current_scope;
+    if (!scope) return false;
+    DeferredSink* sink = &scope->sink_;
+    int fd = scope->fd_;
+    uint64_t conn_id = scope->conn_id_;
+    std::function<void()> task = [sink, fd, conn_id, job = std::move(job)] {
+        sink->post_deferred(fd, conn_id, job(), nullptr);
+    };
+    if (!pool.submit(task)) return false;
+    scope->deferred_ = true;
+    return true;
+}
+
+DeferredReply defer_reply() {
+    DeferScope* scope = current_scope;
+    scope->deferred_ = true;
+    return DeferredReply(&scope->sink_, scope->fd_, scope->conn_id_);
+}
+
+bool take_deferred() {
+    if (!current_scope || !current_scope->deferred_) return false;
+    current_scope->deferred_ = false;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef DEFERRED_RESPONSE_HPP
+#define DEFERRED_RESPONSE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "task_pool.hpp"
+
+struct ConnContext;
+
+// Lets a handler answer its request from another thread (see TaskPool)
+// instead of blocking the I/O worker. The worker stops dispatching that
+// connection's input until the answer is back, so pipelined requests are
+// still answered in order.
+
+// Takes answers back to the worker that owns the connection; implemented by
+// Worker
+class DeferredSink {
+public:
+    // Runs on the worker's thread just before the answer goes out, and only
+    // if its connection is still open, so per-connection state (including
+    // the connection's own ConnContext) can be updated without racing a
+    // close and fd reuse
+    using DeliveryHook = std::function<void(ConnContext&)>;
+    // Thread-safe; the worker delivers the response on its own thread
+    virtual void post_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) = 0;
+protected:
+    ~DeferredSink() = default;
+};
+
+// Answers one deferred request from any thread; see defer_reply()
+class DeferredReply {
+public:
+    // Thread-safe; call exactly once
+    void post(std::string response, DeferredSink::DeliveryHook on_delivery = nullptr) const {
+        sink_->post_deferred(fd_, conn_id_, std::move(response), std::move(on_delivery));
+    }
+private:
+    DeferredReply(DeferredSink* sink, int fd, uint64_t conn_id) : sink_(sink), fd_(fd), conn_id_(conn_id) {}
+    DeferredSink* sink_;
+    int fd_;
+    uint64_t conn_id_;
+    friend DeferredReply defer_reply();
+};
+
+// Installed by the worker around dispatch of one connection's input. Scopes
+// nest, like SendCapture.
+class DeferScope {
+public:
+    DeferScope(DeferredSink& sink, int fd, uint64_t conn_id);
+    ~DeferScope();
+    DeferScope(const DeferScope&) = delete;
+    DeferScope& operator=(const DeferScope&) = delete;
+private:
+    DeferScope* prev_;
+    DeferredSink& sink_;
+    int fd_;
+    uint64_t conn_id_;
+    bool deferred_ = false;
+    friend bool can_defer_response();
+    friend bool defer_response(TaskPool&, std::function<std::string()>);
+    friend bool take_deferred();
+    friend DeferredReply defer_reply();
+};
+
+// True when the request being handled can be answered later
+bool can_defer_response();
+// Runs job on pool and answers the current request with what it returns.
+// False if there is no DeferScope or the pool's queue is full; the handler
+// must then answer itself.
+bool defer_response(TaskPool& pool, std::function<std::string()> job);
+// Marks the current request as deferred and returns the handle its answer
+// goes through, for work that isn't a TaskPool job. Only call when
+// can_defer_response().
+DeferredReply defer_reply();
+// Whether the request just handled was deferred; clears the flag
+bool take_deferred();
+
+#endif // DEFERRED_RESPONSE_HPP
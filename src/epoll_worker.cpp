@@ -0,0 +1,213 @@
+#include "epoll_worker.hpp"
+#include "logger.hpp"
+#include "protocol_dispatch.hpp"
+#include "net_io.hpp"
+#include "buffer_pool.hpp"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#define READ_CHUNK 4096
+
+EpollWorker::~EpollWorker() {
+    for (const auto& [fd, conn] : connections_) {
+        on_connection_closed(fd, conn.protocol);
+        close(fd);
+    }
+}
+
+void EpollWorker::run() {
+    pin_thread();
+    listener_queued_.assign(listeners_.size(), false);
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        loop_.add(listeners_[i].first, EPOLLIN, [this, i](uint32_t) { mark_listener_ready(i); });
+    }
+    loop_.add(wake_fd_, EPOLLIN, [this](uint32_t) { on_wake(); });
+    LOG("Worker " + std::to_string(id_) + " (epoll) serving " + std::to_string(listeners_.size()) + " listeners" +
+        (cpu_ >= 0 ? " on CPU " + std::to_string(cpu_) : std::string()));
+    while (true) {
+        // Don't sleep while a listener still has a backlog to work through
+        if (!loop_.run_once(ready_listeners_.empty() ? timer_timeout_ms() : 0)) break;
+        service_listeners();
+        run_timers();
+        end_pass();
+        if (draining() && connections_.empty()) break;
+    }
+    loop_.remove(wake_fd_);
+    if (draining()) LOG("Worker " + std::to_string(id_) + " drained");
+}
+
+void EpollWorker::stop_accepting() {
+    for (const auto& listener : listeners_) loop_.remove(listener.first);
+    ready_listeners_.clear();
+    listener_queued_.assign(listeners_.size(), false);
+}
+
+void EpollWorker::close_all() {
+    std::vector<int> fds;
+    fds.reserve(connections_.size());
+    for (const auto& entry : connections_) fds.push_back(entry.first);
+    for (int fd : fds) close_connection(fd);
+}
+
+void EpollWorker::mark_listener_ready(size_t listener_index) {
+    if (listener_queued_[listener_index]) return;
+    listener_queued_[listener_index] = true;
+    ready_listeners_.push_back(listener_index);
+}
+
+void EpollWorker::service_listeners() {
+    // A listener that used its whole budget goes to the back of the queue,
+    // so a flood on one port (e.g. HTTP) cannot starve the others
+    for (size_t n = ready_listeners_.size(); n > 0; --n) {
+        size_t index = ready_listeners_.front();
+        ready_listeners_.pop_front();
+        if (accept_connections(index)) {
+            listener_queued_[index] = false;
+        } else {
+            ready_listeners_.push_back(index);
+        }
+    }
+}
+
+bool EpollWorker::accept_connections(size_t listener_index) {
+    int listener_fd = listeners_[listener_index].first;
+    Protocol listener_protocol = listeners_[listener_index].second;
+    Protocol protocol = initial_protocol(listener_protocol);
+    // Edge-triggered: accept until the queue would block or the budget is spent
+    for (int accepted = 0; accepted < config_.accept_budget; ++accepted) {
+        sockaddr_in client_addr{};
+        socklen_t addrlen = sizeof(client_addr);
+        int client_fd = accept4(listener_fd, (sockaddr*)&client_addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return true;
+        }
+        if (!admit(client_fd, protocol, connections_.size())) continue;
+        LOG_PARTS("New connection on local port ", ntohs(client_addr.sin_port), " from ", inet_ntoa(client_addr.sin_addr), " (",
+                  protocol_name(listener_protocol), ")");
+        auto [it, inserted] = connections_.try_emplace(client_fd, client_fd, protocol, listener_protocol, client_addr);
+        arm_timers(it->second.timers, client_fd);
+        if (protocol != Protocol::UNKNOWN) on_protocol_known(client_fd, protocol, it->second.timers, it->second.ctx);
+        // EPOLLOUT only fires on edges, so it can stay registered for draining output
+        if (!loop_.add(client_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP, [this, client_fd](uint32_t events) {
+                on_client_event(client_fd, events);
+            })) {
+            close_connection(client_fd);
+        }
+    }
+    return false;
+}
+
+void EpollWorker::on_client_event(int client_fd, uint32_t events) {
+    auto it = connections_.find(client_fd);
+    if (it == connections_.end()) return;
+    Connection& conn = it->second;
+    bool peer_closed = (events & (EPOLLHUP | EPOLLERR)) != 0;
+    bool readable = (events & ~static_cast<uint32_t>(EPOLLOUT)) != 0;
+    // A connection waiting on a deferred answer leaves its input in the kernel
+    if (readable && !conn.closing && !conn.reading_paused && !conn.ctx.awaiting_response) read_input(conn, peer_closed);
+    if (!flush_output(conn)) {
+        close_connection(client_fd);
+        return;
+    }
+    // Edge-triggered: input that arrived while paused raised no new event, so
+    // keep reading here until the input runs dry or the output backs up again
+    while (conn.reading_paused && !conn.closing && !conn.ctx.awaiting_response && conn.outq.size() <= static_cast<size_t>(config_.output_low_watermark)) {
+        conn.reading_paused = false;
+        read_input(conn, peer_closed);
+        if (!flush_output(conn)) {
+            close_connection(client_fd);
+            return;
+        }
+    }
+    if (conn.closing && conn.outq.empty()) {
+        LOG_PARTS("Handled connection on port ", ntohs(conn.peer.sin_port), " (", protocol_name(conn.protocol), ")");
+        close_connection(client_fd);
+    }
+}
+
+void EpollWorker::read_input(Connection& conn, bool peer_closed) {
+    // Responses to everything dispatched in this pass go out as one buffer,
+    // recycled through the BufferPool once written
+    std::string out = BufferPool::acquire_string();
+    ConnAction action = ConnAction::KEEP_READING;
+    {
+        SendCapture capture(conn.fd, out);
+        // Edge-triggered: read everything available before going back to epoll,
+        // dispatching complete requests as they are buffered
+        while (!peer_closed) {
+            if (conn.outq.size() + out.size() > static_cast<size_t>(config_.output_high_watermark)) {
+                // The client isn't draining; leave its input in the kernel
+                conn.reading_paused = true;
+                break;
+            }
+            ssize_t bytes = recv(conn.fd, conn.inbuf.prepare(READ_CHUNK), READ_CHUNK, 0);
+            if (bytes > 0) {
+                conn.inbuf.commit(bytes);
+                if (!conn.got_first_byte) {
+                    conn.got_first_byte = true;
+                    auto now = OverloadController::Clock::now();
+                    overload_.on_sample(now, now - conn.accepted_at);
+                }
+                size_t buffered = conn.inbuf.size();
+                action = dispatch(conn.fd, conn.protocol, conn.listener_protocol, conn.inbuf, false, conn.timers, conn.ctx);
+                on_activity(conn.timers, conn.protocol, conn.inbuf.size() < buffered);
+                if (action == ConnAction::CLOSE || conn.ctx.awaiting_response) break;
+                continue;
+            }
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) peer_closed = true;
+            break;
+        }
+        if (peer_closed && action != ConnAction::CLOSE) {
+            action = dispatch(conn.fd, conn.protocol, conn.listener_protocol, conn.inbuf, true, conn.timers, conn.ctx);
+        }
+    }
+    conn.outq.push(std::move(out));
+    if (action == ConnAction::CLOSE) conn.closing = true;
+}
+
+void EpollWorker::deliver_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) {
+    auto it = connections_.find(fd);
+    // Closed (or reaped) while the answer was being computed
+    if (it == connections_.end() || it->second.ctx.id != conn_id || !it->second.ctx.awaiting_response) return;
+    Connection& conn = it->second;
+    std::string out = BufferPool::acquire_string();
+    ConnAction action;
+    {
+        SendCapture capture(fd, out);
+        action = resume(fd, conn.protocol, conn.inbuf, conn.ctx, std::move(response), std::move(on_delivery));
+    }
+    conn.outq.push(std::move(out));
+    if (action == ConnAction::CLOSE) conn.closing = true;
+    // Input that arrived meanwhile raised its edge already; read it now
+    on_client_event(fd, EPOLLIN);
+}
+
+bool EpollWorker::flush_output(Connection& conn) {
+    if (conn.outq.empty()) return true;
+    size_t queued = conn.outq.size();
+    OutputQueue::FlushResult result = conn.outq.flush(conn.fd);
+    if (result == OutputQueue::FlushResult::FAILED) return false;
+    // A slow reader that is still draining isn't idle
+    if (result == OutputQueue::FlushResult::BLOCKED && conn.outq.size() < queued) {
+        on_activity(conn.timers, conn.protocol, false);
+    }
+    return true;
+}
+
+void EpollWorker::close_connection(int client_fd) {
+    auto it = connections_.find(client_fd);
+    if (it == connections_.end()) return;
+    on_connection_closed(client_fd, it->second.protocol);
+    loop_.remove(client_fd);
+    connections_.erase(it);
+    close(client_fd);
+}
@@ -0,0 +1,70 @@
+#ifndef EPOLL_WORKER_HPP
+#define EPOLL_WORKER_HPP
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+#include "event_loop.hpp"
+#include "output_queue.hpp"
+#include "stream_buffer.hpp"
+#include "worker.hpp"
+
+// Worker driven by the edge-triggered epoll EventLoop (the default backend)
+class EpollWorker : public Worker {
+public:
+    EpollWorker(int id, int cpu, const ServerConfig& config = ServerConfig()) : Worker(id, cpu, config) {}
+    ~EpollWorker() override;
+    void run() override;
+
+private:
+    // A client socket, the bytes received on it but not yet dispatched, and
+    // the responses not yet written
+    struct Connection {
+        // Everything else starts empty, so a new member needs no change here
+        Connection(int fd, Protocol protocol, Protocol listener_protocol, const sockaddr_in& peer)
+            : fd(fd), protocol(protocol), listener_protocol(listener_protocol), peer(peer),
+              accepted_at(OverloadController::Clock::now()) {}
+
+        int fd;
+        // UNKNOWN until sniffed from the first bytes
+        Protocol protocol;
+        Protocol listener_protocol;
+        sockaddr_in peer;
+        StreamBuffer inbuf;
+        OverloadController::Clock::time_point accepted_at;
+        bool got_first_byte = false;
+        ConnTimers timers;
+        ConnContext ctx;
+        OutputQueue outq;
+        // Output is above the high watermark; reading resumes below the low one
+        bool reading_paused = false;
+        // No more input is processed; close once output is flushed
+        bool closing = false;
+    };
+
+    void mark_listener_ready(size_t listener_index);
+    // One round-robin pass over ready listeners, each limited to the accept budget
+    void service_listeners();
+    // Returns true once the listener's accept queue is drained
+    bool accept_connections(size_t listener_index);
+    void on_client_event(int client_fd, uint32_t events);
+    // Reads and dispatches until EAGAIN, the peer closes, or output backs up
+    void read_input(Connection& conn, bool peer_closed);
+    // Returns false if the peer is gone
+    bool flush_output(Connection& conn);
+    void close_connection(int client_fd);
+    void reap(int fd) override { close_connection(fd); }
+    void stop_accepting() override;
+    void close_all() override;
+    void deliver_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) override;
+
+    std::unordered_map<int, Connection> connections_;
+    // Listeners with connections still waiting in their accept queue
+    std::deque<size_t> ready_listeners_;
+    std::vector<bool> listener_queued_;
+    EventLoop loop_;
+};
+
+#endif // EPOLL_WORKER_HPP
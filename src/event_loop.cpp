@@ -0,0 +1,82 @@
+#include "event_loop.hpp"
+#include "logger.hpp"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define MAX_EVENTS 256
+
+EventLoop::EventLoop() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        LOG_ERROR("epoll_create1 failed: " + std::string(strerror(errno)));
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+}
+
+bool EventLoop::add(int fd, uint32_t events, Callback cb) {
+    auto handler = std::make_unique<Handler>(Handler{fd, ++next_generation_, std::move(cb)});
+    epoll_event ev{};
+    ev.events = events | EPOLLET;
+    // Pack the generation next to the fd so a stale event for a closed and
+    // reused fd number is never delivered to the new owner.
+    ev.data.u64 = (static_cast<uint64_t>(handler->generation) << 32) | static_cast<uint32_t>(fd);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        LOG_ERROR("epoll_ctl(ADD) failed for fd " + std::to_string(fd) + ": " + strerror(errno));
+        return false;
+    }
+    handlers_[fd] = std::move(handler);
+    return true;
+}
+
+bool EventLoop::modify(int fd, uint32_t events) {
+    auto it = handlers_.find(fd);
+    if (it == handlers_.end()) return false;
+    epoll_event ev{};
+    ev.events = events | EPOLLET;
+    ev.data.u64 = (static_cast<uint64_t>(it->second->generation) << 32) | static_cast<uint32_t>(fd);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        LOG_ERROR("epoll_ctl(MOD) failed for fd " + std::to_string(fd) + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::remove(int fd) {
+    auto it = handlers_.find(fd);
+    if (it == handlers_.end()) return;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    retired_.push_back(std::move(it->second));
+    handlers_.erase(it);
+}
+
+bool EventLoop::run_once(int timeout_ms) {
+    epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return true;
+        LOG_ERROR("epoll_wait failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    for (int i = 0; i < n; ++i) {
+        int fd = static_cast<int>(events[i].data.u64 & 0xffffffffu);
+        uint32_t generation = static_cast<uint32_t>(events[i].data.u64 >> 32);
+        auto it = handlers_.find(fd);
+        if (it == handlers_.end() || it->second->generation != generation) continue;
+        Handler* handler = it->second.get();
+        handler->cb(events[i].events);
+    }
+    retired_.clear();
+    return true;
+}
+
+void EventLoop::run() {
+    running_ = true;
+    while (running_) {
+        if (!run_once(-1)) break;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Edge-triggered epoll reactor. Each registered fd owns one callback which
+// receives the epoll event mask; callbacks may add or remove fds (including
+// their own) while events are being dispatched.
+class EventLoop {
+public:
+    using Callback = std::function<void(uint32_t events)>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Registers fd for the given events (EPOLLET is always added).
+    bool add(int fd, uint32_t events, Callback cb);
+    // Changes the event mask of an already registered fd.
+    bool modify(int fd, uint32_t events);
+    // Unregisters fd. Does not close it.
+    void remove(int fd);
+    bool contains(int fd) const { return handlers_.count(fd) != 0; }
+    size_t size() const { return handlers_.size(); }
+
+    // Waits at most timeout_ms (-1 = forever) and dispatches ready events.
+    // Returns false if epoll_wait failed for a reason other than EINTR.
+    bool run_once(int timeout_ms);
+    // Dispatches events until stop() is called or epoll_wait fails.
+    void run();
+    void stop() { running_ = false; }
+
+private:
+    struct Handler {
+        int fd;
+        uint32_t generation;
+        Callback cb;
+    };
+
+    int epoll_fd_;
+    bool running_ = false;
+    uint32_t next_generation_ = 0;
+    std::unordered_map<int, std::unique_ptr<Handler>> handlers_;
+    // Handlers removed during dispatch are kept alive until the batch ends
+    std::vector<std::unique_ptr<Handler>> retired_;
+};
+
+#endif // EVENT_LOOP_HPP
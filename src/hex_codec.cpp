@@ -0,0 +1,213 @@
+#include "hex_codec.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEX_X86 1
+#endif
+
+namespace {
+const char DIGITS[] = "0123456789abcdef";
+
+// Nibble value of each byte, 0xFF for non-hex
+struct DecodeTable {
+    uint8_t value[256];
+    constexpr DecodeTable() : value() {
+        for (int i = 0; i < 256; ++i) value[i] = 0xFF;
+        for (int i = 0; i < 10; ++i) value['0' + i] = static_cast<uint8_t>(i);
+        for (int i = 0; i < 6; ++i) {
+            value['a' + i] = static_cast<uint8_t>(10 + i);
+            value['A' + i] = static_cast<uint8_t>(10 + i);
+        }
+    }
+};
+constexpr DecodeTable DECODE;
+
+void encode_scalar(const uint8_t* in, size_t len, char* out) {
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = DIGITS[in[i] >> 4];
+        out[2 * i + 1] = DIGITS[in[i] & 0x0F];
+    }
+}
+
+bool decode_scalar(const char* in, size_t out_len, uint8_t* out, size_t* bad_pos) {
+    for (size_t i = 0; i < out_len; ++i) {
+        uint8_t hi = DECODE.value[static_cast<uint8_t>(in[2 * i])];
+        uint8_t lo = DECODE.value[static_cast<uint8_t>(in[2 * i + 1])];
+        if ((hi | lo) > 0x0F) {
+            if (bad_pos) *bad_pos = 2 * i + (hi == 0xFF ? 0 : 1);
+            return false;
+        }
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+#ifdef HEX_X86
+// Nibbles (0-15 per byte) to their ASCII digits: '0' + n, plus 39 more
+// for n > 9 to land on 'a'
+__attribute__((target("sse2"))) inline __m128i nibbles_to_ascii_sse2(__m128i n) {
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(39));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letters);
+}
+
+// ASCII to nibble values; *valid gets 0xFF for each byte that was a hex digit
+__attribute__((target("sse2"))) inline __m128i ascii_to_nibbles_sse2(__m128i c, __m128i* valid) {
+    // Bytes at or above 0x80 end up negative or above the limit either way
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i digit_ok = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)), _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i letter_ok = _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8(-1)), _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+    *valid = _mm_or_si128(digit_ok, letter_ok);
+    return _mm_or_si128(_mm_and_si128(digit_ok, digit),
+                        _mm_and_si128(letter_ok, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+// Pairs of nibbles (high first) in each 16-bit lane to one byte in its low half
+__attribute__((target("sse2"))) inline __m128i join_nibbles_sse2(__m128i n) {
+    return _mm_or_si128(_mm_and_si128(_mm_slli_epi16(n, 4), _mm_set1_epi16(0x00F0)), _mm_srli_epi16(n, 8));
+}
+
+__attribute__((target("sse2"))) void encode_sse2(const uint8_t* in, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = nibbles_to_ascii_sse2(_mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F)));
+        __m128i lo = nibbles_to_ascii_sse2(_mm_and_si128(bytes, _mm_set1_epi8(0x0F)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    encode_scalar(in + i, len - i, out + 2 * i);
+}
+
+__attribute__((target("sse2"))) bool decode_sse2(const char* in, size_t out_len, uint8_t* out, size_t* bad_pos) {
+    size_t i = 0;
+    for (; i + 16 <= out_len; i += 16) {
+        __m128i valid_a, valid_b;
+        __m128i a = ascii_to_nibbles_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), &valid_a);
+        __m128i b = ascii_to_nibbles_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 16)), &valid_b);
+        // The scalar loop finds the exact position
+        if (_mm_movemask_epi8(_mm_and_si128(valid_a, valid_b)) != 0xFFFF) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(join_nibbles_sse2(a), join_nibbles_sse2(b)));
+    }
+    if (!decode_scalar(in + 2 * i, out_len - i, out + i, bad_pos)) {
+        if (bad_pos) *bad_pos += 2 * i;
+        return false;
+    }
+    return true;
+}
+
+__attribute__((target("avx2"))) inline __m256i nibbles_to_ascii_avx2(__m256i n) {
+    __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), _mm256_set1_epi8(39));
+    return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), letters);
+}
+
+__attribute__((target("avx2"))) inline __m256i ascii_to_nibbles_avx2(__m256i c, __m256i* valid) {
+    __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i digit_ok = _mm256_and_si256(_mm256_cmpgt_epi8(digit, _mm256_set1_epi8(-1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8(10), digit));
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i letter_ok = _mm256_and_si256(_mm256_cmpgt_epi8(letter, _mm256_set1_epi8(-1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8(6), letter));
+    *valid = _mm256_or_si256(digit_ok, letter_ok);
+    return _mm256_or_si256(_mm256_and_si256(digit_ok, digit),
+                           _mm256_and_si256(letter_ok, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2"))) inline __m256i join_nibbles_avx2(__m256i n) {
+    return _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(n, 4), _mm256_set1_epi16(0x00F0)), _mm256_srli_epi16(n, 8));
+}
+
+__attribute__((target("avx2"))) void encode_avx2(const uint8_t* in, size_t len, char* out) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hi = nibbles_to_ascii_avx2(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F)));
+        __m256i lo = nibbles_to_ascii_avx2(_mm256_and_si256(bytes, _mm256_set1_epi8(0x0F)));
+        // Unpacking works within 128-bit lanes; put the halves back in order
+        __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    encode_sse2(in + i, len - i, out + 2 * i);
+}
+
+__attribute__((target("avx2"))) bool decode_avx2(const char* in, size_t out_len, uint8_t* out, size_t* bad_pos) {
+    size_t i = 0;
+    for (; i + 32 <= out_len; i += 32) {
+        __m256i valid_a, valid_b;
+        __m256i a = ascii_to_nibbles_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i)), &valid_a);
+        __m256i b = ascii_to_nibbles_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i + 32)), &valid_b);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid_a, valid_b)) != -1) break;
+        // Packing also works per lane: the 64-bit quarters come out as a0 b0 a1 b1
+        __m256i packed = _mm256_packus_epi16(join_nibbles_avx2(a), join_nibbles_avx2(b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    if (!decode_sse2(in + 2 * i, out_len - i, out + i, bad_pos)) {
+        if (bad_pos) *bad_pos += 2 * i;
+        return false;
+    }
+    return true;
+}
+#endif
+
+struct Codec {
+    HexImpl impl;
+    void (*encode)(const uint8_t*, size_t, char*);
+    bool (*decode)(const char*, size_t, uint8_t*, size_t*);
+};
+
+bool supported(HexImpl impl) {
+#ifdef HEX_X86
+    // Runs during static initialisation, possibly before the CPU model is set up
+    __builtin_cpu_init();
+    if (impl == HexImpl::AVX2) return __builtin_cpu_supports("avx2");
+    if (impl == HexImpl::SSE2) return __builtin_cpu_supports("sse2");
+#endif
+    return impl == HexImpl::SCALAR;
+}
+
+Codec codec_for(HexImpl impl) {
+    switch (impl) {
+#ifdef HEX_X86
+        case HexImpl::AVX2: return Codec{impl, encode_avx2, decode_avx2};
+        case HexImpl::SSE2: return Codec{impl, encode_sse2, decode_sse2};
+#endif
+        default: return Codec{HexImpl::SCALAR, encode_scalar, decode_scalar};
+    }
+}
+
+Codec pick_codec() {
+    for (HexImpl impl : {HexImpl::AVX2, HexImpl::SSE2}) {
+        if (supported(impl)) return codec_for(impl);
+    }
+    return codec_for(HexImpl::SCALAR);
+}
+
+Codec codec = pick_codec();
+} // namespace
+
+void hex_encode(const uint8_t* in, size_t len, char* out) {
+    codec.encode(in, len, out);
+}
+
+bool hex_decode(const char* in, size_t out_len, uint8_t* out, size_t* bad_pos) {
+    return codec.decode(in, out_len, out, bad_pos);
+}
+
+HexImpl hex_impl() {
+    return codec.impl;
+}
+
+bool hex_set_impl(HexImpl impl) {
+    if (!supported(impl)) return false;
+    codec = codec_for(impl);
+    return true;
+}
+
+const char* hex_impl_name(HexImpl impl) {
+    switch (impl) {
+        case HexImpl::AVX2: return "avx2";
+        case HexImpl::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef HEX_CODEC_HPP
+#define HEX_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Hex encoding and decoding into caller-supplied buffers. On x86 the widest
+// of AVX2 and SSE2 the CPU supports is picked once at startup; elsewhere
+// (or for the tail of a buffer) a table-driven scalar loop runs.
+enum class HexImpl { SCALAR, SSE2, AVX2 };
+
+// Writes 2 * len lowercase hex digits to out (no terminator)
+void hex_encode(const uint8_t* in, size_t len, char* out);
+// Decodes 2 * out_len hex digits (either case) from in into out_len bytes.
+// Returns false at the first character that isn't a hex digit and stores
+// its index in *bad_pos; out is then partly written.
+bool hex_decode(const char* in, size_t out_len, uint8_t* out, size_t* bad_pos = nullptr);
+
+// Convenience for logging and keys
+inline std::string hex_encode(std::string_view bytes) {
+    std::string out(bytes.size() * 2, '\0');
+    hex_encode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), &out[0]);
+    return out;
+}
+
+// The implementation in use, and a switch for tests and benchmarks. Returns
+// false (and changes nothing) if the CPU lacks it. Not thread-safe; call
+// before other threads use the codec.
+HexImpl hex_impl();
+bool hex_set_impl(HexImpl impl);
+const char* hex_impl_name(HexImpl impl);
+
+#endif // HEX_CODEC_HPP
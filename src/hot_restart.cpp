@@ -0,0 +1,220 @@
+#include "hot_restart.hpp"
+#include "logger.hpp"
+#include "session_manager.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+// Largest message either side sends; session chunks stay below it
+#define HANDOFF_MAX_MESSAGE 65536
+#define HANDOFF_SESSION_CHUNK 32768
+// Listener fds attached to one message (one worker's worth)
+#define HANDOFF_MAX_FDS 64
+
+namespace {
+bool make_address(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Handoff socket path too long: " + path);
+        return false;
+    }
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+} // namespace
+
+Handoff::~Handoff() {
+    if (fd_ >= 0) close(fd_);
+}
+
+Handoff& Handoff::operator=(Handoff&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) close(fd_);
+        fd_ = other.fd_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+Handoff Handoff::connect(const std::string& path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return Handoff();
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return Handoff();
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        // ENOENT / ECONNREFUSED: no running server, so this is a cold start
+        close(fd);
+        return Handoff();
+    }
+    return Handoff(fd);
+}
+
+int Handoff::listen(const std::string& path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Handoff socket failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    // The previous owner has handed over (or died); its path is stale
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 1) < 0) {
+        LOG_ERROR("Handoff socket " + path + " unavailable: " + strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool Handoff::send_message(const std::string& payload, const std::vector<int>& fds) {
+    iovec iov{const_cast<char*>(payload.data()), payload.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    std::vector<char> control;
+    if (!fds.empty()) {
+        control.resize(CMSG_SPACE(sizeof(int) * fds.size()));
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+    while (sendmsg(fd_, &msg, MSG_NOSIGNAL) < 0) {
+        if (errno == EINTR) continue;
+        LOG_ERROR("Handoff send failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+bool Handoff::recv_message(std::string& payload, std::vector<int>* fds, int timeout_ms) {
+    pollfd pfd{fd_, POLLIN, 0};
+    int ready;
+    while ((ready = poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR) {}
+    if (ready <= 0) return false;
+    payload.resize(HANDOFF_MAX_MESSAGE);
+    iovec iov{&payload[0], payload.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    while ((n = recvmsg(fd_, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+    if (n <= 0) return false;
+    payload.resize(static_cast<size_t>(n));
+    std::vector<int> received;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t first = received.size();
+        received.resize(first + count);
+        std::memcpy(received.data() + first, CMSG_DATA(cmsg), count * sizeof(int));
+    }
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        for (int fd : received) close(fd);
+        LOG_ERROR("Handoff message truncated");
+        return false;
+    }
+    if (fds) {
+        fds->insert(fds->end(), received.begin(), received.end());
+    } else {
+        for (int fd : received) close(fd);
+    }
+    return true;
+}
+
+bool Handoff::send_listeners(const std::vector<ListenerGroup>& groups) {
+    for (const auto& group : groups) {
+        std::string payload = "LISTENERS";
+        std::vector<int> fds;
+        for (const auto& [fd, protocol] : group) {
+            payload += " ";
+            payload += protocol_name(protocol);
+            fds.push_back(fd);
+        }
+        if (!send_message(payload, fds)) return false;
+    }
+    return send_message("END");
+}
+
+bool Handoff::receive_listeners(std::vector<ListenerGroup>& groups) {
+    std::string payload;
+    while (true) {
+        std::vector<int> fds;
+        if (!recv_message(payload, &fds)) return false;
+        if (payload == "END") return true;
+        std::istringstream words(payload);
+        std::string word;
+        words >> word;
+        std::vector<Protocol> protocols;
+        bool known = true;
+        while (words >> word) {
+            protocols.push_back(protocol_from_name(word));
+            known = known && protocols.back() != Protocol::UNKNOWN;
+        }
+        if (payload.compare(0, 9, "LISTENERS") != 0 || !known || protocols.size() != fds.size()) {
+            for (int fd : fds) close(fd);
+            LOG_ERROR("Malformed handoff message: " + payload);
+            return false;
+        }
+        ListenerGroup group;
+        for (size_t i = 0; i < fds.size(); ++i) group.emplace_back(fds[i], protocols[i]);
+        groups.push_back(std::move(group));
+    }
+}
+
+bool Handoff::wait_ready(int timeout_ms) {
+    std::string payload;
+    return recv_message(payload, nullptr, timeout_ms) && payload == "READY";
+}
+
+bool Handoff::send_sessions(const SessionManager& sessions) {
+    std::string chunk = "SESSIONS\n";
+    for (const auto& [session_id, customer_id] : sessions.entries()) {
+        if (session_id.find_first_of("\t\n") != std::string::npos ||
+            customer_id.find_first_of("\t\n") != std::string::npos) {
+            continue;
+        }
+        chunk += session_id + "\t" + customer_id + "\n";
+        if (chunk.size() >= HANDOFF_SESSION_CHUNK) {
+            if (!send_message(chunk)) return false;
+            chunk = "SESSIONS\n";
+        }
+    }
+    if (chunk.size() > 9 && !send_message(chunk)) return false;
+    return send_message("END");
+}
+
+bool Handoff::complete(SessionManager& sessions, int timeout_ms) {
+    if (!send_message("READY")) return false;
+    std::string payload;
+    size_t imported = 0;
+    while (recv_message(payload, nullptr, timeout_ms)) {
+        if (payload == "END") {
+            LOG("Imported " + std::to_string(imported) + " sessions from the previous process");
+            return true;
+        }
+        if (payload.compare(0, 9, "SESSIONS\n") != 0) break;
+        std::istringstream lines(payload.substr(9));
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos) continue;
+            sessions.set(line.substr(0, tab), line.substr(tab + 1));
+            ++imported;
+        }
+    }
+    LOG_ERROR("Session handoff incomplete after " + std::to_string(imported) + " sessions");
+    return false;
+}
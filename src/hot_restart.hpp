@@ -0,0 +1,60 @@
+#ifndef HOT_RESTART_HPP
+#define HOT_RESTART_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "protocol.hpp"
+
+class SessionManager;
+
+// One end of a hot-restart handoff: a SOCK_SEQPACKET Unix socket between the
+// running server and the process replacing it.
+//
+//   old -> new  LISTENERS <protocol>...  (one message per worker, fds attached)
+//   old -> new  END
+//   new -> old  READY                    (new workers are accepting)
+//   old -> new  SESSIONS <id>\t<customer>\n...  (zero or more chunks)
+//   old -> new  END
+//
+// After READY the old process stops accepting and drains; the new one then
+// binds the handoff path itself.
+class Handoff {
+public:
+    // (fd, protocol) listeners owned by one worker
+    using ListenerGroup = std::vector<std::pair<int, Protocol>>;
+
+    explicit Handoff(int fd = -1) : fd_(fd) {}
+    ~Handoff();
+    Handoff(Handoff&& other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+    Handoff& operator=(Handoff&& other) noexcept;
+    Handoff(const Handoff&) = delete;
+    Handoff& operator=(const Handoff&) = delete;
+
+    bool valid() const { return fd_ >= 0; }
+
+    // New process: connects to a running server. Invalid if nobody is
+    // listening on path (a cold start).
+    static Handoff connect(const std::string& path);
+    // Receives every listener group; the fds become owned by the caller
+    bool receive_listeners(std::vector<ListenerGroup>& groups);
+    // Sends READY and imports the old process's session table
+    bool complete(SessionManager& sessions, int timeout_ms);
+
+    // Old process: binds path (replacing a stale socket) and listens.
+    // Returns the listening fd, or -1.
+    static int listen(const std::string& path);
+    bool send_listeners(const std::vector<ListenerGroup>& groups);
+    // True once the new process reports READY within timeout_ms
+    bool wait_ready(int timeout_ms);
+    bool send_sessions(const SessionManager& sessions);
+
+private:
+    bool send_message(const std::string& payload, const std::vector<int>& fds = {});
+    // Appends received fds (if any) to fds; false on error, EOF or timeout
+    bool recv_message(std::string& payload, std::vector<int>* fds = nullptr, int timeout_ms = -1);
+
+    int fd_;
+};
+
+#endif // HOT_RESTART_HPP
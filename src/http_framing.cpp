@@ -0,0 +1,122 @@
+#include "http_framing.hpp"
+#include <cctype>
+
+namespace {
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// True if the comma-separated header value lists token
+bool has_token(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        if (iequals(trim(value.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+const char* status_text(int status) {
+    switch (status) {
+        case 400: return "Bad Request";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Error";
+    }
+}
+} // namespace
+
+bool parse_http_frame(std::string_view buffered, HttpRequestFrame& frame) {
+    frame = HttpRequestFrame();
+    size_t end = buffered.find("\r\n\r\n");
+    if (end == std::string_view::npos) {
+        if (buffered.size() <= HTTP_MAX_HEAD_SIZE) return false;
+        frame.error_status = 431;
+        return true;
+    }
+    frame.head_length = end + 4;
+    if (frame.head_length > HTTP_MAX_HEAD_SIZE) {
+        frame.error_status = 431;
+        return true;
+    }
+    std::string_view head = buffered.substr(0, end);
+    size_t line_end = head.find("\r\n");
+    std::string_view request_line = head.substr(0, line_end);
+    size_t version_start = request_line.rfind(' ');
+    if (version_start == std::string_view::npos) {
+        frame.error_status = 400;
+        return true;
+    }
+    std::string_view version = request_line.substr(version_start + 1);
+    frame.http10 = version == "HTTP/1.0";
+    frame.keep_alive = !frame.http10;
+    size_t content_length = 0;
+    bool have_length = false;
+    while (line_end != std::string_view::npos) {
+        head.remove_prefix(line_end + 2);
+        line_end = head.find("\r\n");
+        std::string_view line = head.substr(0, line_end);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim(line.substr(colon + 1));
+        if (iequals(name, "Connection")) {
+            if (has_token(value, "close")) frame.keep_alive = false;
+            else if (has_token(value, "keep-alive")) frame.keep_alive = true;
+        } else if (iequals(name, "Content-Length")) {
+            size_t parsed = 0;
+            bool digits = !value.empty();
+            for (char c : value) {
+                if (c < '0' || c > '9') {
+                    digits = false;
+                    break;
+                }
+                // Saturate; anything past the limit is rejected below
+                if (parsed <= HTTP_MAX_BODY_SIZE) parsed = parsed * 10 + static_cast<size_t>(c - '0');
+            }
+            // Conflicting lengths could smuggle a second request past us
+            if (!digits || (have_length && parsed != content_length)) {
+                frame.error_status = 400;
+                return true;
+            }
+            content_length = parsed;
+            have_length = true;
+        } else if (iequals(name, "Transfer-Encoding")) {
+            // No handler takes a chunked body
+            frame.error_status = 501;
+            return true;
+        }
+    }
+    if (content_length > HTTP_MAX_BODY_SIZE) {
+        frame.error_status = 413;
+        return true;
+    }
+    frame.total_length = frame.head_length + content_length;
+    return buffered.size() >= frame.total_length;
+}
+
+void set_connection_header(std::string& response, bool keep_alive, bool http10) {
+    // HTTP/1.1 connections are persistent unless told otherwise
+    if (keep_alive && !http10) return;
+    size_t status_end = response.find("\r\n");
+    if (status_end == std::string::npos) return;
+    response.insert(status_end + 2, keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+}
+
+std::string http_error_response(int status) {
+    return "HTTP/1.1 " + std::to_string(status) + " " + status_text(status) +
+           "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
@@ -0,0 +1,35 @@
+#ifndef HTTP_FRAMING_HPP
+#define HTTP_FRAMING_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Largest request head (request line and headers) and body accepted on a
+// persistent HTTP connection
+#define HTTP_MAX_HEAD_SIZE 8192
+#define HTTP_MAX_BODY_SIZE 65536
+
+// Where one HTTP/1.x request ends in a receive buffer, and whether the
+// connection may carry another one after it.
+struct HttpRequestFrame {
+    size_t head_length = 0;   // through the blank line
+    size_t total_length = 0;  // head plus Content-Length body
+    bool keep_alive = false;  // HTTP/1.1 unless "Connection: close"; 1.0 only with "keep-alive"
+    bool http10 = false;
+    // Non-zero when the request can't be framed; answer with it and close
+    int error_status = 0;
+};
+
+// Returns false while more bytes are needed. With error_status set, the
+// frame lengths are meaningless and the connection must close.
+bool parse_http_frame(std::string_view buffered, HttpRequestFrame& frame);
+
+// Adds a Connection header to a complete response (after its status line)
+// so the client knows whether this connection stays open.
+void set_connection_header(std::string& response, bool keep_alive, bool http10);
+
+// Minimal error response for requests that never reach a handler
+std::string http_error_response(int status);
+
+#endif // HTTP_FRAMING_HPP
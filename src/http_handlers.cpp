@@ -1,47 +1,148 @@
 #include "http_handlers.hpp"
+#include "deferred_response.hpp"
 #include "logger.hpp"
 #include "login.hpp"
 #include "shard_manager.hpp"
-#include <string>
-#include <cstring>
+#include "net_io.hpp"
+#include <arpa/inet.h>
 #include <sys/socket.h>
-#include <map>
-#include <sstream>
-#include <functional>
-#include <unordered_map>
-
-// Helper to parse query string into key-value pairs
-std::map<std::string, std::string> parse_query_string(const std::string& qs) {
-    std::map<std::string, std::string> params;
-    std::istringstream ss(qs);
-    std::string pair;
-    while (std::getline(ss, pair, '&')) {
-        size_t eq = pair.find('=');
-        if (eq != std::string::npos) {
-            params[pair.substr(0, eq)] = pair.substr(eq + 1);
-        } else if (!pair.empty()) {
-            params[pair] = "";
-        }
-    }
-    return params;
-}
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
 
 std::string make_http_response(const std::string& body, int status_code = 200) {
     std::string status_text = (status_code == 200) ? "OK" : std::to_string(status_code);
     return "HTTP/1.1 " + std::to_string(status_code) + " " + status_text + "\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
 }
 
-using HandlerFunc = std::function<void(int, const std::string&, const std::map<std::string, std::string>&)>;
+namespace {
+// Runs AuthLogin's database lookups and bcrypt check; null = on the worker
+TaskPool* auth_pool = nullptr;
+// Throttles AuthLogin by address and username; null = no limits
+LoginLimiter* login_limiter = nullptr;
+// Peers whose forwarding headers are believed (see set_login_trusted_proxies)
+std::vector<uint32_t> trusted_proxies;
+
+uint64_t steady_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool parse_ipv4(std::string_view text, uint32_t* addr) {
+    char buf[INET_ADDRSTRLEN];
+    if (text.empty() || text.size() >= sizeof(buf)) return false;
+    text.copy(buf, text.size());
+    buf[text.size()] = '\0';
+    in_addr parsed{};
+    if (inet_pton(AF_INET, buf, &parsed) != 1) return false;
+    *addr = parsed.s_addr;
+    return true;
+}
+
+std::string render_login_result(const std::string& login_result) {
+    if (login_result.rfind("HTTP/1.1", 0) == 0) return login_result;
+    return make_http_response(login_result, 200);
+}
+
+// Runs the login and feeds its outcome back to the limiter. Only a wrong
+// username or password counts against the username, so a database outage
+// doesn't lock out everyone who tries to log in during it.
+std::string run_login(std::string_view username, std::string_view password) {
+    LoginResult result = authenticate_login(username, password);
+    if (login_limiter && (result.outcome == LoginOutcome::SUCCESS || result.outcome == LoginOutcome::BAD_CREDENTIALS)) {
+        login_limiter->record(username, result.outcome == LoginOutcome::SUCCESS, steady_ms());
+    }
+    return render_login_result(result.response);
+}
+
+// Answers AuthLogin without touching the database if the limiter says no
+bool login_throttled(int client_fd, const HttpRequestView& request, std::string_view username) {
+    if (!login_limiter) return false;
+    sockaddr_in peer{};
+    socklen_t len = sizeof(peer);
+    in_addr client{};
+    if (getpeername(client_fd, reinterpret_cast<sockaddr*>(&peer), &len) == 0) {
+        client.s_addr = login_client_address(peer.sin_addr.s_addr, request);
+    }
+    LoginLimiter::Verdict verdict = login_limiter->check(client.s_addr, username, steady_ms());
+    if (verdict == LoginLimiter::Verdict::ALLOW) return false;
+    bool ip_limited = verdict == LoginLimiter::Verdict::IP_LIMITED;
+    LOG_ERROR(std::string("Throttled AuthLogin from ") + inet_ntoa(client) +
+              (ip_limited ? " (address rate)" : " (too many failures for user " + std::string(username) + ")"));
+    std::string body = "reasoncode=Too many attempts\nreasontext=" +
+                       std::string(ip_limited ? "Too many login attempts from this address" : "Too many failed logins for this account") +
+                       "\nreasonurl=";
+    std::string response = "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 60\r\nContent-Type: text/plain\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\n\r\n" + body;
+    net_send(client_fd, response.data(), response.size());
+    return true;
+}
+} // namespace
+
+void set_auth_pool(TaskPool* pool) {
+    auth_pool = pool;
+}
+
+void set_login_limiter(LoginLimiter* limiter) {
+    login_limiter = limiter;
+}
+
+bool set_login_trusted_proxies(std::string_view list, std::string* err) {
+    std::vector<uint32_t> proxies;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view entry = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (entry.empty()) continue;
+        uint32_t addr = 0;
+        if (!parse_ipv4(entry, &addr)) {
+            if (err) *err = "Not an IPv4 address in the trusted proxy list: " + std::string(entry);
+            return false;
+        }
+        proxies.push_back(addr);
+    }
+    trusted_proxies = std::move(proxies);
+    return true;
+}
+
+uint32_t login_client_address(uint32_t peer, const HttpRequestView& request) {
+    if (std::find(trusted_proxies.begin(), trusted_proxies.end(), peer) == trusted_proxies.end()) return peer;
+    uint32_t client = 0;
+    if (parse_ipv4(trim(request.header("X-Real-IP")), &client)) return client;
+    // The proxy appends the address it saw; anything before it came from the client
+    std::string_view forwarded = request.header("X-Forwarded-For");
+    size_t comma = forwarded.rfind(',');
+    if (comma != std::string_view::npos) forwarded.remove_prefix(comma + 1);
+    if (parse_ipv4(trim(forwarded), &client)) return client;
+    return peer;
+}
 
 // Handler for /AuthLogin
-void auth_login_handler(int client_fd, const std::string& request, const std::map<std::string, std::string>& params) {
-    std::string login_result = handle_auth_login(params);
-    if (login_result.rfind("HTTP/1.1", 0) == 0) {
-        send(client_fd, login_result.c_str(), login_result.size(), 0);
-    } else {
-        std::string http_response = make_http_response(login_result, 200);
-        send(client_fd, http_response.c_str(), http_response.size(), 0);
+void auth_login_handler(int client_fd, const HttpRequestView& request) {
+    if (login_throttled(client_fd, request, request.param("username"))) return;
+    if (auth_pool && can_defer_response()) {
+        // The views die with this request; the job gets its own copies
+        std::string username(request.param("username"));
+        std::string password(request.param("password"));
+        bool deferred = defer_response(*auth_pool, [username, password] { return run_login(username, password); });
+        if (deferred) return;
+        LOG_ERROR("Auth pool queue full; rejecting AuthLogin");
+        static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+        net_send(client_fd, busy, sizeof(busy) - 1);
+        return;
     }
+    std::string response = run_login(request.param("username"), request.param("password"));
+    net_send(client_fd, response.c_str(), response.size());
 }
 
 ShardInfo initial_start_shard = {
@@ -95,49 +196,121 @@ std::string format_shards_response(const std::vector<ShardInfo>& shards) {
     return body;
 }
 
-void shard_list_handler(int client_fd, const std::string& request, const std::map<std::string, std::string>& params) {
-    auto shards = shard_manager.list_shards();
-    std::string body = format_shards_response(shards);
-    std::string http_response = make_http_response(body, 200);
-    send(client_fd, http_response.c_str(), http_response.size(), 0);
-}
-
-// Handles HTTP requests for the server. Returns true if handled, false otherwise.
-bool handle_http_request(int client_fd, const std::string& request) {
-    // Map of path to handler
-    static const std::unordered_map<std::string, HandlerFunc> handler_map = {
-        {"/AuthLogin", auth_login_handler},
-        {"/ShardList/", shard_list_handler}
-        // Add more path/handler pairs here
-    };
-
-    // Parse path and query string
-    size_t method_end = request.find(' ');
-    if (method_end == std::string::npos) return false;
-    size_t path_start = method_end + 1;
-    size_t path_end = request.find(' ', path_start);
-    if (path_end == std::string::npos) return false;
-    std::string full_path = request.substr(path_start, path_end - path_start);
-    std::string path = full_path;
-    std::string query_string;
-    size_t qs_start = full_path.find('?');
-    if (qs_start != std::string::npos) {
-        path = full_path.substr(0, qs_start);
-        query_string = full_path.substr(qs_start + 1);
+namespace {
+// A worker's rendered /ShardList/ responses, valid while the shard list is
+// at `generation`
+struct ShardListCache {
+    uint64_t generation = UINT64_MAX;
+    std::string etag;
+    std::string ok;
+    std::string not_modified;
+};
+
+// Content hash, so every worker (and a restarted server) hands out the same tag
+std::string make_etag(const std::string& body) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : body) hash = (hash ^ c) * 1099511628211ull;
+    char tag[19];
+    snprintf(tag, sizeof(tag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return tag;
+}
+
+// If-None-Match is "*" or a list of (possibly weak) tags
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view tag = if_none_match.substr(0, comma);
+        while (!tag.empty() && tag.front() == ' ') tag.remove_prefix(1);
+        while (!tag.empty() && tag.back() == ' ') tag.remove_suffix(1);
+        if (tag.substr(0, 2) == "W/") tag.remove_prefix(2);
+        if (tag == "*" || tag == etag) return true;
+        if (comma == std::string_view::npos) break;
+        if_none_match.remove_prefix(comma + 1);
     }
-    std::map<std::string, std::string> params = parse_query_string(query_string);
+    return false;
+}
+
+const ShardListCache& shard_list_cache() {
+    // Per worker thread, so the hot path is one atomic load and no lock
+    static thread_local ShardListCache cache;
+    if (cache.generation == shard_manager.generation()) return cache;
+    uint64_t generation;
+    std::string body = format_shards_response(shard_manager.list_shards(generation));
+    cache.etag = make_etag(body);
+    cache.ok = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) +
+               "\r\nETag: " + cache.etag + "\r\n\r\n" + body;
+    cache.not_modified = "HTTP/1.1 304 Not Modified\r\nETag: " + cache.etag + "\r\n\r\n";
+    cache.generation = generation;
+    return cache;
+}
+} // namespace
+
+void shard_list_handler(int client_fd, const HttpRequestView& request) {
+    const ShardListCache& cache = shard_list_cache();
+    const std::string& response = etag_matches(request.header("If-None-Match"), cache.etag) ? cache.not_modified : cache.ok;
+    net_send(client_fd, response.data(), response.size());
+}
+
+namespace {
+using RouteHandler = void (*)(int client_fd, const HttpRequestView& request);
+
+struct Route {
+    std::string_view path;
+    RouteHandler handler;
+};
 
+constexpr Route ROUTES[] = {
+    {"/AuthLogin", auth_login_handler},
+    {"/ShardList/", shard_list_handler},
+    // Add more path/handler pairs here
+};
+constexpr size_t ROUTE_COUNT = sizeof(ROUTES) / sizeof(ROUTES[0]);
+
+// FNV-1a; the slot table below is sized so no two routes share a slot
+constexpr uint32_t route_hash(std::string_view path) {
+    uint32_t hash = 2166136261u;
+    for (char c : path) hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    return hash;
+}
+
+#define ROUTE_SLOTS 8
+
+constexpr std::array<int8_t, ROUTE_SLOTS> build_route_slots() {
+    std::array<int8_t, ROUTE_SLOTS> slots{};
+    for (auto& slot : slots) slot = -1;
+    for (size_t i = 0; i < ROUTE_COUNT; ++i) slots[route_hash(ROUTES[i].path) % ROUTE_SLOTS] = static_cast<int8_t>(i);
+    return slots;
+}
+
+constexpr std::array<int8_t, ROUTE_SLOTS> ROUTE_TABLE = build_route_slots();
+
+constexpr bool route_table_is_perfect() {
+    for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+        if (ROUTE_TABLE[route_hash(ROUTES[i].path) % ROUTE_SLOTS] != static_cast<int8_t>(i)) return false;
+    }
+    return true;
+}
+static_assert(route_table_is_perfect(), "two routes hash to one slot; grow ROUTE_SLOTS");
+
+// One hash and one compare per request
+const Route* find_route(std::string_view path) {
+    int8_t index = ROUTE_TABLE[route_hash(path) % ROUTE_SLOTS];
+    if (index < 0 || ROUTES[index].path != path) return nullptr;
+    return &ROUTES[index];
+}
+} // namespace
+
+bool handle_http_request(int client_fd, const HttpRequestView& request) {
     // Log the request path, with the query string removed for security
-    LOG("Received HTTP request: " + path);
-    
-    auto it = handler_map.find(path);
-    if (it != handler_map.end()) {
-        LOG("Handling request for path: " + path);
-        it->second(client_fd, request, params);
-        return true;
+    LOG_PARTS("Received HTTP request: ", request.path);
+
+    const Route* route = find_route(request.path);
+    if (route) {
+        LOG_PARTS("Handling request for path: ", request.path);
+        route->handler(client_fd, request);
     } else {
         std::string response = make_http_response("Invalid request", 400);
-        send(client_fd, response.c_str(), response.size(), 0);
-        return true;
+        net_send(client_fd, response.c_str(), response.size());
     }
+    return true;
 }
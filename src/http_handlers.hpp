@@ -1,9 +1,38 @@
 #ifndef HTTP_HANDLERS_HPP
 #define HTTP_HANDLERS_HPP
 
+#include "http_request.hpp"
+#include "login_limiter.hpp"
+#include "shard_manager.hpp"
+#include "task_pool.hpp"
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
-// Handles HTTP requests for the server. Returns true if handled, false otherwise.
-bool handle_http_request(int client_fd, const std::string& request);
+// Routes a parsed request to its handler (400 for unknown paths); the
+// response goes out through net_send(). Returns true once answered.
+bool handle_http_request(int client_fd, const HttpRequestView& request);
+
+// The /ShardList/ body: one section per shard, in the launcher's format
+std::string format_shards_response(const std::vector<ShardInfo>& shards);
+
+// Where AuthLogin runs its database and bcrypt work, so the I/O worker
+// never blocks on it. Null (the default) runs it inline. Set before the
+// workers start.
+void set_auth_pool(TaskPool* pool);
+// Checked before any AuthLogin work starts; null (the default) = no limits.
+// Set before the workers start.
+void set_login_limiter(LoginLimiter* limiter);
+// Reverse proxies (such as services/sslProxy) whose X-Real-IP or
+// X-Forwarded-For header names the client the address limit applies to; a
+// request from any other peer is limited by the peer's own address. A
+// comma-separated list of IPv4 addresses; empty (the default) trusts no
+// header. False with err set, and nothing changed, on a bad entry. Set
+// before the workers start.
+bool set_login_trusted_proxies(std::string_view list, std::string* err);
+// The address AuthLogin is limited by, in network byte order: peer, or the
+// client a trusted proxy named in the request's headers
+uint32_t login_client_address(uint32_t peer, const HttpRequestView& request);
 
 #endif // HTTP_HANDLERS_HPP
@@ -0,0 +1,131 @@
+#include "http_request.hpp"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const char* find_delimiter(const char* p, const char* end, char a, char b) {
+#ifdef __SSE2__
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+namespace {
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if ((a[i] | 0x20) != (b[i] | 0x20)) return false;
+    }
+    return true;
+}
+
+std::string_view decode(char* begin, const char* end) {
+    return std::string_view(begin, percent_decode(begin, static_cast<size_t>(end - begin)));
+}
+} // namespace
+
+size_t percent_decode(char* data, size_t len) {
+    char* p = static_cast<char*>(std::memchr(data, '%', len));
+    if (!p) return len;
+    char* out = p;
+    const char* end = data + len;
+    while (p < end) {
+        if (*p == '%' && end - p >= 3) {
+            int hi = hex_value(p[1]);
+            int lo = hex_value(p[2]);
+            if (hi >= 0 && lo >= 0) {
+                *out++ = static_cast<char>((hi << 4) | lo);
+                p += 3;
+                continue;
+            }
+        }
+        *out++ = *p++;
+    }
+    return static_cast<size_t>(out - data);
+}
+
+std::string_view HttpRequestView::param(std::string_view key) const {
+    for (size_t i = 0; i < param_count; ++i) {
+        if (params[i].first == key) return params[i].second;
+    }
+    return std::string_view();
+}
+
+bool HttpRequestView::has_param(std::string_view key) const {
+    for (size_t i = 0; i < param_count; ++i) {
+        if (params[i].first == key) return true;
+    }
+    return false;
+}
+
+std::string_view HttpRequestView::header(std::string_view name) const {
+    std::string_view rest = headers;
+    while (!rest.empty()) {
+        size_t line_end = rest.find("\r\n");
+        std::string_view line = rest.substr(0, line_end);
+        if (line.size() > name.size() && line[name.size()] == ':' && iequals(line.substr(0, name.size()), name)) {
+            std::string_view value = line.substr(name.size() + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        if (line_end == std::string_view::npos) break;
+        rest.remove_prefix(line_end + 2);
+    }
+    return std::string_view();
+}
+
+bool parse_http_request(char* data, size_t len, HttpRequestView& request) {
+    request = HttpRequestView();
+    char* end = data + len;
+    char* line_end = static_cast<char*>(std::memchr(data, '\r', len));
+    if (line_end) {
+        end = line_end;
+        // Headers run to the blank line (or whatever of them the caller has)
+        std::string_view rest(line_end, len - static_cast<size_t>(line_end - data));
+        if (rest.size() >= 2) rest.remove_prefix(2);
+        size_t blank = rest.find("\r\n\r\n");
+        if (blank != std::string_view::npos) rest = rest.substr(0, blank);
+        else if (rest.size() >= 2 && rest.substr(0, 2) == "\r\n") rest = std::string_view();
+        request.headers = rest;
+    }
+    char* method_end = find_delimiter(data, end, ' ', ' ');
+    if (method_end == end) return false;
+    char* target = method_end + 1;
+    char* target_end = find_delimiter(target, end, ' ', ' ');
+    if (target_end == end) return false;
+    request.method = std::string_view(data, static_cast<size_t>(method_end - data));
+    request.version = std::string_view(target_end + 1, static_cast<size_t>(end - target_end - 1));
+    char* query = find_delimiter(target, target_end, '?', '?');
+    request.path = std::string_view(target, static_cast<size_t>(query - target));
+    // key=value pairs separated by '&'; a key without '=' gets an empty value
+    char* p = query < target_end ? query + 1 : target_end;
+    while (p < target_end && request.param_count < HTTP_MAX_QUERY_PARAMS) {
+        char* pair_end = find_delimiter(p, target_end, '&', '&');
+        char* eq = find_delimiter(p, pair_end, '=', '=');
+        if (pair_end > p) {
+            auto& param = request.params[request.param_count++];
+            param.first = decode(p, eq);
+            param.second = eq < pair_end ? decode(eq + 1, pair_end) : std::string_view();
+        }
+        p = pair_end + 1;
+    }
+    return true;
+}
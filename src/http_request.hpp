@@ -0,0 +1,46 @@
+#ifndef HTTP_REQUEST_HPP
+#define HTTP_REQUEST_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+// Query parameters kept per request; later ones are ignored
+#define HTTP_MAX_QUERY_PARAMS 16
+
+// A parsed request line. Every field points into the connection's receive
+// buffer, so a view is only valid while the handler it is passed to runs.
+struct HttpRequestView {
+    std::string_view method;
+    std::string_view path;     // target up to '?', not decoded
+    std::string_view version;
+    // Header lines after the request line, not including the blank line
+    std::string_view headers;
+    // Percent-decoded in place, in request order
+    std::pair<std::string_view, std::string_view> params[HTTP_MAX_QUERY_PARAMS];
+    size_t param_count = 0;
+
+    // First value for key; empty if absent
+    std::string_view param(std::string_view key) const;
+    bool has_param(std::string_view key) const;
+    // Value of the first header with this (case-insensitive) name; empty if absent
+    std::string_view header(std::string_view name) const;
+};
+
+// Parses the request line at the start of data (up to its CRLF, or len) and
+// splits the query string; any header lines after it up to len are kept. Query keys and values are percent-decoded in
+// place, so data is rewritten. Returns false if the line is malformed.
+bool parse_http_request(char* data, size_t len, HttpRequestView& request);
+
+// Decodes %XX escapes in place and returns the new length. Malformed escapes
+// are kept as-is; '+' is left alone since the client doesn't form-encode.
+size_t percent_decode(char* data, size_t len);
+
+// First byte in [p, end) equal to a or b, or end. Scans 16 bytes at a time
+// where SSE2 is available.
+const char* find_delimiter(const char* p, const char* end, char a, char b);
+inline char* find_delimiter(char* p, char* end, char a, char b) {
+    return const_cast<char*>(find_delimiter(static_cast<const char*>(p), end, a, b));
+}
+
+#endif // HTTP_REQUEST_HPP
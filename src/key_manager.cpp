@@ -0,0 +1,133 @@
+#include "key_manager.hpp"
+#include "logger.hpp"
+#include <openssl/pem.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+// How often keys() looks at the file's inode, size and mtime
+#define KEY_CHECK_INTERVAL_MS 1000
+
+namespace {
+// Bumped from the signal handler; lock-free so that is safe
+std::atomic<uint32_t> reload_requests{0};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "request_reload() runs in a signal handler");
+}
+
+KeyManager::KeyManager(std::string path, uint64_t rotation_window_ms)
+    : path_(std::move(path)), rotation_window_ms_(rotation_window_ms), keys_(std::make_shared<KeySet>()) {}
+
+void KeyManager::request_reload() {
+    reload_requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+KeyManager& KeyManager::shared(const std::string& path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<KeyManager>> managers;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& manager = managers[path];
+    if (!manager) manager.reset(new KeyManager(path));
+    return *manager;
+}
+
+uint64_t KeyManager::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool KeyManager::stat_file(FileStamp& stamp) const {
+    struct stat st;
+    if (stat(path_.c_str(), &st) != 0) return false;
+    stamp.inode = st.st_ino;
+    stamp.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.size = st.st_size;
+    return true;
+}
+
+std::shared_ptr<const KeyManager::KeySet> KeyManager::keys() {
+    std::shared_ptr<const KeySet> current = std::atomic_load(&keys_);
+    uint64_t now = now_ms();
+    uint32_t requests = reload_requests.load(std::memory_order_relaxed);
+    if (!current->keys.empty() && requests == seen_reload_request_.load(std::memory_order_relaxed) &&
+        now < next_check_ms_.load(std::memory_order_relaxed)) {
+        return current;
+    }
+    // Whoever gets the lock checks; everyone else carries on with the keys
+    // already published. With none published yet there is nothing to carry
+    // on with, so wait for the first load instead.
+    std::unique_lock<std::mutex> lock(reload_mutex_, std::defer_lock);
+    if (current->keys.empty()) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return current;
+    }
+    bool requested = requests != seen_reload_request_.load(std::memory_order_relaxed);
+    if (!requested && now < next_check_ms_.load(std::memory_order_relaxed)) return std::atomic_load(&keys_);
+    next_check_ms_.store(now + KEY_CHECK_INTERVAL_MS, std::memory_order_relaxed);
+    seen_reload_request_.store(requests, std::memory_order_relaxed);
+    FileStamp stamp;
+    bool exists = stat_file(stamp);
+    if (requested || (exists && !(stamp == stamp_))) {
+        std::string err;
+        if (!reload_locked(stamp, &err)) LOG_ERROR("Keeping current keys: " + err);
+    } else {
+        prune_retired_locked(now);
+    }
+    return std::atomic_load(&keys_);
+}
+
+bool KeyManager::reload(std::string* err) {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    FileStamp stamp;
+    stat_file(stamp);
+    return reload_locked(stamp, err);
+}
+
+bool KeyManager::reload_locked(const FileStamp& stamp, std::string* err) {
+    // Remembered even on failure, so a bad file is reported once rather than
+    // on every check
+    stamp_ = stamp;
+    FILE* f = fopen(path_.c_str(), "r");
+    if (!f) {
+        if (err) *err = "Failed to open private key file: " + path_;
+        return false;
+    }
+    EVP_PKEY* pkey = PEM_read_PrivateKey(f, nullptr, nullptr, nullptr);
+    fclose(f);
+    if (!pkey) {
+        if (err) *err = "Failed to read private key from: " + path_;
+        return false;
+    }
+    uint64_t now = now_ms();
+    std::shared_ptr<const KeySet> old = std::atomic_load(&keys_);
+    auto next = std::make_shared<KeySet>();
+    next->keys.emplace_back(pkey, EVP_PKEY_free);
+    next->retire_at_ms.push_back(0);
+    uint64_t window = rotation_window_ms_.load();
+    for (size_t i = 0; i < old->keys.size(); ++i) {
+        // Reloading an unchanged file doesn't retire anything
+        if (EVP_PKEY_eq(old->keys[i].get(), pkey) == 1) continue;
+        uint64_t retire_at = old->retire_at_ms[i] ? old->retire_at_ms[i] : now + window;
+        if (retire_at <= now) continue;
+        next->keys.push_back(old->keys[i]);
+        next->retire_at_ms.push_back(retire_at);
+    }
+    std::atomic_store(&keys_, std::shared_ptr<const KeySet>(std::move(next)));
+    LOG("Loaded private key from " + path_ + (old->keys.empty() ? std::string() : " (previous key kept for the rotation window)"));
+    return true;
+}
+
+void KeyManager::prune_retired_locked(uint64_t now) {
+    std::shared_ptr<const KeySet> current = std::atomic_load(&keys_);
+    bool expired = false;
+    for (uint64_t retire_at : current->retire_at_ms) expired |= retire_at != 0 && retire_at <= now;
+    if (!expired) return;
+    auto next = std::make_shared<KeySet>();
+    for (size_t i = 0; i < current->keys.size(); ++i) {
+        if (current->retire_at_ms[i] != 0 && current->retire_at_ms[i] <= now) continue;
+        next->keys.push_back(current->keys[i]);
+        next->retire_at_ms.push_back(current->retire_at_ms[i]);
+    }
+    std::atomic_store(&keys_, std::shared_ptr<const KeySet>(std::move(next)));
+}
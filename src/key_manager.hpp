@@ -0,0 +1,67 @@
+#ifndef KEY_MANAGER_HPP
+#define KEY_MANAGER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <openssl/evp.h>
+
+// Keeps a PEM private key parsed in memory and shared by every thread. The
+// file is parsed again when SIGHUP asks for it (request_reload()) or when it
+// changes on disk (checked at most every KEY_CHECK_INTERVAL_MS, on use). A
+// reload publishes a new immutable key set atomically; a decrypt that
+// already holds the old set keeps its keys alive until it finishes. The
+// replaced key is kept, after the new one, for the rotation window so
+// clients still encrypting to it can log in.
+class KeyManager {
+public:
+    using Key = std::shared_ptr<EVP_PKEY>;
+    // Newest first; retired keys follow until their window closes
+    struct KeySet {
+        std::vector<Key> keys;
+        std::vector<uint64_t> retire_at_ms;  // per key; 0 = current
+    };
+
+    explicit KeyManager(std::string path, uint64_t rotation_window_ms = 600000);
+    KeyManager(const KeyManager&) = delete;
+    KeyManager& operator=(const KeyManager&) = delete;
+
+    // Thread-safe. The current key set, reloading first if the file changed
+    // or a reload was requested. Empty if no key could ever be loaded.
+    std::shared_ptr<const KeySet> keys();
+    // Parses the file now. On failure the old keys stay in use.
+    bool reload(std::string* err);
+    void set_rotation_window_ms(uint64_t ms) { rotation_window_ms_.store(ms); }
+
+    // Async-signal-safe: every manager reloads on its next use
+    static void request_reload();
+    // Process-wide manager for a key file, created on first use
+    static KeyManager& shared(const std::string& path);
+
+private:
+    struct FileStamp {
+        uint64_t inode = 0;
+        int64_t mtime_ns = 0;
+        int64_t size = -1;
+        bool operator==(const FileStamp& o) const { return inode == o.inode && mtime_ns == o.mtime_ns && size == o.size; }
+    };
+
+    static uint64_t now_ms();
+    bool stat_file(FileStamp& stamp) const;
+    // Runs with reload_mutex_ held
+    bool reload_locked(const FileStamp& stamp, std::string* err);
+    void prune_retired_locked(uint64_t now);
+
+    std::string path_;
+    std::atomic<uint64_t> rotation_window_ms_;
+    std::shared_ptr<const KeySet> keys_;  // std::atomic_load/atomic_store only
+    std::mutex reload_mutex_;
+    FileStamp stamp_;                     // guarded by reload_mutex_
+    std::atomic<uint64_t> next_check_ms_{0};
+    std::atomic<uint32_t> seen_reload_request_{0};
+};
+
+#endif // KEY_MANAGER_HPP
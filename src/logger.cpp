@@ -20,30 +20,45 @@ void Logger::set_destination(LogDest dest, const std::string& filename) {
     }
 }
 
-void Logger::log(const std::string& msg) {
+void Logger::log(std::string_view msg) {
     write(msg, false);
 }
 
-void Logger::error(const std::string& msg, const char* file, int line) {
-    std::string err_msg = "[ERROR] ";
+void Logger::error(std::string_view msg, const char* file, int line) {
+    error_parts(file, line, msg);
+}
+
+std::string& Logger::line_buffer() {
+    thread_local std::string line;
+    return line;
+}
+
+void Logger::append_error_prefix(std::string& line, const char* file, int line_no) {
+    line += "[ERROR] ";
     if (file) {
-        err_msg += std::string(file);
-        if (line > 0) {
-            err_msg += ":" + std::to_string(line);
+        line += file;
+        if (line_no > 0) {
+            line += ':';
+            append(line, line_no);
         }
-        err_msg += ": ";
+        line += ": ";
     }
-    err_msg += msg;
-    write(err_msg, true);
 }
 
-void Logger::write(const std::string& msg, bool is_error) {
+void Logger::write(std::string_view msg, bool is_error) {
+    // Kept per thread so a line costs no allocation once it has grown
+    thread_local std::string out;
+    std::time_t t = std::time(nullptr);
     std::lock_guard<std::mutex> lock(log_mutex);
     // Timestamp
-    std::time_t t = std::time(nullptr);
     char timebuf[32];
     std::strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
-    std::string out = std::string("[") + timebuf + "] " + msg + "\n";
+    out.clear();
+    out += '[';
+    out += timebuf;
+    out += "] ";
+    out.append(msg.data(), msg.size());
+    out += '\n';
     switch (destination) {
         case LogDest::FILE:
             if (file_stream.is_open()) file_stream << out << std::flush;
@@ -1,7 +1,10 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
+#include <charconv>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <fstream>
 #include <iostream>
 #include <mutex>
@@ -16,18 +19,54 @@ enum class LogDest {
 class Logger {
 public:
     static void set_destination(LogDest dest, const std::string& filename = "");
-    static void log(const std::string& msg);
-    static void error(const std::string& msg, const char* file = nullptr, int line = 0);
+    static void log(std::string_view msg);
+    static void error(std::string_view msg, const char* file = nullptr, int line = 0);
+
+    // Joins parts (strings, string_views, C strings, chars and integers) in
+    // this thread's line buffer, so once it has grown to the longest line a
+    // message costs no allocation. Used on the per-request paths.
+    template <typename... Parts>
+    static void log_parts(const Parts&... parts) {
+        std::string& line = line_buffer();
+        line.clear();
+        (append(line, parts), ...);
+        write(line, false);
+    }
+    template <typename... Parts>
+    static void error_parts(const char* file, int line_no, const Parts&... parts) {
+        std::string& line = line_buffer();
+        line.clear();
+        append_error_prefix(line, file, line_no);
+        (append(line, parts), ...);
+        write(line, true);
+    }
+
 private:
     static LogDest destination;
     static std::ofstream file_stream;
     static std::mutex log_mutex;
     static std::string log_filename;
-    static void write(const std::string& msg, bool is_error = false);
+    static void write(std::string_view msg, bool is_error = false);
+
+    static std::string& line_buffer();
+    static void append_error_prefix(std::string& line, const char* file, int line_no);
+    static void append(std::string& line, std::string_view part) { line.append(part.data(), part.size()); }
+    static void append(std::string& line, const char* part) { line += part; }
+    static void append(std::string& line, char part) { line.push_back(part); }
+    static void append(std::string& line, bool part) = delete;
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    static void append(std::string& line, T part) {
+        char digits[24];
+        std::to_chars_result end = std::to_chars(digits, digits + sizeof(digits), part);
+        line.append(digits, end.ptr - digits);
+    }
 };
 
 // Macros for logging
 #define LOG(msg) Logger::log(msg)
 #define LOG_ERROR(msg) Logger::error(msg, __FILE__, __LINE__)
+// Same, built from parts without temporary strings: LOG_PARTS("fd ", fd, " closed")
+#define LOG_PARTS(...) Logger::log_parts(__VA_ARGS__)
+#define LOG_ERROR_PARTS(...) Logger::error_parts(__FILE__, __LINE__, __VA_ARGS__)
 
 #endif // LOGGER_HPP
@@ -2,11 +2,10 @@
 #include "login.hpp"
 #include "db_handler.hpp"
 #include "session_manager.hpp"
-#include <sstream>
+#include "hex_codec.hpp"
 #include <openssl/evp.h>
 #include <openssl/crypto.h>
 #include <openssl/rand.h>
-#include <iomanip>
 #include <unistd.h> // For crypt()
 #include <stdio.h>
 #include <cstring>
@@ -72,65 +71,93 @@ static bool validate_login_params(const std::map<std::string, std::string> &para
 }
 } // close anonymous namespace
 
-// Modular, testable version
-std::string handle_auth_login_modular(const std::map<std::string, std::string> &params, DBHandler &db, SessionManager &session_mgr)
+// Runs once both credentials are present
+static LoginResult authenticate(const std::string &username, const std::string &password, DBHandler &db, SessionManager &session_mgr)
 {
-    std::string username, password, error;
-    if (!validate_login_params(params, username, password, error))
-    {
-        LOG_ERROR("Missing parameters: Login request for user " + username + " without password or vice versa");
-        return invalid_response("Missing parameters", error);
-    }
     if (!db.connect())
     {
         LOG_ERROR("Database connection error: Failed to connect to the database");
-        return invalid_response("Database connection error", "Failed to connect to the database");
+        return {LoginOutcome::SERVER_ERROR, invalid_response("Database connection error", "Failed to connect to the database")};
     }
     auto hash_opt = db.get_password_hash(username);
     if (!hash_opt)
     {
         LOG_ERROR("Invalid credentials: Username not found in database: " + username);
-        return invalid_response("Invalid username or password", "Username not found in database");
+        return {LoginOutcome::BAD_CREDENTIALS, invalid_response("Invalid username or password", "Username not found in database")};
     }
     if (!is_bcrypt_hash(*hash_opt))
     {
         LOG_ERROR("Invalid password hash: The password hash for user " + username + " does not start with $2, $2a, $2b, or $2y");
-        return invalid_response("Invalid password hash", "Password hash does not start with $2, $2a, $2b, or $2y");
+        return {LoginOutcome::SERVER_ERROR, invalid_response("Invalid password hash", "Password hash does not start with $2, $2a, $2b, or $2y")};
     }
     if (!check_password(password, *hash_opt))
     {
         LOG_ERROR("Invalid credentials: could not verify password for user " + username);
-        return invalid_response("Invalid credentials", "Username or password is incorrect");
+        return {LoginOutcome::BAD_CREDENTIALS, invalid_response("Invalid credentials", "Username or password is incorrect")};
     }
     auto customer_id_opt = db.get_customer_id(username);
     if (!customer_id_opt)
     {
         LOG_ERROR("Failed to retrieve customer ID for user " + username);
-        return invalid_response("Failed to retrieve customer ID", "Could not retrieve customer ID for user " + username);
+        return {LoginOutcome::SERVER_ERROR, invalid_response("Failed to retrieve customer ID", "Could not retrieve customer ID for user " + username)};
     }
     // Generate cryptographically secure random session ID
     unsigned char random_bytes[32];
     if (RAND_bytes(random_bytes, sizeof(random_bytes)) != 1) {
         LOG_ERROR("Failed to generate secure random session ID");
-        return invalid_response("Internal error", "Failed to generate session");
-    }
-    std::stringstream ss;
-    for (size_t i = 0; i < sizeof(random_bytes); ++i) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << (int)random_bytes[i];
+        return {LoginOutcome::SERVER_ERROR, invalid_response("Internal error", "Failed to generate session")};
     }
-    std::string session_id = ss.str();
+    std::string session_id(2 * sizeof(random_bytes), '\0');
+    hex_encode(random_bytes, sizeof(random_bytes), &session_id[0]);
     LOG("Storing session_id in SessionManager: [" + session_id + "] (len=" + std::to_string(session_id.size()) + ") for customer_id: [" + customer_id_opt.value() + "]");
     session_mgr.set(session_id, customer_id_opt.value());
     LOG("User " + username + " logged in successfully with session ID: " + session_id);
-    return valid_response(session_id);
+    return {LoginOutcome::SUCCESS, valid_response(session_id)};
+}
+
+// Modular, testable version
+std::string handle_auth_login_modular(const std::map<std::string, std::string> &params, DBHandler &db, SessionManager &session_mgr)
+{
+    std::string username, password, error;
+    if (!validate_login_params(params, username, password, error))
+    {
+        LOG_ERROR("Missing parameters: Login request for user " + username + " without password or vice versa");
+        return invalid_response("Missing parameters", error);
+    }
+    return authenticate(username, password, db, session_mgr).response;
+}
+
+// One SQLite connection per worker thread; DBHandler itself is not thread-safe
+static DBHandler &thread_db()
+{
+    static thread_local DBHandler db("data/lotus.db");
+    return db;
+}
+
+LoginResult authenticate_login(std::string_view username, std::string_view password, DBHandler& db, SessionManager& session_mgr)
+{
+    if (username.empty() || password.empty())
+    {
+        LOG_ERROR("Missing parameters: Login request for user " + std::string(username) + " without password or vice versa");
+        return {LoginOutcome::MISSING_PARAMS, invalid_response("Missing parameters", "Username and password are required")};
+    }
+    return authenticate(std::string(username), std::string(password), db, session_mgr);
+}
+
+LoginResult authenticate_login(std::string_view username, std::string_view password)
+{
+    return authenticate_login(username, password, thread_db(), session_manager);
+}
+
+std::string handle_auth_login(std::string_view username, std::string_view password)
+{
+    return authenticate_login(username, password).response;
 }
 
 // Legacy wrapper for production use
 std::string handle_auth_login(const std::map<std::string, std::string> &params)
 {
-    static DBHandler db("data/lotus.db");
-    extern SessionManager session_manager;
-    return handle_auth_login_modular(params, db, session_manager);
+    return handle_auth_login_modular(params, thread_db(), session_manager);
 }
 
 // Testable overload for unit tests
@@ -2,12 +2,28 @@
 #define LOGIN_HPP
 #include <string>
 #include <map>
+#include <string_view>
 
 class DBHandler;
 class SessionManager;
 
+// How an AuthLogin attempt ended. Only BAD_CREDENTIALS says anything about
+// the username; the others (a database outage, say) must not count against it.
+enum class LoginOutcome { SUCCESS, MISSING_PARAMS, BAD_CREDENTIALS, SERVER_ERROR };
+
+struct LoginResult {
+    LoginOutcome outcome;
+    // The AuthLogin response body
+    std::string response;
+};
+
 // Returns a response string for AuthLogin, given query params. Checks 'limit' param for validity.
 std::string handle_auth_login(const std::map<std::string, std::string>& params);
 std::string handle_auth_login(const std::map<std::string, std::string>& params, DBHandler& db, SessionManager& session_mgr);
+// Same, for credentials already taken (and decoded) from a parsed request
+std::string handle_auth_login(std::string_view username, std::string_view password);
+// The same login, with its outcome
+LoginResult authenticate_login(std::string_view username, std::string_view password);
+LoginResult authenticate_login(std::string_view username, std::string_view password, DBHandler& db, SessionManager& session_mgr);
 
 #endif // LOGIN_HPP
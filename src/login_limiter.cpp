@@ -0,0 +1,107 @@
+#include "login_limiter.hpp"
+#include <algorithm>
+
+// Locks are taken per shard; a shard's slots are probed this far from the
+// key's home slot before the oldest of them is evicted
+#define LIMITER_SHARDS 16
+#define LIMITER_PROBE 8
+
+LoginLimiter::Table::Table(size_t slots) : shards_(LIMITER_SHARDS) {
+    size_t per_shard = LIMITER_PROBE;
+    while (per_shard * LIMITER_SHARDS < slots) per_shard *= 2;
+    shard_slots_ = per_shard;
+    for (Shard& shard : shards_) shard.slots.reset(new Slot[per_shard]());
+}
+
+LoginLimiter::Slot* LoginLimiter::Table::find(uint64_t key, bool insert, bool& created) {
+    created = false;
+    Slot* slots = shards_[shard_of(key)].slots.get();
+    size_t mask = shard_slots_ - 1;
+    // The low bits picked the shard; the high bits pick the home slot
+    size_t home = static_cast<size_t>(key >> 32) & mask;
+    Slot* victim = nullptr;
+    for (size_t i = 0; i < LIMITER_PROBE; ++i) {
+        Slot& slot = slots[(home + i) & mask];
+        if (slot.key == key) return &slot;
+        if (slot.key == 0) {
+            if (!victim || victim->key != 0) victim = &slot;
+        } else if (!victim || (victim->key != 0 && slot.last_ms < victim->last_ms)) {
+            victim = &slot;
+        }
+    }
+    if (!insert) return nullptr;
+    *victim = Slot();
+    victim->key = key;
+    created = true;
+    return victim;
+}
+
+LoginLimiter::LoginLimiter(const Settings& settings, uint64_t seed)
+    : settings_(settings), seed_(seed), ip_table_(settings.slots), user_table_(settings.slots) {}
+
+uint64_t LoginLimiter::hash(const void* data, size_t len) const {
+    // Seeded FNV-1a with a final avalanche, so colliding keys can't be
+    // chosen offline
+    uint64_t h = 14695981039346656037ull ^ seed_;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+LoginLimiter::Verdict LoginLimiter::check(uint32_t ipv4, std::string_view username, uint64_t now_ms) {
+    if (settings_.ip_burst > 0) {
+        uint64_t key = hash(&ipv4, sizeof(ipv4));
+        std::lock_guard<std::mutex> lock(ip_table_.lock_for(key));
+        bool created;
+        Slot* bucket = ip_table_.find(key, true, created);
+        double burst = settings_.ip_burst;
+        if (created) {
+            bucket->value = burst;
+        } else if (settings_.ip_refill_ms > 0 && now_ms > bucket->last_ms) {
+            bucket->value = std::min(burst, bucket->value + static_cast<double>(now_ms - bucket->last_ms) / settings_.ip_refill_ms);
+        }
+        bucket->last_ms = now_ms;
+        if (bucket->value < 1) return Verdict::IP_LIMITED;
+        bucket->value -= 1;
+    }
+    if (settings_.max_failures > 0) {
+        uint64_t key = hash(username.data(), username.size());
+        std::lock_guard<std::mutex> lock(user_table_.lock_for(key));
+        bool created;
+        // Only failures create entries, so unknown names don't churn the table
+        Slot* failures = user_table_.find(key, false, created);
+        if (failures) {
+            decay_failures(*failures, now_ms);
+            if (failures->value >= settings_.max_failures) return Verdict::USER_LOCKED;
+        }
+    }
+    return Verdict::ALLOW;
+}
+
+void LoginLimiter::record(std::string_view username, bool success, uint64_t now_ms) {
+    if (settings_.max_failures == 0) return;
+    uint64_t key = hash(username.data(), username.size());
+    std::lock_guard<std::mutex> lock(user_table_.lock_for(key));
+    bool created;
+    Slot* failures = user_table_.find(key, !success, created);
+    if (!failures) return;
+    if (success) {
+        failures->value = 0;
+        return;
+    }
+    if (created) failures->last_ms = now_ms;
+    decay_failures(*failures, now_ms);
+    failures->value += 1;
+}
+
+void LoginLimiter::decay_failures(Slot& failures, uint64_t now_ms) const {
+    // Whole failures only, so the lock engages at exactly max_failures
+    if (settings_.failure_decay_ms == 0 || now_ms <= failures.last_ms) return;
+    uint64_t steps = (now_ms - failures.last_ms) / settings_.failure_decay_ms;
+    if (steps == 0) return;
+    failures.value = steps >= failures.value ? 0 : failures.value - static_cast<double>(steps);
+    failures.last_ms = failures.value == 0 ? now_ms : failures.last_ms + steps * settings_.failure_decay_ms;
+}
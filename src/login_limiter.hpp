@@ -0,0 +1,77 @@
+#ifndef LOGIN_LIMITER_HPP
+#define LOGIN_LIMITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Throttles AuthLogin before any SQLite or bcrypt work runs: a token bucket
+// per source address, and a failure count per username that decays over
+// time. Both live in fixed-size tables, so millions of distinct keys cost no
+// more memory than a few; when a probe window is full its least recently
+// seen entry is evicted. Every check is a bounded probe under one shard's
+// lock. Thread-safe.
+class LoginLimiter {
+public:
+    struct Settings {
+        // Logins an address may make back to back, and how often it earns
+        // one more (burst 0 = no address limit)
+        uint32_t ip_burst = 10;
+        uint32_t ip_refill_ms = 6000;
+        // Failed logins that lock a username, and how long it takes for one
+        // of them to be forgotten (0 = no username limit)
+        uint32_t max_failures = 5;
+        uint32_t failure_decay_ms = 60000;
+        // Entries per table, rounded up to a power of two
+        size_t slots = 65536;
+    };
+
+    enum class Verdict { ALLOW, IP_LIMITED, USER_LOCKED };
+
+    LoginLimiter(const Settings& settings, uint64_t seed);
+
+    // Spends one of the address's tokens, then checks the username
+    Verdict check(uint32_t ipv4, std::string_view username, uint64_t now_ms);
+    // Outcome of a login that was allowed; success clears the username's count
+    void record(std::string_view username, bool success, uint64_t now_ms);
+
+    size_t capacity() const { return ip_table_.capacity(); }
+
+private:
+    struct Slot {
+        uint64_t key = 0;  // 0 = empty
+        uint64_t last_ms = 0;
+        double value = 0;  // tokens left, or failures
+    };
+
+    class Table {
+    public:
+        explicit Table(size_t slots);
+        // Called with the key's shard locked. Returns null if absent and
+        // !insert; a new entry has key set and value 0.
+        Slot* find(uint64_t key, bool insert, bool& created);
+        std::mutex& lock_for(uint64_t key) { return shards_[shard_of(key)].mutex; }
+        size_t capacity() const { return shards_.size() * shard_slots_; }
+    private:
+        struct Shard {
+            std::mutex mutex;
+            std::unique_ptr<Slot[]> slots;
+        };
+        size_t shard_of(uint64_t key) const { return key & (shards_.size() - 1); }
+        std::vector<Shard> shards_;
+        size_t shard_slots_;
+    };
+
+    uint64_t hash(const void* data, size_t len) const;
+    void decay_failures(Slot& failures, uint64_t now_ms) const;
+
+    Settings settings_;
+    uint64_t seed_;
+    Table ip_table_;
+    Table user_table_;
+};
+
+#endif // LOGIN_LIMITER_HPP
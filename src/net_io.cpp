@@ -0,0 +1,25 @@
+#include "net_io.hpp"
+#include <sys/socket.h>
+
+namespace {
+thread_local int capture_fd = -1;
+thread_local std::string* capture_out = nullptr;
+}
+
+ssize_t net_send(int fd, const void* data, size_t len) {
+    if (capture_out && fd == capture_fd) {
+        capture_out->append(static_cast<const char*>(data), len);
+        return static_cast<ssize_t>(len);
+    }
+    return send(fd, data, len, MSG_NOSIGNAL);
+}
+
+SendCapture::SendCapture(int fd, std::string& out) : prev_fd_(capture_fd), prev_out_(capture_out) {
+    capture_fd = fd;
+    capture_out = &out;
+}
+
+SendCapture::~SendCapture() {
+    capture_fd = prev_fd_;
+    capture_out = prev_out_;
+}
@@ -0,0 +1,24 @@
+#ifndef NET_IO_HPP
+#define NET_IO_HPP
+
+#include <string>
+#include <sys/types.h>
+
+// Sends bytes to a client. Handlers use this instead of send() so the I/O
+// backend can take over the write (see SendCapture).
+ssize_t net_send(int fd, const void* data, size_t len);
+
+// While alive, net_send() calls for fd on this thread are appended to `out`
+// instead of being written to the socket. Captures nest.
+class SendCapture {
+public:
+    SendCapture(int fd, std::string& out);
+    ~SendCapture();
+    SendCapture(const SendCapture&) = delete;
+    SendCapture& operator=(const SendCapture&) = delete;
+private:
+    int prev_fd_;
+    std::string* prev_out_;
+};
+
+#endif // NET_IO_HPP
@@ -0,0 +1,60 @@
+#include "output_queue.hpp"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+
+// Buffers gathered into one sendmsg()
+#define MAX_IOV 64
+// Written buffers left at the front before the vector is compacted
+#define COMPACT_AFTER 32
+
+OutputQueue::~OutputQueue() {
+    for (size_t i = head_; i < chunks_.size(); ++i) BufferPool::release_string(std::move(chunks_[i]));
+}
+
+OutputQueue::FlushResult OutputQueue::flush(int fd) {
+    while (bytes_ > 0) {
+        iovec iov[MAX_IOV];
+        size_t count = 0;
+        for (size_t i = head_; i < chunks_.size() && count < MAX_IOV; ++i, ++count) {
+            size_t skip = count == 0 ? front_offset_ : 0;
+            iov[count].iov_base = const_cast<char*>(chunks_[i].data()) + skip;
+            iov[count].iov_len = chunks_[i].size() - skip;
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        // More buffers behind this batch: let the kernel hold back a partial segment
+        int flags = MSG_NOSIGNAL | (head_ + count < chunks_.size() ? MSG_MORE : 0);
+        ssize_t sent = sendmsg(fd, &msg, flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return FlushResult::BLOCKED;
+            return FlushResult::FAILED;
+        }
+        consume(static_cast<size_t>(sent));
+    }
+    return FlushResult::DRAINED;
+}
+
+void OutputQueue::consume(size_t n) {
+    bytes_ -= n;
+    while (n > 0) {
+        size_t left = chunks_[head_].size() - front_offset_;
+        if (n < left) {
+            front_offset_ += n;
+            return;
+        }
+        n -= left;
+        BufferPool::release_string(std::move(chunks_[head_++]));
+        front_offset_ = 0;
+    }
+    if (head_ == chunks_.size()) {
+        chunks_.clear();
+        head_ = 0;
+    } else if (head_ >= COMPACT_AFTER && head_ * 2 >= chunks_.size()) {
+        // A slow reader with output still queued behind what was written
+        chunks_.erase(chunks_.begin(), chunks_.begin() + head_);
+        head_ = 0;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef OUTPUT_QUEUE_HPP
+#define OUTPUT_QUEUE_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "buffer_pool.hpp"
+
+// Bytes waiting to be written to one non-blocking client socket. Buffers are
+// queued whole and written with gathered sendmsg() calls; a short write
+// leaves the remainder at the front for the next EPOLLOUT. Written buffers go
+// back to the thread's BufferPool.
+class OutputQueue {
+public:
+    enum class FlushResult {
+        DRAINED,  // everything was written
+        BLOCKED,  // the socket buffer is full; wait for EPOLLOUT
+        FAILED    // the peer is gone
+    };
+
+    OutputQueue() = default;
+    ~OutputQueue();
+    OutputQueue(OutputQueue&& other) noexcept
+        : chunks_(std::move(other.chunks_)), head_(std::exchange(other.head_, 0)),
+          front_offset_(std::exchange(other.front_offset_, 0)), bytes_(std::exchange(other.bytes_, 0)) {}
+    OutputQueue& operator=(OutputQueue&&) = delete;
+
+    void push(std::string data) {
+        if (data.empty()) {
+            BufferPool::release_string(std::move(data));
+            return;
+        }
+        bytes_ += data.size();
+        chunks_.push_back(std::move(data));
+    }
+    FlushResult flush(int fd);
+
+    size_t size() const { return bytes_; }
+    bool empty() const { return bytes_ == 0; }
+
+private:
+    void consume(size_t n);
+
+    // Unwritten buffers start at head_; the vector keeps its capacity when
+    // the queue drains
+    std::vector<std::string> chunks_;
+    size_t head_ = 0;
+    // Bytes of chunks_[head_] already written
+    size_t front_offset_ = 0;
+    size_t bytes_ = 0;
+};
+
+#endif // OUTPUT_QUEUE_HPP
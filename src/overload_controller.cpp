@@ -0,0 +1,38 @@
+#include "overload_controller.hpp"
+#include "logger.hpp"
+#include <cmath>
+
+OverloadController::Clock::duration OverloadController::control_interval() const {
+    double scale = 1.0 / std::sqrt(static_cast<double>(count_ ? count_ : 1));
+    return std::chrono::duration_cast<Clock::duration>(interval_ * scale);
+}
+
+void OverloadController::on_sample(Clock::time_point now, Clock::duration delay) {
+    if (delay < target_) {
+        first_above_ = Clock::time_point{};
+        if (dropping_) {
+            dropping_ = false;
+            LOG("Overload cleared; " + std::to_string(shed_count_) + " connections shed so far");
+        }
+        return;
+    }
+    if (first_above_ == Clock::time_point{}) {
+        first_above_ = now + interval_;
+        return;
+    }
+    if (!dropping_ && now >= first_above_) {
+        dropping_ = true;
+        // Re-entering soon after the last episode resumes near the old rate
+        count_ = (count_ > 2 && now - drop_next_ < interval_ * 16) ? count_ - 2 : 1;
+        drop_next_ = now;
+        LOG_ERROR("Overload: accept-to-first-byte delay above target for a full interval; shedding new connections");
+    }
+}
+
+bool OverloadController::should_shed(Clock::time_point now) {
+    if (!dropping_ || now < drop_next_) return false;
+    ++count_;
+    ++shed_count_;
+    drop_next_ = now + control_interval();
+    return true;
+}
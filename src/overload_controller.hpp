@@ -0,0 +1,40 @@
+#ifndef OVERLOAD_CONTROLLER_HPP
+#define OVERLOAD_CONTROLLER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// CoDel-style admission controller. Samples are the delay between accepting
+// a connection and reading its first byte, i.e. how long the request sat
+// queued behind work already on the loop. Once that delay stays above
+// `target` for a whole `interval`, new connections are shed on the CoDel
+// schedule (interval / sqrt(count)) until a sample drops below target again.
+// One instance per worker; not thread-safe.
+class OverloadController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    OverloadController(Clock::duration target, Clock::duration interval)
+        : target_(target), interval_(interval) {}
+
+    // Records the accept-to-first-byte delay of one connection
+    void on_sample(Clock::time_point now, Clock::duration delay);
+    // True if the connection being accepted now should be rejected
+    bool should_shed(Clock::time_point now);
+
+    bool overloaded() const { return dropping_; }
+    uint64_t shed_count() const { return shed_count_; }
+
+private:
+    Clock::duration control_interval() const;
+
+    Clock::duration target_;
+    Clock::duration interval_;
+    Clock::time_point first_above_{};
+    Clock::time_point drop_next_{};
+    bool dropping_ = false;
+    uint32_t count_ = 0;
+    uint64_t shed_count_ = 0;
+};
+
+#endif // OVERLOAD_CONTROLLER_HPP
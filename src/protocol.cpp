@@ -0,0 +1,45 @@
+#include "protocol.hpp"
+
+namespace {
+const char* const PROTOCOL_NAMES[] = {"UNKNOWN", "HTTP", "CUSTOM1", "CUSTOM2", "AUTO"};
+static_assert(sizeof(PROTOCOL_NAMES) / sizeof(PROTOCOL_NAMES[0]) == static_cast<size_t>(Protocol::COUNT),
+              "every protocol needs a name");
+
+// Request methods the HTTP handlers can see; each ends at the first space
+constexpr std::string_view HTTP_METHODS[] = {"GET ", "POST ", "HEAD ", "PUT ", "DELETE ", "OPTIONS ", "PATCH "};
+
+// Smallest NPS header: message id and total length
+constexpr size_t NPS_HEADER_SIZE = 4;
+} // namespace
+
+const char* protocol_name(Protocol protocol) {
+    size_t index = static_cast<size_t>(protocol);
+    return index < static_cast<size_t>(Protocol::COUNT) ? PROTOCOL_NAMES[index] : PROTOCOL_NAMES[0];
+}
+
+Protocol protocol_from_name(std::string_view name) {
+    for (size_t i = 1; i < static_cast<size_t>(Protocol::COUNT); ++i) {
+        if (name == PROTOCOL_NAMES[i]) return static_cast<Protocol>(i);
+    }
+    return Protocol::UNKNOWN;
+}
+
+Protocol sniff_protocol(std::string_view head, bool peer_closed, Protocol fallback) {
+    if (fallback == Protocol::AUTO || fallback == Protocol::UNKNOWN) fallback = Protocol::CUSTOM2;
+    bool maybe_http = false;
+    for (std::string_view method : HTTP_METHODS) {
+        if (head.size() >= method.size()) {
+            if (head.compare(0, method.size(), method) == 0) return Protocol::HTTP;
+        } else if (method.compare(0, head.size(), head) == 0) {
+            maybe_http = true;
+        }
+    }
+    if (head.size() < NPS_HEADER_SIZE || maybe_http) {
+        return peer_closed ? fallback : Protocol::UNKNOWN;
+    }
+    // NPS message ids are small binary values (0x0501 login, ...); text
+    // starts at 0x20, so it never looks like one
+    bool binary_id = static_cast<uint8_t>(head[0]) < 0x20;
+    size_t length = (static_cast<uint8_t>(head[2]) << 8) | static_cast<uint8_t>(head[3]);
+    return binary_id && length >= NPS_HEADER_SIZE ? Protocol::CUSTOM1 : fallback;
+}
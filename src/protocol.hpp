@@ -0,0 +1,30 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <cstdint>
+#include <string_view>
+
+// Wire protocols the server speaks. The values index the dispatch tables in
+// protocol_dispatch.cpp and server_config.cpp.
+enum class Protocol : uint8_t {
+    UNKNOWN = 0,  // not sniffed yet
+    HTTP,
+    CUSTOM1,
+    CUSTOM2,
+    AUTO,         // listener only: sniff every connection (unknown -> CUSTOM2)
+    COUNT
+};
+
+// "HTTP", "CUSTOM1", ... as used in logs and the hot-restart handoff
+const char* protocol_name(Protocol protocol);
+// Inverse of protocol_name(); UNKNOWN for anything else
+Protocol protocol_from_name(std::string_view name);
+
+// Classifies a connection from its first bytes, like the old TypeScript
+// detectProtocol: an HTTP method token means HTTP, a plausible NPS header
+// (binary u16 message id, u16 total length >= 4) means CUSTOM1, and anything else
+// goes to `fallback` (CUSTOM2 for AUTO listeners). Returns UNKNOWN while
+// more bytes are needed to decide, unless the peer has closed.
+Protocol sniff_protocol(std::string_view head, bool peer_closed, Protocol fallback);
+
+#endif // PROTOCOL_HPP
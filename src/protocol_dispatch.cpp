@@ -0,0 +1,180 @@
+#include "protocol_dispatch.hpp"
+#include "http_handlers.hpp"
+#include "http_framing.hpp"
+#include "custom1_handlers.hpp"
+#include "custom2_handlers.hpp"
+#include "custom2_protocol.hpp"
+#include "deferred_response.hpp"
+#include "logger.hpp"
+#include "net_io.hpp"
+#include "buffer_pool.hpp"
+#include "request_arena.hpp"
+#include <cstring>
+#include <sys/socket.h>
+
+// Smallest frame that still carries its message id and length
+#define CUSTOM1_MIN_FRAME 4
+
+size_t custom1_frame_length(std::string_view buffered) {
+    if (buffered.size() < CUSTOM1_MIN_FRAME) return 0;
+    size_t frame_len = (static_cast<uint8_t>(buffered[2]) << 8) | static_cast<uint8_t>(buffered[3]);
+    if (frame_len < CUSTOM1_MIN_FRAME) return std::string_view::npos;
+    return buffered.size() >= frame_len ? frame_len : 0;
+}
+
+size_t custom2_frame_length(std::string_view buffered) {
+    if (buffered.empty()) return 0;
+    // A bad marker or reserved byte fails as soon as it arrives
+    if (static_cast<uint8_t>(buffered[0]) != CUSTOM2_MARKER || (buffered.size() > 1 && buffered[1] != 0)) {
+        return std::string_view::npos;
+    }
+    if (buffered.size() < CUSTOM2_HEADER_SIZE) return 0;
+    size_t frame_len = CUSTOM2_HEADER_SIZE + ((static_cast<uint8_t>(buffered[6]) << 8) | static_cast<uint8_t>(buffered[7]));
+    return buffered.size() >= frame_len ? frame_len : 0;
+}
+
+namespace {
+using Processor = ConnAction (*)(int client_fd, StreamBuffer& in, ConnContext& ctx, bool peer_closed);
+
+// Nothing to dispatch to until the protocol is known
+ConnAction process_unknown(int, StreamBuffer&, ConnContext&, bool peer_closed) {
+    return peer_closed ? ConnAction::CLOSE : ConnAction::KEEP_READING;
+}
+
+// The handler deferred its answer; complete_deferred() picks up from here
+ConnAction await_response(ConnContext& ctx, bool close_after, bool http10) {
+    ctx.awaiting_response = true;
+    ctx.close_after_response = close_after;
+    ctx.http10 = http10;
+    return ConnAction::KEEP_READING;
+}
+
+// Answers every complete request in the buffer, in order
+ConnAction process_http(int client_fd, StreamBuffer& in, ConnContext& ctx, bool peer_closed) {
+    // Later requests wait for the deferred answer; the worker stops reading
+    if (ctx.awaiting_response) return ConnAction::KEEP_READING;
+    while (!in.empty()) {
+        HttpRequestFrame frame;
+        if (!parse_http_frame(in.view(), frame)) {
+            if (!peer_closed) return ConnAction::KEEP_READING;
+            // A client that hung up mid-request still gets an answer
+            HttpRequestView request;
+            if (parse_http_request(in.data(), in.size(), request)) handle_http_request(client_fd, request);
+            in.clear();
+            if (take_deferred()) return await_response(ctx, true, false);
+            return ConnAction::CLOSE;
+        }
+        if (frame.error_status != 0) {
+            LOG_ERROR_PARTS("Unframeable HTTP request on fd ", client_fd, " (", frame.error_status, "); closing connection");
+            std::string response = http_error_response(frame.error_status);
+            net_send(client_fd, response.data(), response.size());
+            in.clear();
+            return ConnAction::CLOSE;
+        }
+        ++ctx.requests_served;
+        bool last = !frame.keep_alive || (ctx.max_requests > 0 && ctx.requests_served >= ctx.max_requests);
+        // Captured so the Connection header can be added before it goes out
+        std::string response = BufferPool::acquire_string();
+        {
+            SendCapture capture(client_fd, response);
+            ArenaScope scratch;
+            // Parsed in place; the views die with this frame
+            HttpRequestView request;
+            if (parse_http_request(in.data(), frame.head_length, request)) handle_http_request(client_fd, request);
+        }
+        in.consume(frame.total_length);
+        if (take_deferred()) {
+            BufferPool::release_string(std::move(response));
+            return await_response(ctx, last, frame.http10);
+        }
+        if (response.empty()) {
+            response = http_error_response(400);
+            last = true;
+        } else {
+            set_connection_header(response, !last, frame.http10);
+        }
+        net_send(client_fd, response.data(), response.size());
+        BufferPool::release_string(std::move(response));
+        if (last) return ConnAction::CLOSE;
+    }
+    return peer_closed ? ConnAction::CLOSE : ConnAction::KEEP_READING;
+}
+
+ConnAction process_custom1(int client_fd, StreamBuffer& in, ConnContext& ctx, bool peer_closed) {
+    // A login is being decrypted; frames behind it wait
+    if (ctx.awaiting_response) return ConnAction::KEEP_READING;
+    while (true) {
+        size_t frame_len = custom1_frame_length(in.view());
+        if (frame_len == std::string_view::npos) {
+            LOG_ERROR_PARTS("Invalid Custom Protocol 1 frame length on fd ", client_fd, "; closing connection");
+            return ConnAction::CLOSE;
+        }
+        if (frame_len == 0) break;
+        {
+            ArenaScope scratch;
+            // After the login, decrypted in the receive buffer it arrived in
+            if (ctx.cipher.ready() && frame_len > CUSTOM1_CLEAR_HEADER) {
+                ctx.cipher.decrypt(reinterpret_cast<uint8_t*>(in.data()) + CUSTOM1_CLEAR_HEADER, frame_len - CUSTOM1_CLEAR_HEADER);
+            }
+            // Pass client_fd as connection_id for now
+            handle_custom1_packet(client_fd, std::string_view(in.data(), frame_len), client_fd, &ctx);
+        }
+        in.consume(frame_len);
+        if (take_deferred()) return await_response(ctx, false, false);
+    }
+    return peer_closed ? ConnAction::CLOSE : ConnAction::KEEP_READING;
+}
+
+// Answers every complete frame straight from the receive buffer. The
+// replies are gathered in one buffer and handed to net_send() once, so a
+// read full of pipelined requests costs a single send.
+ConnAction process_custom2(int client_fd, StreamBuffer& in, ConnContext&, bool peer_closed) {
+    ConnAction action = peer_closed ? ConnAction::CLOSE : ConnAction::KEEP_READING;
+    std::string replies = BufferPool::acquire_string();
+    while (true) {
+        size_t frame_len = custom2_frame_length(in.view());
+        if (frame_len == std::string_view::npos) {
+            LOG_ERROR_PARTS("Invalid Custom Protocol 2 frame header on fd ", client_fd, "; closing connection");
+            custom2_append_frame(replies, CUSTOM2_ERROR, 0, "bad frame header");
+            in.clear();
+            action = ConnAction::CLOSE;
+            break;
+        }
+        if (frame_len == 0) break;
+        {
+            ArenaScope scratch;
+            handle_custom2_frame(client_fd, std::string_view(in.data(), frame_len), replies);
+        }
+        in.consume(frame_len);
+    }
+    if (!replies.empty()) net_send(client_fd, replies.data(), replies.size());
+    BufferPool::release_string(std::move(replies));
+    return action;
+}
+
+// Indexed by Protocol
+const Processor PROCESSORS[] = {process_unknown, process_http, process_custom1, process_custom2, process_unknown};
+static_assert(sizeof(PROCESSORS) / sizeof(PROCESSORS[0]) == static_cast<size_t>(Protocol::COUNT),
+              "every protocol needs a processor");
+} // namespace
+
+ConnAction process_input(int client_fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, bool peer_closed) {
+    return PROCESSORS[static_cast<size_t>(protocol)](client_fd, in, ctx, peer_closed);
+}
+
+ConnAction complete_deferred(int client_fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, std::string response) {
+    ctx.awaiting_response = false;
+    if (protocol == Protocol::HTTP) set_connection_header(response, !ctx.close_after_response, ctx.http10);
+    if (!response.empty()) net_send(client_fd, response.data(), response.size());
+    if (ctx.close_after_response) return ConnAction::CLOSE;
+    return process_input(client_fd, protocol, in, ctx, false);
+}
+
+void reject_connection(int client_fd, Protocol protocol) {
+    if (protocol == Protocol::HTTP) {
+        static const char response[] =
+            "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        // Best effort on a fresh socket; the send buffer is empty
+        send(client_fd, response, sizeof(response) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+}
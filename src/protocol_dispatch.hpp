@@ -0,0 +1,68 @@
+#ifndef PROTOCOL_DISPATCH_HPP
+#define PROTOCOL_DISPATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "protocol.hpp"
+#include "stream_buffer.hpp"
+#include "stream_cipher.hpp"
+
+// Shared by every I/O backend: decides when buffered input can be handed to
+// a protocol handler, and hands it over.
+
+enum class ConnAction {
+    KEEP_READING, // connection stays open for more input
+    CLOSE         // close once pending output is flushed
+};
+
+// Per-connection dispatch state, owned by the I/O backend's Connection
+struct ConnContext {
+    // Unique per worker; tells a deferred answer's connection from a later
+    // one that reused its fd
+    uint64_t id = 0;
+    uint32_t requests_served = 0;
+    // HTTP requests answered before the connection is closed; 0 = no limit
+    uint32_t max_requests = 0;
+    // A handler deferred its answer (see deferred_response.hpp); no more
+    // input is dispatched until complete_deferred()
+    bool awaiting_response = false;
+    bool close_after_response = false;
+    bool http10 = false;
+    // CUSTOM1: keyed by a 0x501 login's session key, on the worker's
+    // thread; every frame after the login goes through it
+    StreamCipher cipher;
+};
+
+// Consumes complete requests from `in` and runs their handlers; responses
+// go through net_send(). HTTP connections are persistent: pipelined requests
+// are answered in order until one asks to close or ctx.max_requests is hit.
+// CUSTOM1 connections are persistent too: every complete frame is dispatched
+// as soon as it is buffered, straight from the receive buffer, and decrypted
+// there in place once ctx.cipher is keyed. CUSTOM2 is
+// framed the same way, and the replies to everything one call dispatched go
+// out in a single net_send(). UNKNOWN (not yet sniffed) dispatches nothing.
+ConnAction process_input(int client_fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, bool peer_closed);
+
+// Sends the answer to the request the connection was waiting on, then
+// dispatches whatever was pipelined behind it
+ConnAction complete_deferred(int client_fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, std::string response);
+
+// Cheap rejection for a connection shed by admission control, sent before
+// any handler (and so any bcrypt or RSA work) runs. HTTP clients get a 503
+// with Retry-After; the binary protocols (and connections not yet sniffed)
+// are simply closed by the caller.
+void reject_connection(int client_fd, Protocol protocol);
+
+// Length of the first complete CUSTOM1 frame in `buffered` (taken from the
+// big-endian u16 at offset 2), 0 if more bytes are needed, or
+// std::string_view::npos if the length field is invalid.
+size_t custom1_frame_length(std::string_view buffered);
+
+// Length of the first complete CUSTOM2 frame in `buffered` (header plus the
+// big-endian u16 payload length at offset 6), 0 if more bytes are needed,
+// or std::string_view::npos if the marker or reserved byte is wrong.
+size_t custom2_frame_length(std::string_view buffered);
+
+#endif // PROTOCOL_DISPATCH_HPP
@@ -0,0 +1,89 @@
+#include "request_arena.hpp"
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+// Blocks form one chain in allocation order; the data follows the header
+struct RequestArena::Block {
+    Block* next;
+    size_t size;
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+    char* end() { return data() + size; }
+};
+
+namespace {
+char* align_up(char* p, size_t align) {
+    uintptr_t v = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((v + align - 1) & ~static_cast<uintptr_t>(align - 1));
+}
+} // namespace
+
+RequestArena::~RequestArena() {
+    while (first_) {
+        Block* next = first_->next;
+        ::operator delete(first_);
+        first_ = next;
+    }
+}
+
+void* RequestArena::allocate(size_t n, size_t align) {
+    if (current_) {
+        char* p = align_up(ptr_, align);
+        if (p <= end_ && static_cast<size_t>(end_ - p) >= n) {
+            ptr_ = p + n;
+            return p;
+        }
+    }
+    return allocate_slow(n, align);
+}
+
+void* RequestArena::allocate_slow(size_t n, size_t align) {
+    size_t needed = n + align;
+    Block* next = current_ ? current_->next : first_;
+    if (!next || next->size < needed) {
+        // Spliced in ahead of any smaller blocks, which stay for later
+        size_t size = needed > block_size_ ? needed : block_size_;
+        Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+        block->size = size;
+        block->next = next;
+        if (current_) {
+            current_->next = block;
+        } else {
+            first_ = block;
+        }
+        capacity_ += size;
+        next = block;
+    }
+    current_ = next;
+    char* p = align_up(current_->data(), align);
+    ptr_ = p + n;
+    end_ = current_->end();
+    return p;
+}
+
+std::string_view RequestArena::copy(std::string_view s) {
+    char* p = allocate_array<char>(s.size());
+    if (!s.empty()) std::memcpy(p, s.data(), s.size());
+    return std::string_view(p, s.size());
+}
+
+void RequestArena::rewind(Mark m) {
+    current_ = m.block;
+    ptr_ = m.ptr;
+    end_ = m.block ? m.block->end() : nullptr;
+    if (m.block || capacity_ <= REQUEST_ARENA_MAX_RETAINED || !first_) return;
+    // Empty again after an unusually large request; keep only the first block
+    Block* extra = first_->next;
+    first_->next = nullptr;
+    capacity_ = first_->size;
+    while (extra) {
+        Block* next = extra->next;
+        ::operator delete(extra);
+        extra = next;
+    }
+}
+
+RequestArena& RequestArena::local() {
+    thread_local RequestArena arena;
+    return arena;
+}
@@ -0,0 +1,84 @@
+#ifndef REQUEST_ARENA_HPP
+#define REQUEST_ARENA_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+// Size of the arena's first block, and of each block chained on after it
+#define REQUEST_ARENA_BLOCK (16 * 1024)
+// Held across requests; a request that needed more gives the rest back once
+// the arena is empty again
+#define REQUEST_ARENA_MAX_RETAINED (256 * 1024)
+
+// Bump allocator for scratch memory that lives as long as one request (hex
+// dumps, copies of fields a handler keeps until it returns). allocate() is a
+// pointer bump and nothing is freed on its own: an ArenaScope around each
+// dispatched request rewinds the arena afterwards, and the next request
+// reuses the same bytes.
+//
+// A request that outgrows the current block chains on another. Blocks are
+// kept when the arena rewinds, so once every block a request needs exists
+// the arena no longer touches the heap.
+class RequestArena {
+    struct Block;
+
+public:
+    explicit RequestArena(size_t block_size = REQUEST_ARENA_BLOCK) : block_size_(block_size) {}
+    ~RequestArena();
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // Never null; align must be a power of two
+    void* allocate(size_t n, size_t align = alignof(std::max_align_t));
+    // Uninitialised; nothing allocated here is destroyed, so T must not need it
+    template <typename T>
+    T* allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+    // The bytes copied into the arena
+    std::string_view copy(std::string_view s);
+
+    struct Mark {
+        Block* block;
+        char* ptr;
+    };
+    Mark mark() const { return Mark{current_, ptr_}; }
+    // Frees everything allocated since m was taken
+    void rewind(Mark m);
+    void reset() { rewind(Mark{nullptr, nullptr}); }
+
+    // Bytes of blocks held, used or not
+    size_t capacity() const { return capacity_; }
+
+    // The calling thread's arena, which the request path draws from
+    static RequestArena& local();
+
+private:
+    void* allocate_slow(size_t n, size_t align);
+
+    size_t block_size_;
+    Block* first_ = nullptr;
+    Block* current_ = nullptr;
+    char* ptr_ = nullptr;
+    char* end_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+// Rewinds this thread's arena to where it was when the scope began
+class ArenaScope {
+public:
+    ArenaScope() : arena_(RequestArena::local()), mark_(arena_.mark()) {}
+    ~ArenaScope() { arena_.rewind(mark_); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    RequestArena& arena() { return arena_; }
+
+private:
+    RequestArena& arena_;
+    RequestArena::Mark mark_;
+};
+
+#endif // REQUEST_ARENA_HPP
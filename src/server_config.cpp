@@ -0,0 +1,80 @@
+#include "server_config.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+int env_int(const char* name, int fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return fallback;
+    char* end = nullptr;
+    long parsed = std::strtol(v, &end, 10);
+    if (*end != '\0') return fallback;
+    return static_cast<int>(parsed);
+}
+
+bool env_bool(const char* name, bool fallback) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return fallback;
+    std::string s(v);
+    return s == "1" || s == "true" || s == "yes" || s == "on";
+}
+} // namespace
+
+ServerConfig ServerConfig::from_env() {
+    ServerConfig cfg;
+    cfg.workers = env_int("OXIDE_WORKERS", cfg.workers);
+    cfg.pin_workers = env_bool("OXIDE_PIN_WORKERS", cfg.pin_workers);
+    cfg.reuseport_cbpf = env_bool("OXIDE_REUSEPORT_CBPF", cfg.reuseport_cbpf);
+    cfg.listen_backlog = env_int("OXIDE_LISTEN_BACKLOG", cfg.listen_backlog);
+    // A budget of 0 would re-queue a ready listener without ever accepting
+    cfg.accept_budget = std::max(1, env_int("OXIDE_ACCEPT_BUDGET", cfg.accept_budget));
+    cfg.max_connections = env_int("OXIDE_MAX_CONNECTIONS", cfg.max_connections);
+    cfg.overload_target_ms = env_int("OXIDE_OVERLOAD_TARGET_MS", cfg.overload_target_ms);
+    cfg.overload_interval_ms = env_int("OXIDE_OVERLOAD_INTERVAL_MS", cfg.overload_interval_ms);
+    cfg.first_byte_timeout_ms = env_int("OXIDE_FIRST_BYTE_TIMEOUT_MS", cfg.first_byte_timeout_ms);
+    cfg.http_idle_timeout_ms = env_int("OXIDE_HTTP_IDLE_TIMEOUT_MS", cfg.http_idle_timeout_ms);
+    cfg.custom1_idle_timeout_ms = env_int("OXIDE_CUSTOM1_IDLE_TIMEOUT_MS", cfg.custom1_idle_timeout_ms);
+    cfg.custom2_idle_timeout_ms = env_int("OXIDE_CUSTOM2_IDLE_TIMEOUT_MS", cfg.custom2_idle_timeout_ms);
+    cfg.custom1_keepalive_ms = env_int("OXIDE_CUSTOM1_KEEPALIVE_MS", cfg.custom1_keepalive_ms);
+    cfg.http_max_requests = env_int("OXIDE_HTTP_MAX_REQUESTS", cfg.http_max_requests);
+    cfg.auth_threads = env_int("OXIDE_AUTH_THREADS", cfg.auth_threads);
+    cfg.auth_queue_depth = env_int("OXIDE_AUTH_QUEUE_DEPTH", cfg.auth_queue_depth);
+    cfg.login_ip_burst = env_int("OXIDE_LOGIN_IP_BURST", cfg.login_ip_burst);
+    cfg.login_ip_refill_ms = env_int("OXIDE_LOGIN_IP_REFILL_MS", cfg.login_ip_refill_ms);
+    cfg.login_max_failures = env_int("OXIDE_LOGIN_MAX_FAILURES", cfg.login_max_failures);
+    cfg.login_failure_decay_ms = env_int("OXIDE_LOGIN_FAILURE_DECAY_MS", cfg.login_failure_decay_ms);
+    if (const char* proxies = std::getenv("OXIDE_LOGIN_TRUSTED_PROXIES")) cfg.login_trusted_proxies = proxies;
+    cfg.login_limiter_slots = env_int("OXIDE_LOGIN_LIMITER_SLOTS", cfg.login_limiter_slots);
+    cfg.crypto_threads = env_int("OXIDE_CRYPTO_THREADS", cfg.crypto_threads);
+    cfg.crypto_queue_depth = env_int("OXIDE_CRYPTO_QUEUE_DEPTH", cfg.crypto_queue_depth);
+    cfg.key_rotation_window_ms = env_int("OXIDE_KEY_ROTATION_WINDOW_MS", cfg.key_rotation_window_ms);
+    cfg.custom1_verify_crc = env_bool("OXIDE_CUSTOM1_VERIFY_CRC", cfg.custom1_verify_crc);
+    cfg.sniff_protocols = env_bool("OXIDE_SNIFF_PROTOCOLS", cfg.sniff_protocols);
+    cfg.sniff_port = env_int("OXIDE_SNIFF_PORT", cfg.sniff_port);
+    cfg.output_high_watermark = env_int("OXIDE_OUTPUT_HIGH_WATERMARK", cfg.output_high_watermark);
+    cfg.output_low_watermark = env_int("OXIDE_OUTPUT_LOW_WATERMARK", cfg.output_low_watermark);
+    cfg.timer_stats_interval_ms = env_int("OXIDE_TIMER_STATS_INTERVAL_MS", cfg.timer_stats_interval_ms);
+    cfg.drain_timeout_ms = env_int("OXIDE_DRAIN_TIMEOUT_MS", cfg.drain_timeout_ms);
+    if (const char* path = std::getenv("OXIDE_HANDOFF_SOCKET")) cfg.handoff_path = path;
+    const char* backend = std::getenv("OXIDE_IO_BACKEND");
+    if (backend && std::string(backend) == "io_uring") cfg.io_backend = IoBackend::IO_URING;
+    return cfg;
+}
+
+int ServerConfig::idle_timeout_ms(Protocol protocol) const {
+    switch (protocol) {
+        case Protocol::HTTP: return http_idle_timeout_ms;
+        case Protocol::CUSTOM1: return custom1_idle_timeout_ms;
+        case Protocol::CUSTOM2: return custom2_idle_timeout_ms;
+        // Still sniffing: a partial method or header must not stall forever
+        case Protocol::UNKNOWN: return first_byte_timeout_ms;
+        default: return 0;
+    }
+}
+
+int ServerConfig::resolved_workers() const {
+    if (workers > 0) return workers;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? static_cast<int>(cpus) : 1;
+}
@@ -0,0 +1,105 @@
+#ifndef SERVER_CONFIG_HPP
+#define SERVER_CONFIG_HPP
+
+#include <string>
+#include "protocol.hpp"
+
+enum class IoBackend {
+    EPOLL,
+    IO_URING
+};
+
+// Runtime tuning for the network layer. Values come from OXIDE_* environment
+// variables (see .env.example) so the systemd EnvironmentFile can set them.
+struct ServerConfig {
+    // Number of event-loop worker threads; 0 means one per online CPU
+    int workers = 1;
+    // Pin worker N to CPU N
+    bool pin_workers = true;
+    // Attach a classic-BPF SO_REUSEPORT program that keeps each flow on the
+    // worker running on the CPU that received it
+    bool reuseport_cbpf = false;
+    // I/O backend; io_uring falls back to epoll when the kernel lacks support
+    IoBackend io_backend = IoBackend::EPOLL;
+    // listen() backlog for every listener
+    int listen_backlog = 1024;
+    // Connections one listener may accept per turn before the others get
+    // theirs; at least 1
+    int accept_budget = 64;
+    // Per-worker connection cap; further connections are rejected (0 = no cap)
+    int max_connections = 0;
+    // CoDel target and interval for accept-to-first-byte delay
+    int overload_target_ms = 5;
+    int overload_interval_ms = 100;
+    // Time a new connection gets to send its first byte (slowloris guard)
+    int first_byte_timeout_ms = 10000;
+    // Read-idle deadline per protocol, re-armed on every read (0 = none)
+    int http_idle_timeout_ms = 30000;
+    int custom1_idle_timeout_ms = 300000;
+    int custom2_idle_timeout_ms = 30000;
+    // A Custom1 client must complete a frame at least this often (0 = none).
+    // Only a read can complete a frame, so a silent client always hits the
+    // idle deadline first; keep this longer than custom1_idle_timeout_ms so
+    // it only reaps clients that send bytes but never finish a frame.
+    int custom1_keepalive_ms = 600000;
+    // Requests one persistent HTTP connection may carry before it is closed
+    // (0 = no limit); an idle one is closed by http_idle_timeout_ms
+    int http_max_requests = 100;
+    // Threads that run AuthLogin's database lookups and bcrypt check off the
+    // I/O workers (0 = run them inline), and how many logins may wait for one
+    // before new ones get a 503
+    int auth_threads = 2;
+    int auth_queue_depth = 128;
+    // AuthLogin throttling, applied before any database or bcrypt work: each
+    // address may log in login_ip_burst times back to back and earns another
+    // try every login_ip_refill_ms; a username is locked after
+    // login_max_failures failures, one of which is forgotten every
+    // login_failure_decay_ms (0 disables either limit). The address limit is
+    // off by default: behind a reverse proxy every login shares the proxy's
+    // address unless the proxy is listed in login_trusted_proxies.
+    int login_ip_burst = 0;
+    int login_ip_refill_ms = 6000;
+    int login_max_failures = 5;
+    int login_failure_decay_ms = 60000;
+    // Comma-separated IPv4 addresses of reverse proxies whose X-Real-IP (or
+    // X-Forwarded-For) header gives the address to limit
+    std::string login_trusted_proxies;
+    // Entries in each of the limiter's fixed-size tables
+    int login_limiter_slots = 65536;
+    // Threads that decrypt Custom1 0x501 logins off the I/O workers (0 =
+    // decrypt inline), and how many decrypts may wait for one before new
+    // logins fail
+    int crypto_threads = 2;
+    int crypto_queue_depth = 1024;
+    // How long a replaced Custom1 private key still decrypts logins after a
+    // reload (SIGHUP or the file changing), for clients holding the old key
+    int key_rotation_window_ms = 600000;
+    // Drop Custom1 frames whose trailer isn't the CRC-32 of their bytes.
+    // Opt-in: real clients' trailers are not that CRC.
+    bool custom1_verify_crc = false;
+    // Sniff every connection's first bytes and route HTTP and NPS traffic to
+    // its handler whatever the port; other traffic keeps the port's protocol
+    bool sniff_protocols = false;
+    // Extra listener that sniffs every connection (unknown -> Custom2), so a
+    // load balancer can send all traffic to one port (0 = none)
+    int sniff_port = 0;
+    // Stop reading from a client once this many response bytes are queued for
+    // it, and resume when it has drained below the low watermark
+    int output_high_watermark = 256 * 1024;
+    int output_low_watermark = 64 * 1024;
+    // Unix socket used to hand listeners and sessions to a replacement process
+    // during a hot restart (empty = disabled)
+    std::string handoff_path;
+    // How long a replaced process lets open connections finish
+    int drain_timeout_ms = 30000;
+    // How often each worker logs its timer counts (0 = never)
+    int timer_stats_interval_ms = 60000;
+
+    static ServerConfig from_env();
+    // Read-idle deadline for a protocol (0 = none)
+    int idle_timeout_ms(Protocol protocol) const;
+    // Worker count with 0 resolved to the number of online CPUs
+    int resolved_workers() const;
+};
+
+#endif // SERVER_CONFIG_HPP
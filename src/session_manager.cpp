@@ -7,7 +7,7 @@ void SessionManager::set(const std::string& session_id, const std::string& custo
 
 // Returns the customer_id for a given session_id, or std::nullopt if not found
 std::optional<std::string> SessionManager::get(const std::string& session_id) const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mutex_));
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = store_.find(session_id);
     if (it != store_.end()) return it->second;
     return std::nullopt;
@@ -18,6 +18,11 @@ void SessionManager::remove(const std::string& session_id) {
     store_.erase(session_id);
 }
 
+std::vector<std::pair<std::string, std::string>> SessionManager::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<std::pair<std::string, std::string>>(store_.begin(), store_.end());
+}
+
 void SessionManager::clear() {
     std::lock_guard<std::mutex> lock(mutex_);
     store_.clear();
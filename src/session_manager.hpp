@@ -5,16 +5,20 @@
 #include <optional>
 #include <unordered_map>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 class SessionManager {
 public:
     void set(const std::string& session_id, const std::string& customer_id);
     std::optional<std::string> get(const std::string& session_id) const;
     void remove(const std::string& session_id);
+    // Copy of every (session_id, customer_id) pair, e.g. for a hot-restart handoff
+    std::vector<std::pair<std::string, std::string>> entries() const;
     void clear(); // For testability
 private:
     std::unordered_map<std::string, std::string> store_;
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
 };
 
 #endif // SESSION_MANAGER_HPP
@@ -3,9 +3,16 @@
 void ShardManager::add_shard(const ShardInfo& shard) {
     std::lock_guard<std::mutex> lock(mutex_);
     shards_.push_back(shard);
+    generation_.fetch_add(1, std::memory_order_release);
 }
 
 std::vector<ShardInfo> ShardManager::list_shards() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return shards_;
 }
+
+std::vector<ShardInfo> ShardManager::list_shards(uint64_t& generation) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation = generation_.load(std::memory_order_relaxed);
+    return shards_;
+}
@@ -1,6 +1,8 @@
 #ifndef SHARD_MANAGER_HPP
 #define SHARD_MANAGER_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <mutex>
@@ -25,11 +27,18 @@ struct ShardInfo {
 
 class ShardManager {
 public:
+    // Mutators bump the generation, so anything rendered from the list can
+    // be cached until it changes
     void add_shard(const ShardInfo& shard);
     std::vector<ShardInfo> list_shards() const;
+    // The snapshot and the generation it belongs to
+    std::vector<ShardInfo> list_shards(uint64_t& generation) const;
+    // Lock-free; starts at 0 for an empty list
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
 private:
     std::vector<ShardInfo> shards_;
     mutable std::mutex mutex_;
+    std::atomic<uint64_t> generation_{0};
 };
 
 #endif // SHARD_MANAGER_HPP
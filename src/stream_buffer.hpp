@@ -0,0 +1,89 @@
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include "buffer_pool.hpp"
+
+// Growable per-connection receive buffer. Bytes are appended at the back
+// and consumed from the front without moving the rest; unread bytes are
+// only shifted down when the front gap is reused, so several frames in one
+// read are handed out as views with no copies.
+//
+// Storage comes from the thread's BufferPool on the first prepare() and goes
+// back to it on growth and destruction, so opening and closing connections
+// recycles the same blocks.
+class StreamBuffer {
+public:
+    explicit StreamBuffer(size_t initial_capacity = BUFFER_POOL_MIN_CLASS) : initial_(initial_capacity) {}
+    ~StreamBuffer() { BufferPool::release(buf_, cap_); }
+    StreamBuffer(StreamBuffer&& other) noexcept
+        : buf_(std::exchange(other.buf_, nullptr)), cap_(std::exchange(other.cap_, 0)), initial_(other.initial_),
+          read_(std::exchange(other.read_, 0)), write_(std::exchange(other.write_, 0)) {}
+    StreamBuffer& operator=(StreamBuffer&& other) noexcept {
+        if (this != &other) {
+            BufferPool::release(buf_, cap_);
+            buf_ = std::exchange(other.buf_, nullptr);
+            cap_ = std::exchange(other.cap_, 0);
+            initial_ = other.initial_;
+            read_ = std::exchange(other.read_, 0);
+            write_ = std::exchange(other.write_, 0);
+        }
+        return *this;
+    }
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    const char* data() const { return buf_ + read_; }
+    // Lets a parser rewrite buffered bytes in place (e.g. percent-decoding)
+    char* data() { return buf_ + read_; }
+    size_t size() const { return write_ - read_; }
+    bool empty() const { return read_ == write_; }
+    std::string_view view() const { return std::string_view(data(), size()); }
+
+    // Returns space for at least n more bytes; follow with commit()
+    char* prepare(size_t n) {
+        if (cap_ - write_ < n) {
+            if (read_ > 0) {
+                std::memmove(buf_, buf_ + read_, size());
+                write_ -= read_;
+                read_ = 0;
+            }
+            if (cap_ - write_ < n) grow(write_ + n);
+        }
+        return buf_ + write_;
+    }
+    void commit(size_t n) { write_ += n; }
+    void append(const char* p, size_t n) {
+        std::memcpy(prepare(n), p, n);
+        commit(n);
+    }
+    void consume(size_t n) {
+        read_ += n < size() ? n : size();
+        if (read_ == write_) read_ = write_ = 0;
+    }
+    void clear() { read_ = write_ = 0; }
+    size_t capacity() const { return cap_; }
+
+private:
+    void grow(size_t needed) {
+        size_t want = cap_ ? cap_ : (initial_ ? initial_ : 1);
+        while (want < needed) want *= 2;
+        size_t cap;
+        char* buf = BufferPool::acquire(want, &cap);
+        if (write_ > 0) std::memcpy(buf, buf_, write_);
+        BufferPool::release(buf_, cap_);
+        buf_ = buf;
+        cap_ = cap;
+    }
+
+    char* buf_ = nullptr;
+    size_t cap_ = 0;
+    size_t initial_;
+    size_t read_ = 0;
+    size_t write_ = 0;
+};
+
+#endif // STREAM_BUFFER_HPP
@@ -0,0 +1,75 @@
+#include "stream_cipher.hpp"
+#include <climits>
+
+namespace {
+// Counter block of the server-to-client stream; client-to-server starts at 0
+#define TX_COUNTER_TOP 0x80
+
+const EVP_CIPHER* cipher_for(size_t key_len) {
+    switch (key_len) {
+        case 16: return EVP_aes_128_ctr();
+        case 24: return EVP_aes_192_ctr();
+        case 32: return EVP_aes_256_ctr();
+        default: return nullptr;
+    }
+}
+
+EVP_CIPHER_CTX* make_context(const EVP_CIPHER* cipher, const uint8_t* key, const uint8_t* iv) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx && EVP_EncryptInit_ex(ctx, cipher, nullptr, key, iv) == 1) return ctx;
+    EVP_CIPHER_CTX_free(ctx);
+    return nullptr;
+}
+} // namespace
+
+StreamCipher::~StreamCipher() {
+    EVP_CIPHER_CTX_free(rx_);
+    EVP_CIPHER_CTX_free(tx_);
+}
+
+bool StreamCipher::init(const uint8_t* key, size_t len, std::string* err) {
+    const EVP_CIPHER* cipher = cipher_for(len);
+    if (!cipher) {
+        if (err) *err = "Unsupported session key length for stream cipher: " + std::to_string(len);
+        return false;
+    }
+    uint8_t rx_iv[16] = {};
+    uint8_t tx_iv[16] = {TX_COUNTER_TOP};
+    EVP_CIPHER_CTX* rx = make_context(cipher, key, rx_iv);
+    EVP_CIPHER_CTX* tx = rx ? make_context(cipher, key, tx_iv) : nullptr;
+    if (!tx) {
+        EVP_CIPHER_CTX_free(rx);
+        if (err) *err = "Failed to set up stream cipher";
+        return false;
+    }
+    EVP_CIPHER_CTX_free(rx_);
+    EVP_CIPHER_CTX_free(tx_);
+    rx_ = rx;
+    tx_ = tx;
+    rx_bytes_ = 0;
+    tx_bytes_ = 0;
+    return true;
+}
+
+bool StreamCipher::apply(EVP_CIPHER_CTX* ctx, uint8_t* data, size_t len, uint64_t* position) {
+    if (!ctx) return false;
+    // EVP takes int lengths
+    while (len > 0) {
+        int chunk = len > INT_MAX ? INT_MAX : static_cast<int>(len);
+        int out_len = 0;
+        if (EVP_EncryptUpdate(ctx, data, &out_len, data, chunk) != 1 || out_len != chunk) return false;
+        data += chunk;
+        len -= chunk;
+        *position += chunk;
+    }
+    return true;
+}
+
+bool StreamCipher::hardware_accelerated() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes");
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,54 @@
+#ifndef STREAM_CIPHER_HPP
+#define STREAM_CIPHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <openssl/evp.h>
+
+// Per-connection Custom1 traffic cipher keyed by the session key a 0x501
+// login recovers. AES-CTR, one keystream per direction: the key schedule is
+// expanded once by init(), and each call XORs the next bytes of the stream
+// in place, so frames can be processed as they arrive without padding or
+// per-frame setup. OpenSSL runs it on AES-NI (with VAES where present) and
+// falls back to its portable table code on CPUs without them.
+//
+// Counter blocks start at zero; the server-to-client stream has the top bit
+// of its counter block set so the two directions never share keystream.
+//
+// Not thread-safe: it lives in the worker-owned ConnContext, not in a shared
+// table such as ConnectionManager, and is keyed on the worker's thread.
+class StreamCipher {
+public:
+    StreamCipher() = default;
+    ~StreamCipher();
+    StreamCipher(const StreamCipher&) = delete;
+    StreamCipher& operator=(const StreamCipher&) = delete;
+
+    // Expands a 16-, 24- or 32-byte key (AES-128/192/256). Returns false with
+    // err set for any other length or if OpenSSL fails.
+    bool init(const uint8_t* key, size_t len, std::string* err);
+    bool ready() const { return rx_ != nullptr; }
+
+    // Client-to-server bytes, in place
+    bool decrypt(uint8_t* data, size_t len) { return apply(rx_, data, len, &rx_bytes_); }
+    // Server-to-client bytes, in place
+    bool encrypt(uint8_t* data, size_t len) { return apply(tx_, data, len, &tx_bytes_); }
+
+    // Stream positions, for logging and tests
+    uint64_t bytes_decrypted() const { return rx_bytes_; }
+    uint64_t bytes_encrypted() const { return tx_bytes_; }
+
+    // Whether this CPU has the AES instructions OpenSSL will use
+    static bool hardware_accelerated();
+
+private:
+    static bool apply(EVP_CIPHER_CTX* ctx, uint8_t* data, size_t len, uint64_t* position);
+
+    EVP_CIPHER_CTX* rx_ = nullptr;
+    EVP_CIPHER_CTX* tx_ = nullptr;
+    uint64_t rx_bytes_ = 0;
+    uint64_t tx_bytes_ = 0;
+};
+
+#endif // STREAM_CIPHER_HPP
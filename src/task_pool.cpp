@@ -0,0 +1,73 @@
+#include "task_pool.hpp"
+#include <ctime>
+
+namespace {
+uint64_t thread_cpu_us() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+} // namespace
+
+TaskPool::TaskPool(std::string name, int threads, size_t max_queued)
+    : name_(std::move(name)), max_queued_(max_queued) {
+    threads_.reserve(threads);
+    for (int i = 0; i < threads; ++i) threads_.emplace_back([this] { run(); });
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    ready_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+bool TaskPool::submit(std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= max_queued_ || stopping_) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push_back(Entry{std::move(task), Clock::now()});
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    ready_.notify_one();
+    return true;
+}
+
+size_t TaskPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+TaskPool::Stats TaskPool::stats() const {
+    return Stats{submitted_.load(std::memory_order_relaxed), rejected_.load(std::memory_order_relaxed),
+                 completed_.load(std::memory_order_relaxed), queue_wait_us_.load(std::memory_order_relaxed),
+                 max_queue_wait_us_.load(std::memory_order_relaxed), cpu_us_.load(std::memory_order_relaxed)};
+}
+
+void TaskPool::run() {
+    while (true) {
+        Entry entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            entry = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - entry.enqueued).count();
+        uint64_t cpu_start = thread_cpu_us();
+        entry.task();
+        uint64_t cpu_us = thread_cpu_us() - cpu_start;
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        queue_wait_us_.fetch_add(wait_us, std::memory_order_relaxed);
+        cpu_us_.fetch_add(cpu_us, std::memory_order_relaxed);
+        uint64_t max_wait = max_queue_wait_us_.load(std::memory_order_relaxed);
+        while (wait_us > max_wait && !max_queue_wait_us_.compare_exchange_weak(max_wait, wait_us, std::memory_order_relaxed)) {}
+    }
+}
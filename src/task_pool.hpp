@@ -0,0 +1,67 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for blocking or CPU-heavy work (bcrypt, SQLite) that
+// must not run on an I/O worker. The queue is bounded: once max_queued tasks
+// are waiting, submit() refuses new ones so the caller can reject cheaply
+// instead of letting latency grow without bound.
+class TaskPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t submitted;
+        uint64_t rejected;
+        uint64_t completed;
+        uint64_t queue_wait_us;  // summed over completed tasks
+        uint64_t max_queue_wait_us;
+        uint64_t cpu_us;         // thread CPU time, summed
+    };
+
+    TaskPool(std::string name, int threads, size_t max_queued);
+    // Tasks still queued are dropped; running ones finish first
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Thread-safe. Returns false, leaving task untouched, if the queue is full.
+    bool submit(std::function<void()>& task);
+
+    size_t queued() const;
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::function<void()> task;
+        Clock::time_point enqueued;
+    };
+
+    void run();
+
+    std::string name_;
+    size_t max_queued_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Entry> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> queue_wait_us_{0};
+    std::atomic<uint64_t> max_queue_wait_us_{0};
+    std::atomic<uint64_t> cpu_us_{0};
+};
+
+#endif // TASK_POOL_HPP
@@ -0,0 +1,139 @@
+#include "timer_wheel.hpp"
+
+void TimerWheel::Timer::cancel() {
+    if (!wheel_) return;
+    TimerWheel::unlink(*this);
+    --wheel_->size_;
+    wheel_ = nullptr;
+}
+
+TimerWheel::TimerWheel(uint32_t tick_ms, uint64_t now_ms, ExpireFn on_expire)
+    : tick_ms_(tick_ms ? tick_ms : 1), current_tick_(now_ms / tick_ms_), on_expire_(std::move(on_expire)) {
+    for (auto& head : root_) head.prev = head.next = &head;
+    for (auto& level : levels_) {
+        for (auto& head : level) head.prev = head.next = &head;
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // Disarm whatever is left so the owners' destructors don't touch us
+    auto drain = [](Link& head) {
+        while (head.next != &head) {
+            Timer* t = static_cast<Timer*>(head.next);
+            unlink(*t);
+            t->wheel_ = nullptr;
+        }
+    };
+    for (auto& head : root_) drain(head);
+    for (auto& level : levels_) {
+        for (auto& head : level) drain(head);
+    }
+}
+
+void TimerWheel::unlink(Link& node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+}
+
+void TimerWheel::push_back(Link& head, Link& node) {
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+}
+
+void TimerWheel::schedule(Timer& t, uint64_t delay_ms) {
+    t.cancel();
+    uint64_t ticks = (delay_ms + tick_ms_ - 1) / tick_ms_;
+    t.expires_ = current_tick_ + (ticks ? ticks : 1);
+    t.wheel_ = this;
+    ++size_;
+    insert(t);
+}
+
+void TimerWheel::insert(Timer& t) {
+    uint64_t expires = t.expires_;
+    uint64_t delta = expires > current_tick_ ? expires - current_tick_ : 0;
+    if (delta < ROOT_SIZE) {
+        push_back(root_[expires & (ROOT_SIZE - 1)], t);
+        return;
+    }
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        unsigned shift = ROOT_BITS + (level + 1) * LEVEL_BITS;
+        if (delta < (uint64_t(1) << shift) || level == LEVELS - 1) {
+            if (level == LEVELS - 1 && delta >= (uint64_t(1) << shift)) {
+                // Beyond the wheel's range: park in the farthest slot and re-cascade
+                expires = current_tick_ + (uint64_t(1) << shift) - 1;
+            }
+            unsigned slot_shift = ROOT_BITS + level * LEVEL_BITS;
+            push_back(levels_[level][(expires >> slot_shift) & (LEVEL_SIZE - 1)], t);
+            return;
+        }
+    }
+}
+
+void TimerWheel::cascade(unsigned level, size_t index) {
+    Link& head = levels_[level][index];
+    Link pending;
+    pending.prev = pending.next = &pending;
+    // Splice the slot out first; re-inserting may target the same slot
+    if (head.next != &head) {
+        pending.next = head.next;
+        pending.prev = head.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head.prev = head.next = &head;
+    }
+    while (pending.next != &pending) {
+        Timer* t = static_cast<Timer*>(pending.next);
+        unlink(*t);
+        insert(*t);
+    }
+}
+
+void TimerWheel::advance(uint64_t now_ms) {
+    uint64_t target = now_ms / tick_ms_;
+    while (current_tick_ < target) {
+        ++current_tick_;
+        size_t index = current_tick_ & (ROOT_SIZE - 1);
+        if (index == 0) {
+            for (unsigned level = 0; level < LEVELS; ++level) {
+                size_t slot = (current_tick_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+                cascade(level, slot);
+                if (slot != 0) break;
+            }
+        }
+        Link& head = root_[index];
+        Link due;
+        due.prev = due.next = &due;
+        if (head.next != &head) {
+            due.next = head.next;
+            due.prev = head.prev;
+            due.next->prev = &due;
+            due.prev->next = &due;
+            head.prev = head.next = &head;
+        }
+        // Pop one at a time: a callback may cancel another timer in this batch
+        while (due.next != &due) {
+            Timer* t = static_cast<Timer*>(due.next);
+            unlink(*t);
+            t->wheel_ = nullptr;
+            --size_;
+            on_expire_(*t);
+        }
+    }
+}
+
+int TimerWheel::next_timeout_ms(uint64_t now_ms) const {
+    if (size_ == 0) return -1;
+    // Look for the next occupied root slot up to the next cascade point
+    uint64_t tick = current_tick_;
+    uint64_t limit = (current_tick_ | (ROOT_SIZE - 1)) + 1;
+    while (++tick < limit) {
+        const Link& head = root_[tick & (ROOT_SIZE - 1)];
+        if (head.next != &head) break;
+    }
+    uint64_t due_ms = tick * tick_ms_;
+    return due_ms > now_ms ? static_cast<int>(due_ms - now_ms) : 0;
+}
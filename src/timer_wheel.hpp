@@ -0,0 +1,78 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Hierarchical timing wheel (256 + 3x64 slots) driven by the worker loop.
+// Timers are intrusive: they live inside the connection they guard, so
+// arming, re-arming and cancelling are O(1) with no allocation, which keeps
+// 100k+ armed timers cheap. Expiry resolution is one tick.
+class TimerWheel {
+    struct Link {
+        Link* prev = nullptr;
+        Link* next = nullptr;
+    };
+
+public:
+    class Timer : private Link {
+    public:
+        Timer() = default;
+        // Copies and assignments never carry the armed state across
+        Timer(const Timer&) : Link() {}
+        Timer& operator=(const Timer&) {
+            cancel();
+            return *this;
+        }
+        ~Timer() { cancel(); }
+
+        bool armed() const { return wheel_ != nullptr; }
+        void cancel();
+
+        // Free for the owner, e.g. the fd and which rule this timer enforces
+        uint64_t owner = 0;
+        uint8_t kind = 0;
+
+    private:
+        friend class TimerWheel;
+        TimerWheel* wheel_ = nullptr;
+        uint64_t expires_ = 0;
+    };
+
+    using ExpireFn = std::function<void(Timer&)>;
+
+    TimerWheel(uint32_t tick_ms, uint64_t now_ms, ExpireFn on_expire);
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Arms (or re-arms) t to fire after delay_ms, rounded up to a tick
+    void schedule(Timer& t, uint64_t delay_ms);
+    // Fires every timer due at now_ms. Callbacks may schedule or cancel timers.
+    void advance(uint64_t now_ms);
+    // Milliseconds until the next tick that may fire a timer; -1 if none are armed
+    int next_timeout_ms(uint64_t now_ms) const;
+    size_t size() const { return size_; }
+
+private:
+    static constexpr unsigned ROOT_BITS = 8;
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned LEVELS = 3;
+    static constexpr size_t ROOT_SIZE = size_t(1) << ROOT_BITS;
+    static constexpr size_t LEVEL_SIZE = size_t(1) << LEVEL_BITS;
+
+    void insert(Timer& t);
+    void cascade(unsigned level, size_t index);
+    static void unlink(Link& node);
+    static void push_back(Link& head, Link& node);
+
+    uint32_t tick_ms_;
+    uint64_t current_tick_;
+    size_t size_ = 0;
+    ExpireFn on_expire_;
+    Link root_[ROOT_SIZE];
+    Link levels_[LEVELS][LEVEL_SIZE];
+};
+
+#endif // TIMER_WHEEL_HPP
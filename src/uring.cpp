@@ -0,0 +1,141 @@
+#include "uring.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+} // namespace
+
+IoUring::~IoUring() {
+    // Closing the ring fd first also unregisters the buffer ring
+    if (fd_ >= 0) close(fd_);
+    if (buf_ring_) munmap(buf_ring_, buf_ring_len_);
+    free(buf_base_);
+    if (sqes_) munmap(sqes_, sqes_len_);
+    if (sq_ptr_) munmap(sq_ptr_, sq_len_);
+}
+
+bool IoUring::init(unsigned entries) {
+    io_uring_params p{};
+    // The CQ ring is sized for bursts of multishot completions
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+    fd_ = sys_io_uring_setup(entries, &p);
+    if (fd_ < 0) return false;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        errno = ENOSYS;
+        return false;
+    }
+    // SQ and CQ rings share one mapping (IORING_FEAT_SINGLE_MMAP)
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    sq_len_ = sq_len > cq_len ? sq_len : cq_len;
+    sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+        sq_ptr_ = nullptr;
+        return false;
+    }
+    cq_ptr_ = sq_ptr_;
+    sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+    char* cq = static_cast<char*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+bool IoUring::setup_buffer_ring(uint16_t bgid, unsigned count, unsigned size) {
+    buf_ring_len_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buf_ring_len_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return false;
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = count;
+    reg.bgid = bgid;
+    if (sys_io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+    buf_count_ = count;
+    buf_size_ = size;
+    buf_base_ = static_cast<char*>(malloc(static_cast<size_t>(count) * size));
+    if (!buf_base_) return false;
+    buf_ring_->tail = 0;
+    for (unsigned i = 0; i < count; ++i) recycle_buffer(static_cast<uint16_t>(i));
+    return true;
+}
+
+void IoUring::recycle_buffer(uint16_t bid) {
+    unsigned short tail = buf_ring_->tail;
+    // Index the entries by hand: in C++ the header's __DECLARE_FLEX_ARRAY
+    // puts an empty struct (size 1) before bufs, shifting it by 8 bytes.
+    io_uring_buf* bufs = reinterpret_cast<io_uring_buf*>(buf_ring_);
+    io_uring_buf& b = bufs[tail & (buf_count_ - 1)];
+    b.addr = reinterpret_cast<uint64_t>(buffer(bid));
+    b.len = buf_size_;
+    b.bid = bid;
+    __atomic_store_n(&buf_ring_->tail, static_cast<unsigned short>(tail + 1), __ATOMIC_RELEASE);
+}
+
+bool IoUring::probe_opcodes() const {
+    const size_t ops = 256;
+    size_t len = sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op);
+    auto* probe = static_cast<io_uring_probe*>(calloc(1, len));
+    if (!probe) return false;
+    bool ok = sys_io_uring_register(fd_, IORING_REGISTER_PROBE, probe, ops) >= 0;
+    const int needed[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_CLOSE, IORING_OP_ASYNC_CANCEL};
+    for (int op : needed) {
+        if (!ok) break;
+        ok = op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_;
+    if (tail - head >= sq_entries_) {
+        submit_and_wait(0);
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (tail - head >= sq_entries_) return nullptr;
+    }
+    unsigned idx = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++sq_pending_;
+    return sqe;
+}
+
+int IoUring::submit_and_wait(unsigned wait_nr) {
+    unsigned to_submit = sq_pending_;
+    sq_pending_ = 0;
+    int rc;
+    do {
+        rc = sys_io_uring_enter(fd_, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    } while (rc < 0 && errno == EINTR && wait_nr);
+    return rc;
+}
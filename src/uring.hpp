@@ -0,0 +1,77 @@
+#ifndef URING_HPP
+#define URING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Minimal io_uring wrapper over the raw syscalls (no liburing dependency).
+// Covers what the server needs: SQE/CQE rings and one provided-buffer ring
+// for multishot recv.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Sets up the rings. Returns false (with errno set) if io_uring is unavailable.
+    bool init(unsigned entries);
+    // Registers a provided-buffer ring of `count` buffers of `size` bytes
+    // (count must be a power of two) under group id bgid.
+    bool setup_buffer_ring(uint16_t bgid, unsigned count, unsigned size);
+    // True if the kernel supports every opcode the server submits
+    bool probe_opcodes() const;
+
+    // Returns a zeroed SQE, submitting pending ones first if the ring is full
+    io_uring_sqe* get_sqe();
+    // Submits pending SQEs and waits for at least wait_nr completions
+    int submit_and_wait(unsigned wait_nr);
+
+    // Calls fn(const io_uring_cqe&) for every ready completion and consumes them
+    template <typename Fn>
+    unsigned drain_completions(Fn&& fn) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned seen = 0;
+        while (head != tail) {
+            fn(cqes_[head & *cq_mask_]);
+            ++head;
+            ++seen;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return seen;
+    }
+
+    // Provided buffer access and recycling
+    char* buffer(uint16_t bid) const { return buf_base_ + static_cast<size_t>(bid) * buf_size_; }
+    void recycle_buffer(uint16_t bid);
+
+private:
+    int fd_ = -1;
+    // SQ ring
+    void* sq_ptr_ = nullptr;
+    size_t sq_len_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned sq_pending_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_len_ = 0;
+    // CQ ring
+    void* cq_ptr_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    // Provided buffers
+    io_uring_buf_ring* buf_ring_ = nullptr;
+    size_t buf_ring_len_ = 0;
+    char* buf_base_ = nullptr;
+    unsigned buf_count_ = 0;
+    unsigned buf_size_ = 0;
+};
+
+#endif // URING_HPP
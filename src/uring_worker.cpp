@@ -0,0 +1,373 @@
+#include "uring_worker.hpp"
+#include "buffer_pool.hpp"
+#include "logger.hpp"
+#include "net_io.hpp"
+#include "protocol_dispatch.hpp"
+#include <sys/socket.h>
+#include <poll.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#define URING_ENTRIES 256
+#define URING_BUFFER_GROUP 0
+#define URING_BUFFER_COUNT 256
+#define URING_BUFFER_SIZE 2048
+
+UringWorker::~UringWorker() {
+    for (const auto& [fd, conn] : connections_) {
+        on_connection_closed(fd, conn.protocol);
+        if (!conn.close_submitted) close(fd);
+    }
+}
+
+bool UringWorker::supported() {
+    // Multishot recv needs 6.0; the opcodes themselves are probed below
+    utsname uts{};
+    int major = 0, minor = 0;
+    if (uname(&uts) != 0 || sscanf(uts.release, "%d.%d", &major, &minor) != 2) return false;
+    if (major < 6) return false;
+    IoUring probe;
+    return probe.init(8) && probe.probe_opcodes() && probe.setup_buffer_ring(URING_BUFFER_GROUP, 8, 64);
+}
+
+bool UringWorker::init() {
+    if (!ring_.init(URING_ENTRIES)) {
+        LOG_ERROR("io_uring_setup failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    if (!ring_.setup_buffer_ring(URING_BUFFER_GROUP, URING_BUFFER_COUNT, URING_BUFFER_SIZE)) {
+        LOG_ERROR("io_uring buffer ring registration failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    ready_ = true;
+    return true;
+}
+
+void UringWorker::run() {
+    pin_thread();
+    if (!ready_ && !init()) return;
+    for (size_t i = 0; i < listeners_.size(); ++i) arm_accept(i);
+    arm_wake();
+    LOG("Worker " + std::to_string(id_) + " (io_uring) serving " + std::to_string(listeners_.size()) + " listeners" +
+        (cpu_ >= 0 ? " on CPU " + std::to_string(cpu_) : std::string()));
+    while (true) {
+        arm_timeout();
+        if (ring_.submit_and_wait(1) < 0 && errno != EINTR && errno != EBUSY) {
+            LOG_ERROR("io_uring_enter failed: " + std::string(strerror(errno)));
+            return;
+        }
+        ring_.drain_completions([this](const io_uring_cqe& cqe) {
+            Op op = static_cast<Op>(cqe.user_data >> 56);
+            uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32) & 0xffffff;
+            uint32_t index = static_cast<uint32_t>(cqe.user_data);
+            switch (op) {
+                case OP_ACCEPT: on_accept(index, cqe); break;
+                case OP_RECV: on_recv(generation, static_cast<int>(index), cqe); break;
+                case OP_CLOSE: on_close(generation, static_cast<int>(index), cqe.res); break;
+                case OP_SEND: on_send(generation, static_cast<int>(index), cqe.res); break;
+                case OP_TIMEOUT: timeout_armed_ = false; break;
+                case OP_WAKE:
+                    on_wake();
+                    arm_wake();
+                    break;
+                case OP_CANCEL: break;
+            }
+        });
+        run_timers();
+        end_pass();
+        if (draining() && connections_.empty()) break;
+    }
+    LOG("Worker " + std::to_string(id_) + " drained");
+}
+
+void UringWorker::arm_wake() {
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wake_fd_;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = pack(OP_WAKE, 0, 0);
+}
+
+void UringWorker::stop_accepting() {
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        io_uring_sqe* cancel = ring_.get_sqe();
+        if (!cancel) return;
+        cancel->opcode = IORING_OP_ASYNC_CANCEL;
+        cancel->fd = -1;
+        cancel->addr = pack(OP_ACCEPT, 0, static_cast<uint32_t>(i));
+        cancel->user_data = pack(OP_CANCEL, 0, 0);
+    }
+}
+
+void UringWorker::close_all() {
+    std::vector<int> fds;
+    fds.reserve(connections_.size());
+    for (const auto& entry : connections_) fds.push_back(entry.first);
+    for (int fd : fds) reap(fd);
+}
+
+void UringWorker::arm_timeout() {
+    int wait_ms = timer_timeout_ms();
+    if (wait_ms < 0) return;
+    uint64_t deadline = now_ms() + wait_ms;
+    if (timeout_armed_ && deadline >= timeout_deadline_ms_) return;
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) return;
+    timeout_ts_.tv_sec = wait_ms / 1000;
+    timeout_ts_.tv_nsec = static_cast<long long>(wait_ms % 1000) * 1000000;
+    if (!timeout_armed_) {
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = reinterpret_cast<uint64_t>(&timeout_ts_);
+        sqe->len = 1;
+        sqe->user_data = pack(OP_TIMEOUT, 0, 0);
+    } else {
+        // A nearer deadline was armed since; pull the pending timeout in
+        sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        sqe->addr = pack(OP_TIMEOUT, 0, 0);
+        sqe->off = reinterpret_cast<uint64_t>(&timeout_ts_);
+        sqe->timeout_flags = IORING_TIMEOUT_UPDATE;
+        sqe->user_data = pack(OP_CANCEL, 0, 0);
+    }
+    timeout_armed_ = true;
+    timeout_deadline_ms_ = deadline;
+}
+
+void UringWorker::arm_accept(size_t listener_index) {
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listeners_[listener_index].first;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = pack(OP_ACCEPT, 0, static_cast<uint32_t>(listener_index));
+}
+
+void UringWorker::arm_recv(Connection& conn) {
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = pack(OP_RECV, conn.generation, static_cast<uint32_t>(conn.fd));
+    conn.recv_armed = true;
+}
+
+void UringWorker::on_accept(size_t listener_index, const io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE) && !draining()) arm_accept(listener_index);
+    if (cqe.res < 0) {
+        if (cqe.res != -ECANCELED) LOG_ERROR("io_uring accept failed: " + std::string(strerror(-cqe.res)));
+        return;
+    }
+    int client_fd = cqe.res;
+    // A connection whose close already completed may still be in the map
+    // if its close CQE is behind this one; the fd number is being reused.
+    release(client_fd);
+    Protocol listener_protocol = listeners_[listener_index].second;
+    Protocol protocol = initial_protocol(listener_protocol);
+    // The kernel interleaves multishot accept completions across listeners,
+    // so only admission control (not an accept budget) applies here
+    if (!admit(client_fd, protocol, connections_.size())) return;
+    LOG_PARTS("New connection on fd ", client_fd, " (", protocol_name(listener_protocol), ")");
+    Connection& conn =
+        connections_.try_emplace(client_fd, client_fd, ++next_generation_ & 0xffffff, protocol, listener_protocol).first->second;
+    conn.sending = BufferPool::acquire_string();
+    conn.pending = BufferPool::acquire_string();
+    arm_timers(conn.timers, client_fd);
+    if (protocol != Protocol::UNKNOWN) on_protocol_known(client_fd, protocol, conn.timers, conn.ctx);
+    arm_recv(conn);
+}
+
+void UringWorker::on_recv(uint32_t generation, int fd, const io_uring_cqe& cqe) {
+    bool has_buffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    auto it = connections_.find(fd);
+    bool current = it != connections_.end() && it->second.generation == generation;
+    if (!current) {
+        if (has_buffer) ring_.recycle_buffer(bid);
+        return;
+    }
+    Connection& conn = it->second;
+    if (!(cqe.flags & IORING_CQE_F_MORE)) conn.recv_armed = false;
+    bool peer_closed = false;
+    if (cqe.res > 0 && has_buffer) {
+        if (!conn.closing) conn.inbuf.append(ring_.buffer(bid), cqe.res);
+        if (!conn.got_first_byte) {
+            conn.got_first_byte = true;
+            auto now = OverloadController::Clock::now();
+            overload_.on_sample(now, now - conn.accepted_at);
+        }
+    } else if (cqe.res == -ENOBUFS) {
+        // Provided buffers ran dry; they are recycled as completions are drained
+    } else if (cqe.res != -ECANCELED) {
+        peer_closed = true;
+    }
+    if (has_buffer) ring_.recycle_buffer(bid);
+    if (conn.closing) return;
+    ConnAction action;
+    size_t buffered = conn.inbuf.size();
+    {
+        SendCapture capture(conn.fd, conn.pending);
+        action = dispatch(conn.fd, conn.protocol, conn.listener_protocol, conn.inbuf, peer_closed, conn.timers, conn.ctx);
+    }
+    if (cqe.res > 0) on_activity(conn.timers, conn.protocol, conn.inbuf.size() < buffered);
+    if (action == ConnAction::CLOSE) {
+        LOG_PARTS("Handled connection on fd ", conn.fd, " (", protocol_name(conn.protocol), ")");
+        finish(conn);
+        return;
+    }
+    flush(conn);
+    if (queued_output(conn) > static_cast<size_t>(config_.output_high_watermark) && !conn.reading_paused) {
+        // The client isn't draining; stop pulling its input until it does
+        conn.reading_paused = true;
+        cancel_recv(conn);
+    }
+    // Input behind a deferred answer stays in the kernel until it is sent
+    if (conn.ctx.awaiting_response) {
+        cancel_recv(conn);
+        return;
+    }
+    if (!conn.recv_armed && !conn.reading_paused) arm_recv(conn);
+}
+
+void UringWorker::deliver_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) {
+    auto it = connections_.find(fd);
+    // Closed (or reaped) while the answer was being computed
+    if (it == connections_.end() || it->second.ctx.id != conn_id || !it->second.ctx.awaiting_response) return;
+    Connection& conn = it->second;
+    if (conn.closing) return;
+    ConnAction action;
+    {
+        SendCapture capture(conn.fd, conn.pending);
+        action = resume(fd, conn.protocol, conn.inbuf, conn.ctx, std::move(response), std::move(on_delivery));
+    }
+    if (action == ConnAction::CLOSE) {
+        finish(conn);
+        return;
+    }
+    flush(conn);
+    if (!conn.ctx.awaiting_response && !conn.recv_armed && !conn.reading_paused) arm_recv(conn);
+}
+
+void UringWorker::submit_send(Connection& conn, bool link_close) {
+    conn.sending.swap(conn.pending);
+    conn.pending.clear();
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn.sending.data());
+    sqe->len = static_cast<uint32_t>(conn.sending.size());
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    if (link_close) sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = pack(OP_SEND, conn.generation, static_cast<uint32_t>(conn.fd));
+    conn.send_inflight = true;
+}
+
+void UringWorker::flush(Connection& conn) {
+    if (conn.send_inflight || conn.pending.empty()) return;
+    submit_send(conn, false);
+}
+
+void UringWorker::cancel_recv(Connection& conn) {
+    if (!conn.recv_armed) return;
+    io_uring_sqe* cancel = ring_.get_sqe();
+    if (!cancel) return;
+    cancel->opcode = IORING_OP_ASYNC_CANCEL;
+    cancel->fd = -1;
+    cancel->addr = pack(OP_RECV, conn.generation, static_cast<uint32_t>(conn.fd));
+    cancel->user_data = pack(OP_CANCEL, conn.generation, static_cast<uint32_t>(conn.fd));
+}
+
+void UringWorker::finish(Connection& conn) {
+    conn.closing = true;
+    // The deadline stays armed so output a client never drains still gets reaped
+    conn.timers.keepalive.cancel();
+    cancel_recv(conn);
+    // An in-flight send finishes first; on_send submits the rest
+    if (!conn.send_inflight) submit_final(conn);
+}
+
+void UringWorker::submit_final(Connection& conn) {
+    if (!conn.pending.empty()) submit_send(conn, true);
+    io_uring_sqe* close_sqe = ring_.get_sqe();
+    if (!close_sqe) {
+        // Ring is wedged; close synchronously so the fd is not leaked
+        close(conn.fd);
+        release(conn.fd);
+        return;
+    }
+    close_sqe->opcode = IORING_OP_CLOSE;
+    close_sqe->fd = conn.fd;
+    close_sqe->user_data = pack(OP_CLOSE, conn.generation, static_cast<uint32_t>(conn.fd));
+    conn.close_submitted = true;
+}
+
+void UringWorker::on_send(uint32_t generation, int fd, int res) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second.generation != generation) return;
+    Connection& conn = it->second;
+    conn.send_inflight = false;
+    bool failed = res < 0 || static_cast<size_t>(res) < conn.sending.size();
+    conn.sending.clear();
+    // A linked close is already queued (and cancelled if this send failed)
+    if (conn.close_submitted) return;
+    if (failed) {
+        conn.pending.clear();
+        finish(conn);
+        return;
+    }
+    if (conn.closing) {
+        submit_final(conn);
+        return;
+    }
+    on_activity(conn.timers, conn.protocol, false);
+    flush(conn);
+    if (conn.reading_paused && queued_output(conn) <= static_cast<size_t>(config_.output_low_watermark)) {
+        conn.reading_paused = false;
+        if (!conn.recv_armed && !conn.ctx.awaiting_response) arm_recv(conn);
+    }
+}
+
+void UringWorker::on_close(uint32_t generation, int fd, int res) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end() || it->second.generation != generation) return;
+    // A failed or short send severs the link and cancels the close
+    if (res == -ECANCELED) close(fd);
+    release(fd);
+}
+
+void UringWorker::reap(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+    Connection& conn = it->second;
+    // A send to a client that stopped reading would never complete; cancelling
+    // it also cancels a close linked behind it, and on_close then closes the fd
+    if (conn.send_inflight) {
+        io_uring_sqe* cancel = ring_.get_sqe();
+        if (cancel) {
+            cancel->opcode = IORING_OP_ASYNC_CANCEL;
+            cancel->fd = -1;
+            cancel->addr = pack(OP_SEND, conn.generation, static_cast<uint32_t>(conn.fd));
+            cancel->user_data = pack(OP_CANCEL, conn.generation, static_cast<uint32_t>(conn.fd));
+        }
+        conn.pending.clear();
+    }
+    if (!conn.closing) finish(conn);
+}
+
+void UringWorker::release(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+    on_connection_closed(fd, it->second.protocol);
+    BufferPool::release_string(std::move(it->second.sending));
+    BufferPool::release_string(std::move(it->second.pending));
+    connections_.erase(it);
+}
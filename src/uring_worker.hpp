@@ -0,0 +1,93 @@
+#ifndef URING_WORKER_HPP
+#define URING_WORKER_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "stream_buffer.hpp"
+#include "uring.hpp"
+#include "worker.hpp"
+
+// Worker driven by io_uring: multishot accept per listener, multishot recv
+// into a provided-buffer ring, and responses submitted as send SQEs; the
+// last one is linked to the close. Handlers run unchanged; their net_send()
+// output is captured and handed to the ring.
+class UringWorker : public Worker {
+public:
+    UringWorker(int id, int cpu, const ServerConfig& config = ServerConfig()) : Worker(id, cpu, config) {}
+    ~UringWorker() override;
+    // True if this kernel can run the io_uring backend
+    static bool supported();
+    // Returns false if the ring could not be set up; the caller falls back to epoll
+    bool init();
+    void run() override;
+
+private:
+    enum Op : uint8_t { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_CLOSE, OP_CANCEL, OP_TIMEOUT, OP_WAKE };
+
+    struct Connection {
+        // Everything else starts empty, so a new member needs no change here
+        Connection(int fd, uint32_t generation, Protocol protocol, Protocol listener_protocol)
+            : fd(fd), generation(generation), protocol(protocol), listener_protocol(listener_protocol),
+              accepted_at(OverloadController::Clock::now()) {}
+
+        int fd;
+        uint32_t generation;
+        // UNKNOWN until sniffed from the first bytes
+        Protocol protocol;
+        Protocol listener_protocol;
+        StreamBuffer inbuf;
+        OverloadController::Clock::time_point accepted_at;
+        // Bytes owned by the in-flight send SQE, and output queued behind it
+        std::string sending;
+        std::string pending;
+        bool got_first_byte = false;
+        bool recv_armed = false;
+        bool send_inflight = false;
+        // Output is above the high watermark; recv is re-armed below the low one
+        bool reading_paused = false;
+        // No more input is processed; close once output is flushed
+        bool closing = false;
+        bool close_submitted = false;
+        ConnTimers timers;
+        ConnContext ctx;
+    };
+
+    static uint64_t pack(Op op, uint32_t generation, uint32_t index) {
+        return (static_cast<uint64_t>(op) << 56) | (static_cast<uint64_t>(generation & 0xffffff) << 32) | index;
+    }
+
+    void arm_accept(size_t listener_index);
+    void arm_recv(Connection& conn);
+    void on_accept(size_t listener_index, const io_uring_cqe& cqe);
+    void on_recv(uint32_t generation, int fd, const io_uring_cqe& cqe);
+    void on_send(uint32_t generation, int fd, int res);
+    void on_close(uint32_t generation, int fd, int res);
+    // Submits queued output unless a send is already in flight
+    void flush(Connection& conn);
+    // Stops reading; the connection closes after pending output
+    void finish(Connection& conn);
+    void cancel_recv(Connection& conn);
+    size_t queued_output(const Connection& conn) const { return conn.sending.size() + conn.pending.size(); }
+    // Submits pending output (if any) linked to the close
+    void submit_final(Connection& conn);
+    void submit_send(Connection& conn, bool link_close);
+    void release(int fd);
+    void reap(int fd) override;
+    void stop_accepting() override;
+    void close_all() override;
+    void deliver_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) override;
+    void arm_wake();
+    // Keeps one IORING_OP_TIMEOUT in flight so the wheel advances on time
+    void arm_timeout();
+
+    IoUring ring_;
+    bool ready_ = false;
+    uint32_t next_generation_ = 0;
+    __kernel_timespec timeout_ts_{};
+    bool timeout_armed_ = false;
+    uint64_t timeout_deadline_ms_ = 0;
+    std::unordered_map<int, Connection> connections_;
+};
+
+#endif // URING_WORKER_HPP
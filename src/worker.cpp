@@ -0,0 +1,202 @@
+#include "worker.hpp"
+#include "logger.hpp"
+#include "connection_manager.hpp"
+#include "crypto_pool.hpp"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+
+#define TIMER_TICK_MS 10
+
+// Global instances for all translation units
+extern ConnectionManager custom1_conn_mgr;
+extern ConnectionManager custom2_conn_mgr;
+
+Worker::Worker(int id, int cpu, const ServerConfig& config)
+    : id_(id), cpu_(cpu), config_(config),
+      overload_(std::chrono::milliseconds(config.overload_target_ms),
+                std::chrono::milliseconds(config.overload_interval_ms)),
+      timers_(TIMER_TICK_MS, now_ms(), [this](TimerWheel::Timer& t) { on_timer(t); }) {
+    stats_timer_.kind = RULE_COUNT;
+    if (config_.timer_stats_interval_ms > 0) timers_.schedule(stats_timer_, config_.timer_stats_interval_ms);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) LOG_ERROR("eventfd failed: " + std::string(strerror(errno)));
+}
+
+Worker::~Worker() {
+    if (wake_fd_ >= 0) close(wake_fd_);
+}
+
+void Worker::drain(int timeout_ms) {
+    drain_timeout_ms_.store(timeout_ms < 0 ? 0 : timeout_ms);
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Worker " + std::to_string(id_) + " wakeup failed: " + strerror(errno));
+    }
+}
+
+void Worker::post_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) {
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex_);
+        deferred_.push_back(Deferred{fd, conn_id, std::move(response), std::move(on_delivery)});
+    }
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Worker " + std::to_string(id_) + " wakeup failed: " + strerror(errno));
+    }
+}
+
+void Worker::on_wake() {
+    uint64_t count;
+    while (read(wake_fd_, &count, sizeof(count)) > 0) {}
+    std::vector<Deferred> ready;
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex_);
+        ready.swap(deferred_);
+    }
+    for (Deferred& d : ready) deliver_deferred(d.fd, d.conn_id, std::move(d.response), std::move(d.on_delivery));
+    int timeout_ms = drain_timeout_ms_.load();
+    if (draining_ || timeout_ms < 0) return;
+    draining_ = true;
+    stop_accepting();
+    LOG("Worker " + std::to_string(id_) + " stopped accepting; draining for up to " + std::to_string(timeout_ms) + "ms");
+    if (timeout_ms == 0) {
+        close_all();
+    } else {
+        timers_.schedule(drain_timer_, timeout_ms);
+    }
+}
+
+const char* Worker::rule_name(TimerRule rule) {
+    switch (rule) {
+        case RULE_FIRST_BYTE: return "first_byte";
+        case RULE_IDLE: return "idle";
+        case RULE_KEEPALIVE: return "keepalive";
+        default: return "unknown";
+    }
+}
+
+uint64_t Worker::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Worker::arm_timers(ConnTimers& timers, int fd) {
+    timers.deadline.owner = timers.keepalive.owner = static_cast<uint64_t>(fd);
+    if (config_.first_byte_timeout_ms > 0) {
+        timers.deadline.kind = RULE_FIRST_BYTE;
+        timers_.schedule(timers.deadline, config_.first_byte_timeout_ms);
+    }
+}
+
+Protocol Worker::initial_protocol(Protocol listener_protocol) const {
+    if (listener_protocol == Protocol::AUTO || config_.sniff_protocols) return Protocol::UNKNOWN;
+    return listener_protocol;
+}
+
+void Worker::on_protocol_known(int fd, Protocol protocol, ConnTimers& timers, ConnContext& ctx) {
+    // Only a connection with a known protocol reaches a handler that can defer
+    ctx.id = ++next_conn_id_;
+    if (protocol == Protocol::HTTP && config_.http_max_requests > 0) {
+        ctx.max_requests = static_cast<uint32_t>(config_.http_max_requests);
+    }
+    if (protocol == Protocol::CUSTOM2) custom2_conn_mgr.add_connection(fd);
+    if (protocol != Protocol::CUSTOM1) return;
+    custom1_conn_mgr.add_connection(fd);
+    if (config_.custom1_keepalive_ms > 0) {
+        timers.keepalive.kind = RULE_KEEPALIVE;
+        timers_.schedule(timers.keepalive, config_.custom1_keepalive_ms);
+    }
+}
+
+void Worker::on_connection_closed(int fd, Protocol protocol) {
+    if (protocol == Protocol::CUSTOM1) custom1_conn_mgr.remove_connection(fd);
+    if (protocol == Protocol::CUSTOM2) custom2_conn_mgr.remove_connection(fd);
+}
+
+ConnAction Worker::dispatch(int fd, Protocol& protocol, Protocol listener_protocol, StreamBuffer& in,
+                            bool peer_closed, ConnTimers& timers, ConnContext& ctx) {
+    if (protocol == Protocol::UNKNOWN) {
+        protocol = sniff_protocol(in.view(), peer_closed, listener_protocol);
+        if (protocol == Protocol::UNKNOWN) return ConnAction::KEEP_READING;
+        on_protocol_known(fd, protocol, timers, ctx);
+    }
+    DeferScope scope(*this, fd, ctx.id);
+    return process_input(fd, protocol, in, ctx, peer_closed);
+}
+
+ConnAction Worker::resume(int fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, std::string response,
+                          DeliveryHook on_delivery) {
+    DeferScope scope(*this, fd, ctx.id);
+    if (on_delivery) on_delivery(ctx);
+    return complete_deferred(fd, protocol, in, ctx, std::move(response));
+}
+
+void Worker::end_pass() {
+    CryptoPool::flush_pending();
+}
+
+void Worker::on_activity(ConnTimers& timers, Protocol protocol, bool frame_completed) {
+    int idle_ms = config_.idle_timeout_ms(protocol);
+    if (idle_ms > 0) {
+        timers.deadline.kind = RULE_IDLE;
+        timers_.schedule(timers.deadline, idle_ms);
+    } else {
+        timers.deadline.cancel();
+    }
+    // Bytes alone don't satisfy the keepalive, so a client dribbling a
+    // partial frame is still reaped
+    if (frame_completed && timers.keepalive.armed()) {
+        timers_.schedule(timers.keepalive, config_.custom1_keepalive_ms);
+    }
+}
+
+void Worker::on_timer(TimerWheel::Timer& timer) {
+    if (&timer == &stats_timer_) {
+        log_timer_stats();
+        timers_.schedule(stats_timer_, config_.timer_stats_interval_ms);
+        return;
+    }
+    if (&timer == &drain_timer_) {
+        LOG("Worker " + std::to_string(id_) + " drain deadline passed; closing remaining connections");
+        close_all();
+        return;
+    }
+    TimerRule rule = static_cast<TimerRule>(timer.kind);
+    reaped_[rule].fetch_add(1, std::memory_order_relaxed);
+    int fd = static_cast<int>(timer.owner);
+    LOG("Reaping fd " + std::to_string(fd) + " (" + rule_name(rule) + " deadline)");
+    // Destroys the connection and with it any other timer it still has armed
+    reap(fd);
+}
+
+void Worker::log_timer_stats() {
+    // Runs while the stats timer is between re-arms, so it isn't counted
+    LOG("Worker " + std::to_string(id_) + " timers: " + std::to_string(timers_.size()) + " armed, reaped " +
+        rule_name(RULE_FIRST_BYTE) + "=" + std::to_string(reaped(RULE_FIRST_BYTE)) + " " +
+        rule_name(RULE_IDLE) + "=" + std::to_string(reaped(RULE_IDLE)) + " " +
+        rule_name(RULE_KEEPALIVE) + "=" + std::to_string(reaped(RULE_KEEPALIVE)));
+}
+
+bool Worker::admit(int client_fd, Protocol protocol, size_t open_connections) {
+    bool at_cap = config_.max_connections > 0 && open_connections >= static_cast<size_t>(config_.max_connections);
+    if (!at_cap && !overload_.should_shed(OverloadController::Clock::now())) return true;
+    reject_connection(client_fd, protocol);
+    close(client_fd);
+    return false;
+}
+
+void Worker::pin_thread() {
+    if (cpu_ < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        LOG_ERROR("Worker " + std::to_string(id_) + " failed to pin to CPU " + std::to_string(cpu_) + ": " + strerror(rc));
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "deferred_response.hpp"
+#include "overload_controller.hpp"
+#include "protocol_dispatch.hpp"
+#include "server_config.hpp"
+#include "stream_buffer.hpp"
+#include "timer_wheel.hpp"
+
+// One I/O loop and the client connections accepted on it. In worker mode
+// every Worker has its own SO_REUSEPORT listener per port and runs on its
+// own thread; connection state never crosses workers. Subclasses provide
+// the I/O backend (epoll or io_uring).
+class Worker : public DeferredSink {
+public:
+    // cpu < 0 leaves the thread unpinned
+    Worker(int id, int cpu, const ServerConfig& config = ServerConfig());
+    virtual ~Worker();
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    // Listener fds stay owned by the caller
+    void add_listener(int fd, Protocol protocol) { listeners_.emplace_back(fd, protocol); }
+    const std::vector<std::pair<int, Protocol>>& listeners() const { return listeners_; }
+    // Pins the calling thread (if requested) and runs the loop. Returns once
+    // a drain has finished.
+    virtual void run() = 0;
+    // Thread-safe. The worker stops accepting, lets open connections finish,
+    // closes whatever is left after timeout_ms, and then run() returns.
+    void drain(int timeout_ms);
+    // Thread-safe; queues an answer from a pool thread for deliver_deferred()
+    void post_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) override;
+
+    int id() const { return id_; }
+
+    // Connection deadlines, each counted separately when it reaps a connection
+    enum TimerRule : uint8_t { RULE_FIRST_BYTE, RULE_IDLE, RULE_KEEPALIVE, RULE_COUNT };
+    static const char* rule_name(TimerRule rule);
+    uint64_t reaped(TimerRule rule) const { return reaped_[rule].load(std::memory_order_relaxed); }
+    size_t armed_timers() const { return timers_.size(); }
+
+protected:
+    // Per-connection deadlines, embedded in the subclass's Connection
+    struct ConnTimers {
+        TimerWheel::Timer deadline;   // first byte, then read-idle
+        TimerWheel::Timer keepalive;  // Custom1 frame interval
+    };
+
+    static uint64_t now_ms();
+    // Arms the first-byte deadline for a new connection
+    void arm_timers(ConnTimers& timers, int fd);
+    // Call after bytes arrive or a stalled write makes progress; frame_completed
+    // means at least one frame was dispatched
+    void on_activity(ConnTimers& timers, Protocol protocol, bool frame_completed);
+
+    // Protocol a connection accepted on this listener starts with; UNKNOWN
+    // means it is sniffed from its first bytes
+    Protocol initial_protocol(Protocol listener_protocol) const;
+    // Per-protocol setup (Custom1 and Custom2 registration, the Custom1
+    // keepalive, the HTTP request limit) once a connection's protocol is
+    // known, and its teardown on close
+    void on_protocol_known(int fd, Protocol protocol, ConnTimers& timers, ConnContext& ctx);
+    void on_connection_closed(int fd, Protocol protocol);
+    // Sniffs the protocol if it is still UNKNOWN, then runs process_input()
+    ConnAction dispatch(int fd, Protocol& protocol, Protocol listener_protocol, StreamBuffer& in,
+                        bool peer_closed, ConnTimers& timers, ConnContext& ctx);
+    // Runs the delivery hook, sends a deferred answer and dispatches the
+    // input buffered behind it
+    ConnAction resume(int fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, std::string response,
+                      DeliveryHook on_delivery);
+    // Hands a deferred answer to its connection, if conn_id is still open
+    virtual void deliver_deferred(int fd, uint64_t conn_id, std::string response, DeliveryHook on_delivery) = 0;
+    // epoll/io_uring wait bound so the wheel is advanced on time (-1 = no timers)
+    int timer_timeout_ms() { return timers_.next_timeout_ms(now_ms()); }
+    void run_timers() { timers_.advance(now_ms()); }
+    // Call once per loop pass, before waiting again: submits the work that
+    // handlers batched up during the pass (Custom1 login decrypts)
+    void end_pass();
+    // Closes a connection whose deadline passed
+    virtual void reap(int fd) = 0;
+    // Removes the listeners from the loop; they stay open for the caller
+    virtual void stop_accepting() = 0;
+    // Closes every open connection (the drain deadline passed)
+    virtual void close_all() = 0;
+
+    // Subclasses watch wake_fd_ for readability and call on_wake(), which
+    // delivers deferred answers and starts a requested drain
+    void on_wake();
+    bool draining() const { return draining_; }
+
+    void pin_thread();
+    // Admission control for a just-accepted connection. When the worker is
+    // at its connection cap or the overload controller is shedding, the
+    // client gets a cheap rejection, the fd is closed, and false is returned.
+    bool admit(int client_fd, Protocol protocol, size_t open_connections);
+
+    int id_;
+    int cpu_;
+    std::vector<std::pair<int, Protocol>> listeners_;
+    ServerConfig config_;
+    OverloadController overload_;
+    // eventfd used to wake the loop from other threads
+    int wake_fd_ = -1;
+
+private:
+    struct Deferred {
+        int fd;
+        uint64_t conn_id;
+        std::string response;
+        DeliveryHook on_delivery;
+    };
+
+    void on_timer(TimerWheel::Timer& timer);
+    void log_timer_stats();
+
+    TimerWheel timers_;
+    TimerWheel::Timer stats_timer_;
+    TimerWheel::Timer drain_timer_;
+    bool draining_ = false;
+    std::atomic<int> drain_timeout_ms_{-1};
+    std::atomic<uint64_t> reaped_[RULE_COUNT] = {};
+    uint64_t next_conn_id_ = 0;
+    std::mutex deferred_mutex_;
+    std::vector<Deferred> deferred_;
+};
+
+#endif // WORKER_HPP
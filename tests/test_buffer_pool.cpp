@@ -0,0 +1,70 @@
+#include "buffer_pool.hpp"
+#include "stream_buffer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(BufferPoolTest, RoundsUpToClassAndRecycles) {
+    size_t cap = 0;
+    char* block = BufferPool::acquire(1500, &cap);
+    EXPECT_EQ(cap, 4096u);
+    BufferPool::release(block, cap);
+    size_t cap2 = 0;
+    EXPECT_EQ(BufferPool::acquire(3000, &cap2), block);
+    EXPECT_EQ(cap2, 4096u);
+    BufferPool::release(block, cap2);
+
+    // Past the largest class: straight from and back to the heap
+    char* big = BufferPool::acquire(BUFFER_POOL_MAX_CLASS + 1, &cap);
+    EXPECT_EQ(cap, static_cast<size_t>(BUFFER_POOL_MAX_CLASS + 1));
+    size_t cached = BufferPool::stats().cached_bytes;
+    BufferPool::release(big, cap);
+    EXPECT_EQ(BufferPool::stats().cached_bytes, cached);
+}
+
+TEST(BufferPoolTest, FreeListsAreCapped) {
+    std::thread([] {
+        size_t limit = BUFFER_POOL_CLASS_BYTES / BUFFER_POOL_MAX_CLASS;
+        std::vector<char*> blocks;
+        size_t cap = 0;
+        for (size_t i = 0; i < limit + 3; ++i) blocks.push_back(BufferPool::acquire(BUFFER_POOL_MAX_CLASS, &cap));
+        for (char* block : blocks) BufferPool::release(block, cap);
+        EXPECT_EQ(BufferPool::stats().cached_bytes, static_cast<size_t>(BUFFER_POOL_CLASS_BYTES));
+    }).join();
+}
+
+TEST(BufferPoolTest, StringsKeepTheirCapacity) {
+    // A fresh thread, so its lists start empty
+    std::thread([] {
+        std::string s = BufferPool::acquire_string(100);
+        EXPECT_TRUE(s.empty());
+        EXPECT_GE(s.capacity(), static_cast<size_t>(BUFFER_POOL_MIN_CLASS));
+        s.assign(5000, 'x');
+        const char* storage = s.data();
+        BufferPool::release_string(std::move(s));
+        // A request for a small buffer takes the larger one rather than allocating
+        std::string again = BufferPool::acquire_string();
+        EXPECT_TRUE(again.empty());
+        EXPECT_EQ(again.data(), storage);
+        EXPECT_EQ(BufferPool::stats().hits, 1u);
+    }).join();
+}
+
+TEST(BufferPoolTest, StreamBufferStorageIsRecycled) {
+    const char* storage;
+    {
+        StreamBuffer buf;
+        buf.append("hello", 5);
+        storage = buf.data();
+        EXPECT_EQ(buf.capacity(), static_cast<size_t>(BUFFER_POOL_MIN_CLASS));
+    }
+    // The next connection on this thread gets the same block
+    StreamBuffer next;
+    next.append("x", 1);
+    EXPECT_EQ(next.data(), storage);
+    StreamBuffer moved(std::move(next));
+    EXPECT_EQ(moved.view(), "x");
+    EXPECT_TRUE(next.empty());
+    EXPECT_EQ(next.capacity(), 0u);
+}
@@ -0,0 +1,83 @@
+#include "crc32.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+namespace {
+// Every implementation this CPU can run
+std::vector<Crc32Impl> available_impls() {
+    std::vector<Crc32Impl> impls;
+    Crc32Impl original = crc32_impl();
+    for (Crc32Impl impl : {Crc32Impl::SLICE8, Crc32Impl::PCLMUL}) {
+        if (crc32_set_impl(impl)) impls.push_back(impl);
+    }
+    crc32_set_impl(original);
+    return impls;
+}
+
+// One bit at a time, straight from the definition
+uint32_t reference_crc(const uint8_t* p, size_t len) {
+    uint32_t c = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; ++i) {
+        c ^= p[i];
+        for (int bit = 0; bit < 8; ++bit) c = (c >> 1) ^ ((c & 1) ? 0xEDB88320u : 0);
+    }
+    return ~c;
+}
+
+// Restores the startup choice when a test ends
+struct ImplGuard {
+    Crc32Impl saved = crc32_impl();
+    ~ImplGuard() { crc32_set_impl(saved); }
+};
+} // namespace
+
+TEST(Crc32Test, KnownValues) {
+    ImplGuard guard;
+    for (Crc32Impl impl : available_impls()) {
+        ASSERT_TRUE(crc32_set_impl(impl));
+        EXPECT_EQ(crc32("", 0), 0u) << crc32_impl_name(impl);
+        EXPECT_EQ(crc32("123456789", 9), 0xCBF43926u) << crc32_impl_name(impl);
+        const char* fox = "The quick brown fox jumps over the lazy dog";
+        EXPECT_EQ(crc32(fox, strlen(fox)), 0x414FA339u) << crc32_impl_name(impl);
+    }
+}
+
+TEST(Crc32Test, MatchesReferenceAtEveryLengthAndOffset) {
+    ImplGuard guard;
+    std::vector<uint8_t> bytes(600);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 131 + 7);
+    for (Crc32Impl impl : available_impls()) {
+        ASSERT_TRUE(crc32_set_impl(impl));
+        // Odd offsets keep the vector loads unaligned; lengths cross the fold threshold
+        for (size_t offset = 0; offset < 3; ++offset) {
+            for (size_t len = 0; len + offset <= 300; ++len) {
+                ASSERT_EQ(crc32(bytes.data() + offset, len), reference_crc(bytes.data() + offset, len))
+                    << crc32_impl_name(impl) << " offset " << offset << " length " << len;
+            }
+        }
+        EXPECT_EQ(crc32(bytes.data(), bytes.size()), reference_crc(bytes.data(), bytes.size()));
+    }
+}
+
+TEST(Crc32Test, UpdateContinuesAcrossChunks) {
+    ImplGuard guard;
+    std::vector<uint8_t> bytes(1000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i ^ (i >> 3));
+    uint32_t whole = reference_crc(bytes.data(), bytes.size());
+    for (Crc32Impl impl : available_impls()) {
+        ASSERT_TRUE(crc32_set_impl(impl));
+        for (size_t split : {size_t{1}, size_t{63}, size_t{64}, size_t{500}, size_t{999}}) {
+            uint32_t crc = crc32_update(0, bytes.data(), split);
+            crc = crc32_update(crc, bytes.data() + split, bytes.size() - split);
+            EXPECT_EQ(crc, whole) << crc32_impl_name(impl) << " split " << split;
+        }
+    }
+}
+
+TEST(Crc32Test, SliceAlwaysAvailable) {
+    ImplGuard guard;
+    EXPECT_TRUE(crc32_set_impl(Crc32Impl::SLICE8));
+    EXPECT_EQ(crc32_impl(), Crc32Impl::SLICE8);
+    EXPECT_STREQ(crc32_impl_name(Crc32Impl::PCLMUL), "pclmul");
+}
@@ -0,0 +1,159 @@
+#include "crypto_pool.hpp"
+#include "custom1_handlers.hpp"
+#include <gtest/gtest.h>
+#include <openssl/rsa.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> encrypt_to(EVP_PKEY* key, const std::string& plain) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    EVP_PKEY_encrypt_init(ctx);
+    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
+    size_t len = 0;
+    EVP_PKEY_encrypt(ctx, nullptr, &len, reinterpret_cast<const unsigned char*>(plain.data()), plain.size());
+    std::vector<unsigned char> out(len);
+    EVP_PKEY_encrypt(ctx, out.data(), &len, reinterpret_cast<const unsigned char*>(plain.data()), plain.size());
+    out.resize(len);
+    EVP_PKEY_CTX_free(ctx);
+    return out;
+}
+
+// Counts finished jobs so a test can wait for all of them
+struct Completions {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int ok = 0;
+    int failed = 0;
+    std::vector<std::string> plains;
+
+    CryptoPool::Callback callback() {
+        return [this](bool success, std::vector<unsigned char>& plain, const std::string&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (success) {
+                ++ok;
+                plains.emplace_back(plain.begin(), plain.end());
+            } else {
+                ++failed;
+            }
+            cv.notify_all();
+        };
+    }
+    bool wait_for(int total) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(10), [&] { return ok + failed >= total; });
+    }
+};
+
+}  // namespace
+
+TEST(OaepDecryptorTest, DecryptsWithLoadedKey) {
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    auto set = keys.keys();
+    ASSERT_FALSE(set->keys.empty());
+    OaepDecryptor decryptor;
+    std::vector<unsigned char> out;
+    std::string err;
+    // Same context every time
+    for (const char* plain : {"first", "second", "third"}) {
+        ASSERT_TRUE(decryptor.decrypt(*set, encrypt_to(set->keys[0].get(), plain), out, &err)) << err;
+        EXPECT_EQ(std::string(out.begin(), out.end()), plain);
+    }
+}
+
+TEST(OaepDecryptorTest, FallsBackToOlderKey) {
+    KeyManager::KeySet set;
+    set.keys.emplace_back(EVP_RSA_gen(1024), EVP_PKEY_free);
+    set.keys.emplace_back(EVP_RSA_gen(1024), EVP_PKEY_free);
+    set.retire_at_ms = {0, 1};
+    OaepDecryptor decryptor;
+    std::vector<unsigned char> out;
+    std::string err;
+    ASSERT_TRUE(decryptor.decrypt(set, encrypt_to(set.keys[1].get(), "old"), out, &err)) << err;
+    EXPECT_EQ(std::string(out.begin(), out.end()), "old");
+
+    // The old key retires; its context goes with it and its blobs no longer decrypt
+    KeyManager::Key old = set.keys.back();
+    set.keys.pop_back();
+    set.retire_at_ms.pop_back();
+    EXPECT_FALSE(decryptor.decrypt(set, encrypt_to(old.get(), "old"), out, &err));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(OaepDecryptorTest, NoKeys) {
+    KeyManager::KeySet set;
+    OaepDecryptor decryptor;
+    std::vector<unsigned char> out;
+    std::string err;
+    EXPECT_FALSE(decryptor.decrypt(set, {1, 2, 3}, out, &err));
+    EXPECT_NE(err.find("No private key"), std::string::npos);
+}
+
+TEST(CryptoPoolTest, DecryptsBatchAcrossThreads) {
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    EVP_PKEY* key = keys.keys()->keys.at(0).get();
+    CryptoPool pool(keys, 4, 1024);
+    Completions done;
+    std::vector<CryptoPool::Job> batch;
+    for (int i = 0; i < 64; ++i) batch.push_back(CryptoPool::Job{encrypt_to(key, "login" + std::to_string(i)), done.callback()});
+    ASSERT_TRUE(pool.submit(batch));
+    EXPECT_TRUE(batch.empty());
+    ASSERT_TRUE(done.wait_for(64));
+    EXPECT_EQ(done.ok, 64);
+    std::sort(done.plains.begin(), done.plains.end());
+    EXPECT_TRUE(std::binary_search(done.plains.begin(), done.plains.end(), "login63"));
+    CryptoPool::Stats stats = pool.stats();
+    EXPECT_EQ(stats.submitted, 64u);
+    EXPECT_EQ(stats.batches, 1u);
+}
+
+TEST(CryptoPoolTest, BadCiphertextFails) {
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    CryptoPool pool(keys, 1, 16);
+    Completions done;
+    std::vector<CryptoPool::Job> batch;
+    batch.push_back(CryptoPool::Job{std::vector<unsigned char>(128, 0x5a), done.callback()});
+    ASSERT_TRUE(pool.submit(batch));
+    ASSERT_TRUE(done.wait_for(1));
+    EXPECT_EQ(done.failed, 1);
+}
+
+TEST(CryptoPoolTest, QueuedJobsGoOutOnFlush) {
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    EVP_PKEY* key = keys.keys()->keys.at(0).get();
+    CryptoPool pool(keys, 2, 64);
+    Completions done;
+    for (int i = 0; i < 5; ++i) pool.queue(CryptoPool::Job{encrypt_to(key, "q"), done.callback()});
+    // Nothing is submitted until the pass ends
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(pool.stats().submitted, 0u);
+    CryptoPool::flush_pending();
+    ASSERT_TRUE(done.wait_for(5));
+    EXPECT_EQ(done.ok, 5);
+    EXPECT_EQ(pool.stats().batches, 1u);
+}
+
+TEST(CryptoPoolTest, FullQueueFailsTheBatch) {
+    KeyManager keys(CUSTOM1_PRIVATE_KEY_PATH);
+    EVP_PKEY* key = keys.keys()->keys.at(0).get();
+    CryptoPool pool(keys, 1, 2);
+    Completions done;
+    std::vector<CryptoPool::Job> batch;
+    for (int i = 0; i < 3; ++i) batch.push_back(CryptoPool::Job{encrypt_to(key, "x"), done.callback()});
+    EXPECT_FALSE(pool.submit(batch));
+    // Left for the caller
+    EXPECT_EQ(batch.size(), 3u);
+    EXPECT_EQ(pool.stats().rejected, 3u);
+
+    for (CryptoPool::Job& job : batch) pool.queue(std::move(job));
+    CryptoPool::flush_pending();
+    // Failed through the callbacks, on this thread
+    EXPECT_EQ(done.failed, 3);
+}
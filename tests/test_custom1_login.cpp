@@ -1,10 +1,17 @@
 #include "src/custom1_handlers.hpp"
 #include "src/custom1_packet.hpp"
 #include "src/session_manager.hpp"
+#include "src/crypto_pool.hpp"
+#include "src/deferred_response.hpp"
+#include "src/protocol_dispatch.hpp"
 #include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 // Extern for global session_manager
 extern SessionManager session_manager;
@@ -38,7 +45,7 @@ TEST(Custom1LoginTest, DecryptsAndStoresSessionKey) {
 
     // Act: call the handler
     Custom1Packet pkt = make_login_packet(session_id, encrypted_hex);
-    handle_custom1_login(pkt, connection_id, "data/private_key.pem");
+    EXPECT_EQ(handle_custom1_login(pkt, connection_id, "data/private_key.pem"), Custom1LoginResult::STORED);
 
     // Assert: session key and customer_id are stored in the connection info
     auto conn_info_opt = custom1_conn_mgr.get_connection(connection_id);
@@ -46,3 +53,157 @@ TEST(Custom1LoginTest, DecryptsAndStoresSessionKey) {
     EXPECT_EQ(conn_info_opt->session_key, expected_session_key);
     EXPECT_EQ(conn_info_opt->customer_id, customer_id);
 }
+
+namespace {
+// Holds one deferred answer and its delivery hook, as a worker's queue would
+struct HookSink : DeferredSink {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool posted = false;
+    std::string response;
+    DeliveryHook hook;
+    void post_deferred(int, uint64_t, std::string r, DeliveryHook on_delivery) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        response = std::move(r);
+        hook = std::move(on_delivery);
+        posted = true;
+        cv.notify_all();
+    }
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return posted; });
+    }
+};
+} // namespace
+
+TEST(Custom1LoginTest, PoolDecryptStoresKeyOnDelivery) {
+    std::string session_id = "poolsession";
+    std::string customer_id = "customer2";
+    session_manager.set(session_id, customer_id);
+    std::string encrypted_hex = "921bed1340e5b80fa99174cbca17b70bad2a699c69391ca5f0ff86393eb20a5a920840ecc04126c1a15efe226de5b7e3dbb3faf9e8b2e7710fa799b35f4473789080d92c91c393af4d3d327802f212851d888a87c663182554abe32d969eab52957e2bb1539a45c13e1e2ea00941f4f48ca3a11cf9a61c55dad2b08dfd5cf9d4";
+    int connection_id = 43;
+    custom1_conn_mgr.add_connection(connection_id);
+
+    CryptoPool pool(KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH), 1, 8);
+    set_custom1_crypto_pool(&pool);
+    HookSink sink;
+    {
+        DeferScope scope(sink, connection_id, 1);
+        EXPECT_EQ(handle_custom1_login(make_login_packet(session_id, encrypted_hex), connection_id),
+                  Custom1LoginResult::DEFERRED);
+        EXPECT_TRUE(take_deferred());
+    }
+    CryptoPool::flush_pending();
+    sink.wait();
+    set_custom1_crypto_pool(nullptr);
+    // Decrypted, but stored only when the worker delivers the answer
+    EXPECT_EQ(custom1_conn_mgr.get_connection(connection_id)->session_key, "");
+    EXPECT_EQ(sink.response, CUSTOM1_REPLY_OK);
+    ASSERT_TRUE(sink.hook);
+    ConnContext ctx;
+    sink.hook(ctx);
+    EXPECT_EQ(custom1_conn_mgr.get_connection(connection_id)->session_key,
+              "12b88837609be6fece4967fc8eea92a285ab21b96953de991e90ad2a4917108d");
+    EXPECT_EQ(custom1_conn_mgr.get_connection(connection_id)->customer_id, customer_id);
+    // The hook keys the connection it is delivered to
+    EXPECT_TRUE(ctx.cipher.ready());
+    custom1_conn_mgr.remove_connection(connection_id);
+}
+
+TEST(Custom1LoginTest, PoolDecryptFailureIsTheReply) {
+    std::string session_id = "badpoolsession";
+    session_manager.set(session_id, "customer3");
+    int connection_id = 46;
+    custom1_conn_mgr.add_connection(connection_id);
+
+    CryptoPool pool(KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH), 1, 8);
+    set_custom1_crypto_pool(&pool);
+    HookSink sink;
+    {
+        DeferScope scope(sink, connection_id, 1);
+        handle_custom1_login(make_login_packet(session_id, std::string(256, 'a')), connection_id);
+        EXPECT_TRUE(take_deferred());
+    }
+    CryptoPool::flush_pending();
+    sink.wait();
+    set_custom1_crypto_pool(nullptr);
+    EXPECT_EQ(sink.response, CUSTOM1_REPLY_LOGIN_FAILED);
+    EXPECT_FALSE(sink.hook);
+    EXPECT_EQ(custom1_conn_mgr.get_connection(connection_id)->session_key, "");
+    custom1_conn_mgr.remove_connection(connection_id);
+}
+
+namespace {
+// A frame as a client sends it: lengths and a CRC-32 trailer filled in
+std::string pack_frame(Custom1PacketView& frame) {
+    size_t size = frame.packed_size();
+    frame.packet_length = static_cast<uint16_t>(size);
+    frame.packet_length_4 = static_cast<uint32_t>(size);
+    std::string out(size, '\0');
+    frame.pack_into(reinterpret_cast<uint8_t*>(&out[0]), size, true);
+    return out;
+}
+
+std::string read_all(int fd) {
+    std::string all;
+    char buf[512];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) all.append(buf, n);
+    return all;
+}
+} // namespace
+
+TEST(Custom1LoginTest, FramesAfterLoginRoundTripThroughTheCipher) {
+    std::string session_id = "ciphersession";
+    session_manager.set(session_id, "customer4");
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    // The dispatcher uses the fd as the connection id
+    custom1_conn_mgr.add_connection(sv[0]);
+    StreamBuffer in;
+    ConnContext ctx;
+    Custom1PacketView login;
+    login.message_id = 0x501;
+    login.version = 0x0101;
+    login.field1 = session_id;
+    login.field2 = "921bed1340e5b80fa99174cbca17b70bad2a699c69391ca5f0ff86393eb20a5a920840ecc04126c1a15efe226de5b7e3dbb3faf9e8b2e7710fa799b35f4473789080d92c91c393af4d3d327802f212851d888a87c663182554abe32d969eab52957e2bb1539a45c13e1e2ea00941f4f48ca3a11cf9a61c55dad2b08dfd5cf9d4";
+    std::string login_bytes = pack_frame(login);
+    in.append(login_bytes.data(), login_bytes.size());
+    process_input(sv[0], Protocol::CUSTOM1, in, ctx, false);
+    // The login's own reply is in the clear
+    EXPECT_EQ(read_all(sv[1]), CUSTOM1_REPLY_OK);
+    ASSERT_TRUE(ctx.cipher.ready());
+
+    // The client's side of the same session key
+    std::vector<unsigned char> key;
+    std::string err;
+    ASSERT_TRUE(hex_to_bin("12b88837609be6fece4967fc8eea92a285ab21b96953de991e90ad2a4917108d", key, &err)) << err;
+    StreamCipher client;
+    ASSERT_TRUE(client.init(key.data(), key.size(), &err)) << err;
+    // An unrouted frame. With the CRC check on, it is only answered if the
+    // server decrypted it back to exactly these bytes.
+    Custom1PacketView next;
+    next.message_id = 0x999;
+    next.version = 0x0101;
+    next.field1 = "after login";
+    std::string plain = pack_frame(next);
+    std::string wire = plain;
+    // CTR is its own inverse: the client's decrypt() runs the keystream the
+    // server decrypts with
+    ASSERT_TRUE(client.decrypt(reinterpret_cast<uint8_t*>(&wire[CUSTOM1_CLEAR_HEADER]), wire.size() - CUSTOM1_CLEAR_HEADER));
+    EXPECT_EQ(wire.substr(0, CUSTOM1_CLEAR_HEADER), plain.substr(0, CUSTOM1_CLEAR_HEADER));
+    EXPECT_NE(wire, plain);
+    set_custom1_verify_crc(true);
+    in.append(wire.data(), wire.size());
+    process_input(sv[0], Protocol::CUSTOM1, in, ctx, false);
+    set_custom1_verify_crc(false);
+    EXPECT_EQ(ctx.cipher.bytes_decrypted(), wire.size() - CUSTOM1_CLEAR_HEADER);
+
+    std::string reply = read_all(sv[1]);
+    ASSERT_EQ(reply.size(), sizeof(CUSTOM1_REPLY_OK) - 1);
+    EXPECT_NE(reply, CUSTOM1_REPLY_OK);
+    ASSERT_TRUE(client.encrypt(reinterpret_cast<uint8_t*>(&reply[0]), reply.size()));
+    EXPECT_EQ(reply, CUSTOM1_REPLY_OK);
+    custom1_conn_mgr.remove_connection(sv[0]);
+    close(sv[0]); close(sv[1]);
+}
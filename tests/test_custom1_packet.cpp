@@ -2,6 +2,7 @@
 #include "src/custom1_packet.hpp"
 #include "src/session_manager.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
@@ -35,8 +36,9 @@ std::vector<uint8_t> make_login_packet_buffer(const std::string& session_id, con
     // Field3 length (0)
     buf.push_back(0x00); buf.push_back(0x00);
     // No field3 data
-    // CRC32 (dummy)
-    buf.push_back(0x00); buf.push_back(0x00); buf.push_back(0x00); buf.push_back(0x00);
+    // CRC32 of everything above, halves swapped
+    uint32_t crc = custom1_crc_swap(custom1_frame_crc(buf.data(), buf.size()));
+    buf.push_back(crc >> 24); buf.push_back((crc >> 16) & 0xFF); buf.push_back((crc >> 8) & 0xFF); buf.push_back(crc & 0xFF);
     return buf;
 }
 
@@ -64,5 +66,161 @@ TEST(Custom1PacketTest, HandleCustom1PacketLogin) {
     ASSERT_TRUE(conn_info_opt.has_value());
     EXPECT_EQ(conn_info_opt->session_key, expected_session_key);
     EXPECT_EQ(conn_info_opt->customer_id, customer_id);
+    char reply[64];
+    ssize_t n = recv(sv[1], reply, sizeof(reply), MSG_DONTWAIT);
+    EXPECT_EQ(std::string(reply, std::max<ssize_t>(n, 0)), CUSTOM1_REPLY_OK);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(Custom1PacketTest, ViewParsesInPlace) {
+    std::vector<uint8_t> buf = make_login_packet_buffer("abc", std::string(256, 'f'));
+    std::string_view data(reinterpret_cast<const char*>(buf.data()), buf.size());
+    Custom1PacketView view;
+    std::string err;
+    ASSERT_TRUE(view.parse(data, &err)) << err;
+    EXPECT_EQ(view.message_id, 0x501);
+    EXPECT_EQ(view.version, 0x0101);
+    EXPECT_EQ(view.packet_length_4, 0x12fu);
+    EXPECT_EQ(view.field1, "abc");
+    EXPECT_EQ(view.field2.size(), 256u);
+    EXPECT_TRUE(view.field3.empty());
+    // No copies: the fields point into the buffer
+    EXPECT_EQ(view.field1.data(), data.data() + 14);
+}
+
+TEST(Custom1PacketTest, ViewRejectsLengthsPastTheEnd) {
+    std::vector<uint8_t> good = make_login_packet_buffer("abc", std::string(256, 'f'));
+    std::string err;
+    Custom1PacketView view;
+    // Every truncation fails cleanly instead of reading past the buffer
+    for (size_t len = 0; len < good.size(); ++len) {
+        std::string_view cut(reinterpret_cast<const char*>(good.data()), len);
+        EXPECT_FALSE(view.parse(cut, &err)) << "length " << len;
+    }
+    // A field length larger than the packet
+    std::vector<uint8_t> bad = good;
+    bad[12] = 0xff;
+    bad[13] = 0xff;
+    EXPECT_FALSE(view.parse(std::string_view(reinterpret_cast<const char*>(bad.data()), bad.size()), &err));
+    EXPECT_NE(err.find("Field1"), std::string::npos);
+    EXPECT_THROW(Custom1PacketPacker().unpack(bad), std::runtime_error);
+}
+
+TEST(Custom1PacketTest, PackIntoRoundTrips) {
+    std::vector<uint8_t> buf = make_login_packet_buffer("session", std::string(256, 'a'));
+    Custom1PacketView view;
+    std::string err;
+    ASSERT_TRUE(view.parse(std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size()), &err)) << err;
+    ASSERT_EQ(view.packed_size(), buf.size());
+    uint8_t out[512];
+    ASSERT_EQ(view.pack_into(out, sizeof(out)), buf.size());
+    EXPECT_EQ(std::vector<uint8_t>(out, out + buf.size()), buf);
+    // fill_crc recomputes the trailer, whatever the view holds
+    view.crc32 = 0;
+    ASSERT_EQ(view.pack_into(out, sizeof(out), true), buf.size());
+    EXPECT_EQ(std::vector<uint8_t>(out, out + buf.size()), buf);
+    // Without it the member is written as is
+    ASSERT_EQ(view.pack_into(out, sizeof(out)), buf.size());
+    EXPECT_EQ(read_u32(out + buf.size() - 4), 0u);
+    // Too small a buffer gets nothing
+    EXPECT_EQ(view.pack_into(out, buf.size() - 1), 0u);
+
+    // The owning wrapper gives the same bytes
+    Custom1PacketPacker packer;
+    EXPECT_EQ(packer.pack(packer.unpack(buf)), buf);
+}
+
+TEST(Custom1PacketTest, PackRejectsOversizedField) {
+    std::string big(70000, 'x');
+    Custom1PacketView view;
+    view.field2 = big;
+    EXPECT_EQ(view.packed_size(), 0u);
+    std::vector<uint8_t> out(80000);
+    EXPECT_EQ(view.pack_into(out.data(), out.size()), 0u);
+}
+
+TEST(Custom1PacketTest, CrcIsStoredWithHalvesSwapped) {
+    std::vector<uint8_t> buf = make_login_packet_buffer("abc", std::string(256, 'f'));
+    std::string_view data(reinterpret_cast<const char*>(buf.data()), buf.size());
+    Custom1PacketView view;
+    std::string err;
+    ASSERT_TRUE(view.parse(data, &err)) << err;
+    uint32_t expected = crc32(buf.data(), buf.size() - 4);
+    // Stored as sent
+    EXPECT_EQ(view.crc32, (expected << 16) | (expected >> 16));
+    EXPECT_EQ(read_u32(buf.data() + buf.size() - 4), view.crc32);
+    EXPECT_TRUE(view.crc_valid(data));
+    EXPECT_EQ(custom1_crc_swap(0xfea31c19), 0x1c19fea3u);
+
+    // Any flipped bit, in the body or the CRC itself, fails the check
+    for (size_t i : {size_t{0}, size_t{15}, size_t{200}, buf.size() - 1}) {
+        std::vector<uint8_t> bad = buf;
+        bad[i] ^= 0x01;
+        std::string_view bad_data(reinterpret_cast<const char*>(bad.data()), bad.size());
+        ASSERT_TRUE(view.parse(bad_data, &err)) << err;
+        EXPECT_FALSE(view.crc_valid(bad_data)) << "byte " << i;
+    }
+}
+
+TEST(Custom1PacketTest, BadCrcDroppedBeforeLogin) {
+    std::string session_id = "crcsession";
+    extern SessionManager session_manager;
+    session_manager.set(session_id, "customer2");
+    int connection_id = 44;
+    custom1_conn_mgr.add_connection(connection_id);
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    std::vector<uint8_t> buf = make_login_packet_buffer(session_id, std::string(256, 'a'));
+    buf.back() ^= 0xFF;
+    std::string data(buf.begin(), buf.end());
+    set_custom1_verify_crc(true);
+    EXPECT_FALSE(handle_custom1_packet(sv[0], data, connection_id));
+    // No reply, and the login never ran
+    char reply[64];
+    EXPECT_LT(recv(sv[1], reply, sizeof(reply), MSG_DONTWAIT), 0);
+    auto conn_info_opt = custom1_conn_mgr.get_connection(connection_id);
+    ASSERT_TRUE(conn_info_opt.has_value());
+    EXPECT_TRUE(conn_info_opt->customer_id.empty());
+
+    // With the check off (the default) the frame gets its reply
+    set_custom1_verify_crc(false);
+    handle_custom1_packet(sv[0], data, connection_id);
+    EXPECT_GT(recv(sv[1], reply, sizeof(reply), MSG_DONTWAIT), 0);
+    close(sv[0]); close(sv[1]);
+}
+
+// The admin login captured in src/parsers/nps/LoginRequestMessage.ts. It
+// ends in the same fea31c19 as the capture in custom1_handlers.cpp, though
+// its username and key differ, so the trailer is not a CRC of the frame.
+TEST(Custom1PacketTest, RealCaptureIsHandledByDefault) {
+    const char* hex =
+        "050101210101000000000121000561646d696e00000100"
+        "38373430313844413844354437313033424445363343364444373639393730433839463138343133444343373744334641394332"
+        "32314237304542333230393345384635323630443644463432353345383932313242433436433037353732343634453430433338"
+        "30443933423531463636444339323035354337353135343137383035314346353842353834353745333135333339344439363831"
+        "44434644393842394430383531313536374130364237383246364335374344453145333438383342424235424546463731314137"
+        "43334345444246334141353441394136463630394531463133324134383244423937383533354345434645323346313400043231"
+        "3736fea31c19";
+    std::vector<unsigned char> frame;
+    std::string err;
+    ASSERT_TRUE(hex_to_bin(hex, frame, &err)) << err;
+    std::string data(frame.begin(), frame.end());
+    EXPECT_FALSE(custom1_crc_valid(data));
+    // Packing gives back the bytes it came from, trailer included
+    Custom1PacketView view;
+    ASSERT_TRUE(view.parse(data, &err)) << err;
+    EXPECT_EQ(view.crc32, 0xfea31c19u);
+    std::vector<uint8_t> out(view.packed_size());
+    ASSERT_EQ(view.pack_into(out.data(), out.size()), frame.size());
+    EXPECT_TRUE(std::equal(out.begin(), out.end(), frame.begin()));
+    Custom1PacketPacker packer;
+    EXPECT_EQ(packer.pack(packer.unpack(out)), out);
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    EXPECT_TRUE(handle_custom1_packet(sv[0], data, 45));
+    // No session for its ticket here, so the login is refused on the wire
+    char reply[64];
+    ssize_t n = recv(sv[1], reply, sizeof(reply), MSG_DONTWAIT);
+    EXPECT_EQ(std::string(reply, std::max<ssize_t>(n, 0)), CUSTOM1_REPLY_LOGIN_FAILED);
     close(sv[0]); close(sv[1]);
 }
@@ -0,0 +1,139 @@
+#include "custom1_schema.hpp"
+#include "custom1_packet.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+// A made-up message with every field kind
+struct Greeting {
+    uint16_t message_id = 0;
+    uint32_t flags = 0;
+    std::string_view name;
+    std::string_view note;
+    uint32_t crc32 = 0;
+};
+using GreetingCodec = custom1::Codec<Greeting,
+    custom1::U16<&Greeting::message_id>,
+    custom1::U32<&Greeting::flags>,
+    custom1::Bytes<&Greeting::name>,
+    custom1::Bytes<&Greeting::note>,
+    custom1::Crc32<&Greeting::crc32>>;
+static_assert(GreetingCodec::fixed_size == 14, "2 + 4 + 2 + 2 + 4");
+
+std::vector<uint8_t> encode(const Greeting& g, bool fill_crc = false) {
+    std::vector<uint8_t> out(GreetingCodec::encoded_size(g));
+    EXPECT_EQ(GreetingCodec::encode(g, out.data(), out.size(), fill_crc), out.size());
+    return out;
+}
+
+std::string_view as_view(const std::vector<uint8_t>& buf, size_t len) {
+    return std::string_view(reinterpret_cast<const char*>(buf.data()), len);
+}
+
+bool first(const Custom1Request&) { return true; }
+bool second(const Custom1Request&) { return false; }
+bool third(const Custom1Request&) { return true; }
+
+constexpr Custom1Route TEST_ROUTES[] = {
+    {0x532, 2, third},
+    {0x501, CUSTOM1_ANY_VERSION, first},
+    {0x532, CUSTOM1_ANY_VERSION, second},
+};
+constexpr Custom1RouteTable<3> TEST_TABLE(TEST_ROUTES);
+// Resolved by the compiler
+static_assert(TEST_TABLE.find(0x501, 7) == first, "any version");
+static_assert(TEST_TABLE.find(0x532, 2) == third, "exact version wins");
+static_assert(TEST_TABLE.find(0x532, 1) == second, "falls back to any version");
+static_assert(TEST_TABLE.find(0x999, 0) == nullptr, "unknown id");
+} // namespace
+
+TEST(Custom1SchemaTest, RoundTripsWithoutCopies) {
+    std::string name = "player";
+    Greeting g;
+    g.message_id = 0x532;
+    g.flags = 0xDEADBEEF;
+    g.name = name;
+    g.crc32 = 0x01020304;
+    std::vector<uint8_t> buf = encode(g);
+    ASSERT_EQ(buf.size(), GreetingCodec::fixed_size + name.size());
+    EXPECT_EQ(buf[0], 0x05);
+    EXPECT_EQ(buf[1], 0x32);
+    EXPECT_EQ(read_u32(buf.data() + 2), 0xDEADBEEFu);
+    // The trailer is written as given
+    EXPECT_EQ(read_u32(buf.data() + buf.size() - 4), 0x01020304u);
+
+    Greeting out;
+    std::string err;
+    std::string_view data = as_view(buf, buf.size());
+    ASSERT_EQ(GreetingCodec::decode(data, out, &err), buf.size()) << err;
+    EXPECT_EQ(out.message_id, 0x532);
+    EXPECT_EQ(out.flags, 0xDEADBEEFu);
+    EXPECT_EQ(out.name, "player");
+    EXPECT_TRUE(out.note.empty());
+    EXPECT_EQ(out.crc32, 0x01020304u);
+    // Points into the buffer
+    EXPECT_EQ(out.name.data(), data.data() + 8);
+}
+
+TEST(Custom1SchemaTest, FillCrcComputesTheTrailer) {
+    std::string name = "player";
+    Greeting g;
+    g.message_id = 0x532;
+    g.name = name;
+    g.crc32 = 0x01020304;
+    std::vector<uint8_t> buf = encode(g, true);
+    EXPECT_TRUE(custom1_crc_valid(as_view(buf, buf.size())));
+    Greeting out;
+    std::string err;
+    ASSERT_EQ(GreetingCodec::decode(as_view(buf, buf.size()), out, &err), buf.size()) << err;
+    EXPECT_EQ(custom1_crc_swap(out.crc32), crc32(buf.data(), buf.size() - 4));
+}
+
+TEST(Custom1SchemaTest, EveryTruncationFails) {
+    std::string name = "abc";
+    std::string note = "hello";
+    Greeting g;
+    g.name = name;
+    g.note = note;
+    std::vector<uint8_t> buf = encode(g);
+    Greeting out;
+    std::string err;
+    for (size_t len = 0; len < buf.size(); ++len) {
+        EXPECT_EQ(GreetingCodec::decode(as_view(buf, len), out, &err), 0u) << "length " << len;
+    }
+    // Trailing bytes are left for the caller
+    buf.push_back(0);
+    EXPECT_EQ(GreetingCodec::decode(as_view(buf, buf.size()), out, &err), buf.size() - 1);
+}
+
+TEST(Custom1SchemaTest, ErrorsNameTheField) {
+    Greeting g;
+    std::vector<uint8_t> buf = encode(g);
+    Greeting out;
+    std::string err;
+    EXPECT_EQ(GreetingCodec::decode(as_view(buf, 3), out, &err), 0u);
+    EXPECT_EQ(err, "Packet too short");
+    // The second length-prefixed field claims more than is left
+    buf[9] = 9;
+    EXPECT_EQ(GreetingCodec::decode(as_view(buf, buf.size()), out, &err), 0u);
+    EXPECT_EQ(err, "Field2 length runs past the end of the packet");
+}
+
+TEST(Custom1SchemaTest, EncodeRejectsOversizedOrShortBuffer) {
+    std::string big(70000, 'x');
+    Greeting g;
+    g.note = big;
+    EXPECT_EQ(GreetingCodec::encoded_size(g), 0u);
+    std::vector<uint8_t> out(80000);
+    EXPECT_EQ(GreetingCodec::encode(g, out.data(), out.size()), 0u);
+    g.note = "ok";
+    EXPECT_EQ(GreetingCodec::encode(g, out.data(), GreetingCodec::encoded_size(g) - 1), 0u);
+}
+
+TEST(Custom1SchemaTest, RouteTableSortsAndFinds) {
+    EXPECT_EQ(TEST_TABLE.size(), 3u);
+    EXPECT_EQ(TEST_TABLE.find(0x532, 2), third);
+    EXPECT_EQ(TEST_TABLE.find(0x532, 0), second);
+    EXPECT_EQ(TEST_TABLE.find(0x500, CUSTOM1_ANY_VERSION), nullptr);
+}
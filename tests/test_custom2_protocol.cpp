@@ -0,0 +1,154 @@
+#include "src/custom2_handlers.hpp"
+#include "src/custom2_protocol.hpp"
+#include "src/protocol_dispatch.hpp"
+#include "src/session_manager.hpp"
+#include "src/stream_buffer.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// Extern for global session_manager
+extern SessionManager session_manager;
+
+namespace {
+std::string frame(uint16_t type, uint16_t seq, std::string_view payload = "") {
+    std::string out;
+    custom2_append_frame(out, type, seq, payload);
+    return out;
+}
+
+struct Reply {
+    uint16_t type;
+    uint16_t seq;
+    std::string payload;
+};
+
+// Every frame the server has written to fd so far
+std::vector<Reply> read_replies(int fd) {
+    std::string all;
+    char buf[512];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) all.append(buf, n);
+    std::vector<Reply> replies;
+    std::string_view rest(all);
+    size_t len;
+    while ((len = custom2_frame_length(rest)) != 0 && len != std::string_view::npos) {
+        Custom2Frame f = custom2_parse_frame(rest.substr(0, len));
+        replies.push_back(Reply{f.type, f.seq, std::string(f.payload)});
+        rest.remove_prefix(len);
+    }
+    EXPECT_TRUE(rest.empty()) << "trailing bytes after the last reply";
+    return replies;
+}
+
+ConnAction feed(int fd, StreamBuffer& in, const std::string& bytes, bool peer_closed = false) {
+    ConnContext ctx;
+    in.append(bytes.data(), bytes.size());
+    return process_input(fd, Protocol::CUSTOM2, in, ctx, peer_closed);
+}
+} // namespace
+
+TEST(Custom2ProtocolTest, FrameLength) {
+    std::string ping = frame(CUSTOM2_PING, 1, "abc");
+    EXPECT_EQ(ping.size(), CUSTOM2_HEADER_SIZE + 3u);
+    EXPECT_EQ(custom2_frame_length(""), 0u);
+    EXPECT_EQ(custom2_frame_length(ping.substr(0, 5)), 0u);
+    EXPECT_EQ(custom2_frame_length(ping.substr(0, 10)), 0u);
+    EXPECT_EQ(custom2_frame_length(ping), ping.size());
+    EXPECT_EQ(custom2_frame_length(ping + "xx"), ping.size());
+    EXPECT_EQ(custom2_frame_length("hello"), std::string_view::npos);
+    std::string bad = ping;
+    bad[1] = 1;
+    EXPECT_EQ(custom2_frame_length(bad.substr(0, 2)), std::string_view::npos);
+}
+
+TEST(Custom2ProtocolTest, AnswersCoalescedAndSplitPings) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    std::string third = frame(CUSTOM2_PING, 3, "three");
+    // Two whole pings plus the first half of a third in one read
+    EXPECT_EQ(feed(sv[0], in, frame(CUSTOM2_PING, 1, "one") + frame(CUSTOM2_PING, 2) + third.substr(0, 5)),
+              ConnAction::KEEP_READING);
+    EXPECT_EQ(in.size(), 5u);
+    std::vector<Reply> replies = read_replies(sv[1]);
+    ASSERT_EQ(replies.size(), 2u);
+    EXPECT_EQ(replies[0].type, CUSTOM2_PING | CUSTOM2_REPLY);
+    EXPECT_EQ(replies[0].seq, 1);
+    EXPECT_EQ(replies[0].payload, "one");
+    EXPECT_EQ(replies[1].seq, 2);
+    EXPECT_EQ(replies[1].payload, "");
+    // The rest of the third arrives
+    EXPECT_EQ(feed(sv[0], in, third.substr(5)), ConnAction::KEEP_READING);
+    EXPECT_TRUE(in.empty());
+    replies = read_replies(sv[1]);
+    ASSERT_EQ(replies.size(), 1u);
+    EXPECT_EQ(replies[0].seq, 3);
+    EXPECT_EQ(replies[0].payload, "three");
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(Custom2ProtocolTest, AuthUsesTheAuthLoginSession) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    session_manager.set("custom2-ticket", "customer9");
+    custom2_conn_mgr.add_connection(sv[0]);
+    StreamBuffer in;
+    // Pipelined: answered in order, each against the state the one before left
+    std::string requests = frame(CUSTOM2_WHOAMI, 1) + frame(CUSTOM2_AUTH, 2, "no-such-ticket") +
+                           frame(CUSTOM2_AUTH, 3, "custom2-ticket") + frame(CUSTOM2_WHOAMI, 4);
+    EXPECT_EQ(feed(sv[0], in, requests), ConnAction::KEEP_READING);
+    std::vector<Reply> replies = read_replies(sv[1]);
+    ASSERT_EQ(replies.size(), 4u);
+    EXPECT_EQ(replies[0].type, CUSTOM2_ERROR);
+    EXPECT_EQ(replies[0].seq, 1);
+    EXPECT_EQ(replies[0].payload, "not authenticated");
+    EXPECT_EQ(replies[1].type, CUSTOM2_ERROR);
+    EXPECT_EQ(replies[1].payload, "unknown ticket");
+    EXPECT_EQ(replies[2].type, CUSTOM2_AUTH | CUSTOM2_REPLY);
+    EXPECT_EQ(replies[2].payload, "customer9");
+    EXPECT_EQ(replies[3].type, CUSTOM2_WHOAMI | CUSTOM2_REPLY);
+    EXPECT_EQ(replies[3].seq, 4);
+    EXPECT_EQ(replies[3].payload, "customer9");
+    EXPECT_EQ(custom2_conn_mgr.get_connection(sv[0])->customer_id, "customer9");
+    custom2_conn_mgr.remove_connection(sv[0]);
+    session_manager.remove("custom2-ticket");
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(Custom2ProtocolTest, UnknownTypeKeepsTheConnection) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    EXPECT_EQ(feed(sv[0], in, frame(0x7777, 5) + frame(CUSTOM2_PING, 6)), ConnAction::KEEP_READING);
+    std::vector<Reply> replies = read_replies(sv[1]);
+    ASSERT_EQ(replies.size(), 2u);
+    EXPECT_EQ(replies[0].type, CUSTOM2_ERROR);
+    EXPECT_EQ(replies[0].seq, 5);
+    EXPECT_EQ(replies[1].type, CUSTOM2_PING | CUSTOM2_REPLY);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(Custom2ProtocolTest, BadHeaderClosesAfterEarlierReplies) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    EXPECT_EQ(feed(sv[0], in, frame(CUSTOM2_PING, 1) + "hello"), ConnAction::CLOSE);
+    std::vector<Reply> replies = read_replies(sv[1]);
+    ASSERT_EQ(replies.size(), 2u);
+    EXPECT_EQ(replies[0].type, CUSTOM2_PING | CUSTOM2_REPLY);
+    EXPECT_EQ(replies[1].type, CUSTOM2_ERROR);
+    EXPECT_EQ(replies[1].payload, "bad frame header");
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(Custom2ProtocolTest, HalfClosedPeerStillGetsItsReplies) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    EXPECT_EQ(feed(sv[0], in, frame(CUSTOM2_PING, 1) + frame(CUSTOM2_PING, 2), true), ConnAction::CLOSE);
+    EXPECT_EQ(read_replies(sv[1]).size(), 2u);
+    close(sv[0]); close(sv[1]);
+}
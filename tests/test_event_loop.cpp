@@ -0,0 +1,48 @@
+#include "event_loop.hpp"
+#include <gtest/gtest.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST(EventLoopTest, DispatchesReadableFd) {
+    EventLoop loop;
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    int calls = 0;
+    ASSERT_TRUE(loop.add(sv[0], EPOLLIN, [&](uint32_t events) {
+        EXPECT_TRUE(events & EPOLLIN);
+        ++calls;
+    }));
+    ASSERT_EQ(write(sv[1], "x", 1), 1);
+    ASSERT_TRUE(loop.run_once(1000));
+    EXPECT_EQ(calls, 1);
+    // Edge-triggered: no new data means no new event
+    ASSERT_TRUE(loop.run_once(0));
+    EXPECT_EQ(calls, 1);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(EventLoopTest, CallbackCanRemoveItself) {
+    EventLoop loop;
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    ASSERT_TRUE(loop.add(sv[0], EPOLLIN, [&](uint32_t) {
+        loop.remove(sv[0]);
+    }));
+    ASSERT_EQ(write(sv[1], "x", 1), 1);
+    ASSERT_TRUE(loop.run_once(1000));
+    EXPECT_FALSE(loop.contains(sv[0]));
+    EXPECT_EQ(loop.size(), 0u);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(EventLoopTest, StopEndsRun) {
+    EventLoop loop;
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    ASSERT_TRUE(loop.add(sv[0], EPOLLIN, [&](uint32_t) { loop.stop(); }));
+    ASSERT_EQ(write(sv[1], "x", 1), 1);
+    loop.run();
+    SUCCEED();
+    close(sv[0]); close(sv[1]);
+}
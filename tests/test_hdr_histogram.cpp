@@ -0,0 +1,44 @@
+#include "bench/loadgen/hdr_histogram.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+
+TEST(HdrHistogramTest, SmallValuesAreExact) {
+    HdrHistogram h;
+    for (uint64_t v = 1; v <= 1000; ++v) h.record(v);
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.min(), 1u);
+    EXPECT_EQ(h.max(), 1000u);
+    EXPECT_EQ(h.value_at_percentile(50.0), 500u);
+    EXPECT_EQ(h.value_at_percentile(99.0), 990u);
+    EXPECT_EQ(h.value_at_percentile(100.0), 1000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 500.5);
+}
+
+TEST(HdrHistogramTest, LargeValuesKeepThreeDigits) {
+    HdrHistogram h;
+    // 1 us .. 1 s in ns
+    for (uint64_t v = 1; v <= 1000000; ++v) h.record(v * 1000);
+    auto near = [](uint64_t got, uint64_t want) { return got >= want && got <= want + want / 1000; };
+    EXPECT_TRUE(near(h.value_at_percentile(50.0), 500000000u)) << h.value_at_percentile(50.0);
+    EXPECT_TRUE(near(h.value_at_percentile(99.0), 990000000u)) << h.value_at_percentile(99.0);
+    EXPECT_TRUE(near(h.value_at_percentile(99.9), 999000000u)) << h.value_at_percentile(99.9);
+    // Never past the largest value recorded
+    EXPECT_EQ(h.value_at_percentile(100.0), 1000000000u);
+}
+
+TEST(HdrHistogramTest, AddsAndClamps) {
+    HdrHistogram a(1000000);
+    HdrHistogram b(1000000);
+    EXPECT_EQ(a.value_at_percentile(99.0), 0u);
+    a.record(10);
+    b.record(20);
+    b.record(5000000);
+    EXPECT_EQ(b.max(), 1000000u);
+    a.add(b);
+    EXPECT_EQ(a.count(), 3u);
+    EXPECT_EQ(a.min(), 10u);
+    EXPECT_EQ(a.value_at_percentile(50.0), 20u);
+    a.reset();
+    EXPECT_EQ(a.count(), 0u);
+    EXPECT_EQ(a.min(), 0u);
+}
@@ -0,0 +1,104 @@
+#include "hex_codec.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+// Every implementation this CPU can run
+std::vector<HexImpl> available_impls() {
+    std::vector<HexImpl> impls;
+    HexImpl original = hex_impl();
+    for (HexImpl impl : {HexImpl::SCALAR, HexImpl::SSE2, HexImpl::AVX2}) {
+        if (hex_set_impl(impl)) impls.push_back(impl);
+    }
+    hex_set_impl(original);
+    return impls;
+}
+
+std::string reference_encode(const std::vector<uint8_t>& bytes) {
+    std::string out;
+    char hex[3];
+    for (uint8_t b : bytes) {
+        snprintf(hex, sizeof(hex), "%02x", b);
+        out += hex;
+    }
+    return out;
+}
+
+// Restores the startup choice when a test ends
+struct ImplGuard {
+    HexImpl saved = hex_impl();
+    ~ImplGuard() { hex_set_impl(saved); }
+};
+} // namespace
+
+TEST(HexCodecTest, ScalarAlwaysAvailable) {
+    ImplGuard guard;
+    EXPECT_TRUE(hex_set_impl(HexImpl::SCALAR));
+    EXPECT_EQ(hex_impl(), HexImpl::SCALAR);
+    EXPECT_STREQ(hex_impl_name(HexImpl::AVX2), "avx2");
+}
+
+TEST(HexCodecTest, RoundTripsEveryLengthAndOffset) {
+    ImplGuard guard;
+    std::vector<uint8_t> bytes(300);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 37 + 11);
+    for (HexImpl impl : available_impls()) {
+        ASSERT_TRUE(hex_set_impl(impl));
+        // Odd offsets keep the vector loads unaligned
+        for (size_t offset = 0; offset < 3; ++offset) {
+            for (size_t len = 0; len + offset <= 140; ++len) {
+                std::vector<uint8_t> in(bytes.begin() + offset, bytes.begin() + offset + len);
+                std::string hex(2 * len + 1, '\0');
+                hex_encode(in.data(), len, &hex[offset % 2]);
+                std::string encoded = hex.substr(offset % 2, 2 * len);
+                ASSERT_EQ(encoded, reference_encode(in)) << hex_impl_name(impl) << " len " << len;
+                std::vector<uint8_t> back(len + 1);
+                size_t bad = 0;
+                ASSERT_TRUE(hex_decode(encoded.data(), len, back.data() + offset % 2, &bad)) << hex_impl_name(impl);
+                EXPECT_EQ(std::vector<uint8_t>(back.begin() + offset % 2, back.begin() + offset % 2 + len), in);
+            }
+        }
+    }
+}
+
+TEST(HexCodecTest, DecodesUppercase) {
+    ImplGuard guard;
+    std::string upper;
+    for (int i = 0; i < 8; ++i) upper += "0123456789ABCDEFabcdef";
+    for (HexImpl impl : available_impls()) {
+        ASSERT_TRUE(hex_set_impl(impl));
+        std::vector<uint8_t> out(upper.size() / 2);
+        ASSERT_TRUE(hex_decode(upper.data(), out.size(), out.data())) << hex_impl_name(impl);
+        EXPECT_EQ(out[5], 0xAB);
+        EXPECT_EQ(out[10], 0xef);
+    }
+}
+
+TEST(HexCodecTest, ReportsFirstBadCharacter) {
+    ImplGuard guard;
+    const std::string good(160, 'a');
+    // Characters right next to the valid ranges, and high bytes
+    const char bad_chars[] = {'/', ':', '@', 'G', '`', 'g', ' ', '\0', static_cast<char>(0x80), static_cast<char>(0xB0),
+                              static_cast<char>(0xE1), static_cast<char>(0xFF)};
+    for (HexImpl impl : available_impls()) {
+        ASSERT_TRUE(hex_set_impl(impl));
+        for (size_t pos = 0; pos < good.size(); pos += 7) {
+            for (char c : bad_chars) {
+                std::string hex = good;
+                hex[pos] = c;
+                if (pos + 20 < hex.size()) hex[pos + 20] = 'z';  // a later one isn't reported
+                std::vector<uint8_t> out(hex.size() / 2);
+                size_t bad = 12345;
+                EXPECT_FALSE(hex_decode(hex.data(), out.size(), out.data(), &bad)) << hex_impl_name(impl);
+                EXPECT_EQ(bad, pos) << hex_impl_name(impl) << " char " << static_cast<int>(static_cast<uint8_t>(c));
+            }
+        }
+    }
+}
+
+TEST(HexCodecTest, StringHelper) {
+    EXPECT_EQ(hex_encode(std::string_view("\x00\x7f\xff", 3)), "007fff");
+    EXPECT_EQ(hex_encode(std::string_view()), "");
+}
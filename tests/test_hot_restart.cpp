@@ -0,0 +1,69 @@
+#include "hot_restart.hpp"
+#include "session_manager.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+
+namespace {
+bool same_file(int a, int b) {
+    struct stat sa, sb;
+    return fstat(a, &sa) == 0 && fstat(b, &sb) == 0 && sa.st_ino == sb.st_ino && sa.st_dev == sb.st_dev;
+}
+} // namespace
+
+TEST(HotRestartTest, PassesListenerGroupsWithProtocols) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv), 0);
+    Handoff old_side(sv[0]), new_side(sv[1]);
+    int a[2], b[2];
+    ASSERT_EQ(pipe(a), 0);
+    ASSERT_EQ(pipe(b), 0);
+    std::vector<Handoff::ListenerGroup> sent = {{{a[0], Protocol::CUSTOM1}, {a[1], Protocol::HTTP}}, {{b[0], Protocol::AUTO}}};
+    ASSERT_TRUE(old_side.send_listeners(sent));
+    std::vector<Handoff::ListenerGroup> got;
+    ASSERT_TRUE(new_side.receive_listeners(got));
+    ASSERT_EQ(got.size(), 2u);
+    ASSERT_EQ(got[0].size(), 2u);
+    ASSERT_EQ(got[1].size(), 1u);
+    EXPECT_EQ(got[0][0].second, Protocol::CUSTOM1);
+    EXPECT_EQ(got[0][1].second, Protocol::HTTP);
+    EXPECT_EQ(got[1][0].second, Protocol::AUTO);
+    // Same open files, new descriptors
+    EXPECT_NE(got[0][0].first, a[0]);
+    EXPECT_TRUE(same_file(got[0][0].first, a[0]));
+    EXPECT_TRUE(same_file(got[1][0].first, b[0]));
+    for (const auto& group : got) {
+        for (const auto& l : group) close(l.first);
+    }
+    close(a[0]); close(a[1]); close(b[0]); close(b[1]);
+}
+
+TEST(HotRestartTest, ReadyThenSessionTable) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv), 0);
+    Handoff old_side(sv[0]), new_side(sv[1]);
+    SessionManager old_sessions, new_sessions;
+    // Enough entries to need several chunks
+    for (int i = 0; i < 5000; ++i) old_sessions.set("session-" + std::to_string(i), "customer-" + std::to_string(i));
+    std::thread old_thread([&] {
+        ASSERT_TRUE(old_side.wait_ready(5000));
+        ASSERT_TRUE(old_side.send_sessions(old_sessions));
+    });
+    EXPECT_TRUE(new_side.complete(new_sessions, 5000));
+    old_thread.join();
+    EXPECT_EQ(new_sessions.entries().size(), 5000u);
+    EXPECT_EQ(new_sessions.get("session-4321").value_or(""), "customer-4321");
+}
+
+TEST(HotRestartTest, ConnectWithoutRunningServerIsColdStart) {
+    std::string path = "/tmp/oxide-test-handoff-" + std::to_string(getpid()) + ".sock";
+    EXPECT_FALSE(Handoff::connect(path).valid());
+    int listen_fd = Handoff::listen(path);
+    ASSERT_GE(listen_fd, 0);
+    Handoff client = Handoff::connect(path);
+    EXPECT_TRUE(client.valid());
+    close(listen_fd);
+    unlink(path.c_str());
+}
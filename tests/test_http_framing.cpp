@@ -0,0 +1,50 @@
+#include "http_framing.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(HttpFramingTest, NeedsCompleteHeadAndBody) {
+    HttpRequestFrame frame;
+    EXPECT_FALSE(parse_http_frame("GET / HTTP/1.1\r\nHost: x\r\n", frame));
+    std::string request = "POST /AuthLogin HTTP/1.1\r\nContent-Length: 4\r\n\r\nab";
+    EXPECT_FALSE(parse_http_frame(request, frame));
+    request += "cdGET";
+    ASSERT_TRUE(parse_http_frame(request, frame));
+    EXPECT_EQ(frame.error_status, 0);
+    EXPECT_EQ(frame.head_length, request.find("ab"));
+    EXPECT_EQ(frame.total_length, frame.head_length + 4);
+}
+
+TEST(HttpFramingTest, ConnectionDefaultsByVersion) {
+    HttpRequestFrame frame;
+    ASSERT_TRUE(parse_http_frame("GET / HTTP/1.1\r\n\r\n", frame));
+    EXPECT_TRUE(frame.keep_alive);
+    ASSERT_TRUE(parse_http_frame("GET / HTTP/1.1\r\nconnection: Upgrade, Close\r\n\r\n", frame));
+    EXPECT_FALSE(frame.keep_alive);
+    ASSERT_TRUE(parse_http_frame("GET / HTTP/1.0\r\n\r\n", frame));
+    EXPECT_FALSE(frame.keep_alive);
+    EXPECT_TRUE(frame.http10);
+    ASSERT_TRUE(parse_http_frame("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", frame));
+    EXPECT_TRUE(frame.keep_alive);
+}
+
+TEST(HttpFramingTest, RejectsWhatItCannotFrame) {
+    HttpRequestFrame frame;
+    ASSERT_TRUE(parse_http_frame("POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n", frame));
+    EXPECT_EQ(frame.error_status, 400);
+    ASSERT_TRUE(parse_http_frame("POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", frame));
+    EXPECT_EQ(frame.error_status, 400);
+    ASSERT_TRUE(parse_http_frame("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", frame));
+    EXPECT_EQ(frame.error_status, 501);
+    ASSERT_TRUE(parse_http_frame("POST / HTTP/1.1\r\nContent-Length: 99999999\r\n\r\n", frame));
+    EXPECT_EQ(frame.error_status, 413);
+    ASSERT_TRUE(parse_http_frame("GET / HTTP/1.1\r\nX: " + std::string(HTTP_MAX_HEAD_SIZE, 'a'), frame));
+    EXPECT_EQ(frame.error_status, 431);
+}
+
+TEST(HttpFramingTest, ConnectionHeaderFollowsStatusLine) {
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    set_connection_header(response, true, false);
+    EXPECT_EQ(response.find("Connection"), std::string::npos);
+    set_connection_header(response, false, false);
+    EXPECT_EQ(response, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+}
@@ -0,0 +1,113 @@
+#include "http_request.hpp"
+#include "http_handlers.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+namespace {
+std::string read_all(int fd) {
+    std::string all;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) all.append(buf, n);
+    return all;
+}
+} // namespace
+
+TEST(HttpRequestTest, ParsesRequestLineAndQuery) {
+    std::string raw = "GET /AuthLogin?username=bob&password=p%25ss%20w&flag HTTP/1.1\r\nHost: x\r\n\r\n";
+    HttpRequestView request;
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    EXPECT_EQ(request.method, "GET");
+    EXPECT_EQ(request.path, "/AuthLogin");
+    EXPECT_EQ(request.version, "HTTP/1.1");
+    ASSERT_EQ(request.param_count, 3u);
+    EXPECT_EQ(request.param("username"), "bob");
+    EXPECT_EQ(request.param("password"), "p%ss w");
+    EXPECT_TRUE(request.has_param("flag"));
+    EXPECT_FALSE(request.has_param("missing"));
+    // Views point into the caller's buffer
+    EXPECT_GE(request.path.data(), raw.data());
+    EXPECT_LT(request.path.data(), raw.data() + raw.size());
+}
+
+TEST(HttpRequestTest, FindsHeadersCaseInsensitively) {
+    std::string raw = "GET / HTTP/1.1\r\nHost: x\r\nif-none-match:  \"abc\" \r\n\r\n";
+    HttpRequestView request;
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    EXPECT_EQ(request.header("If-None-Match"), "\"abc\"");
+    EXPECT_EQ(request.header("host"), "x");
+    EXPECT_EQ(request.header("Hos"), "");
+    raw = "GET / HTTP/1.1\r\n\r\n";
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    EXPECT_TRUE(request.headers.empty());
+}
+
+TEST(HttpRequestTest, RejectsMalformedRequestLine) {
+    std::string raw = "GET/AuthLogin\r\n\r\n";
+    HttpRequestView request;
+    EXPECT_FALSE(parse_http_request(&raw[0], raw.size(), request));
+    raw = "GET /AuthLogin\r\nHost: a b\r\n\r\n";
+    EXPECT_FALSE(parse_http_request(&raw[0], raw.size(), request));
+}
+
+TEST(HttpRequestTest, PercentDecodeKeepsMalformedEscapes) {
+    std::string s = "a%41%zz%4";
+    s.resize(percent_decode(&s[0], s.size()));
+    EXPECT_EQ(s, "aA%zz%4");
+    s = "a+b";
+    s.resize(percent_decode(&s[0], s.size()));
+    EXPECT_EQ(s, "a+b");
+}
+
+TEST(HttpRequestTest, FindDelimiterAcrossVectorWidth) {
+    std::string s(40, 'x');
+    EXPECT_EQ(find_delimiter(s.data(), s.data() + s.size(), '&', '='), s.data() + s.size());
+    for (size_t i : {0u, 15u, 16u, 33u, 39u}) {
+        std::string t = s;
+        t[i] = '=';
+        EXPECT_EQ(find_delimiter(t.data(), t.data() + t.size(), '&', '='), t.data() + i);
+    }
+}
+
+TEST(HttpRequestTest, RoutesByPath) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    std::string raw = "GET /ShardList/ HTTP/1.1\r\n\r\n";
+    HttpRequestView request;
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    EXPECT_TRUE(handle_http_request(sv[0], request));
+    std::string out = read_all(sv[1]);
+    EXPECT_EQ(out.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(out.find("[Shard 1]"), std::string::npos);
+    raw = "GET /ShardList HTTP/1.1\r\n\r\n";
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    EXPECT_TRUE(handle_http_request(sv[0], request));
+    EXPECT_EQ(read_all(sv[1]).rfind("HTTP/1.1 400", 0), 0u);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(HttpRequestTest, ShardListAnswers304ForCurrentETag) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    std::string raw = "GET /ShardList/ HTTP/1.1\r\n\r\n";
+    HttpRequestView request;
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    handle_http_request(sv[0], request);
+    std::string out = read_all(sv[1]);
+    size_t tag_start = out.find("ETag: ");
+    ASSERT_NE(tag_start, std::string::npos);
+    std::string etag = out.substr(tag_start + 6, out.find("\r\n", tag_start) - tag_start - 6);
+    raw = "GET /ShardList/ HTTP/1.1\r\nIf-None-Match: \"stale\", W/" + etag + "\r\n\r\n";
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    handle_http_request(sv[0], request);
+    out = read_all(sv[1]);
+    EXPECT_EQ(out.rfind("HTTP/1.1 304", 0), 0u);
+    EXPECT_EQ(out.find("[Shard 1]"), std::string::npos);
+    raw = "GET /ShardList/ HTTP/1.1\r\nIf-None-Match: \"stale\"\r\n\r\n";
+    ASSERT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    handle_http_request(sv[0], request);
+    EXPECT_EQ(read_all(sv[1]).rfind("HTTP/1.1 200", 0), 0u);
+    close(sv[0]); close(sv[1]);
+}
@@ -0,0 +1,177 @@
+#include "key_manager.hpp"
+#include "custom1_handlers.hpp"
+#include <gtest/gtest.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct PkeyDeleter {
+    void operator()(EVP_PKEY* p) const { EVP_PKEY_free(p); }
+};
+using Pkey = std::unique_ptr<EVP_PKEY, PkeyDeleter>;
+
+Pkey make_key() {
+    return Pkey(EVP_RSA_gen(1024));
+}
+
+// Replaces the file through a rename, as a deploy would
+void write_key(const std::string& path, EVP_PKEY* key) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(PEM_write_PrivateKey(f, key, nullptr, nullptr, 0, nullptr, nullptr), 1);
+    fclose(f);
+    ASSERT_EQ(rename(tmp.c_str(), path.c_str()), 0);
+}
+
+std::vector<unsigned char> encrypt_to(EVP_PKEY* key, const std::string& plain) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    EVP_PKEY_encrypt_init(ctx);
+    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING);
+    size_t len = 0;
+    EVP_PKEY_encrypt(ctx, nullptr, &len, reinterpret_cast<const unsigned char*>(plain.data()), plain.size());
+    std::vector<unsigned char> out(len);
+    EVP_PKEY_encrypt(ctx, out.data(), &len, reinterpret_cast<const unsigned char*>(plain.data()), plain.size());
+    out.resize(len);
+    EVP_PKEY_CTX_free(ctx);
+    return out;
+}
+
+bool decrypts(EVP_PKEY* key, const std::vector<unsigned char>& cipher) {
+    std::vector<unsigned char> out;
+    return rsa_oaep_decrypt(key, cipher, out, nullptr) && std::string(out.begin(), out.end()) == "session";
+}
+
+std::string temp_key_path() {
+    return "/tmp/oxide_key_manager_" + std::to_string(getpid()) + ".pem";
+}
+
+}  // namespace
+
+TEST(KeyManagerTest, LoadsOnFirstUse) {
+    std::string path = temp_key_path();
+    Pkey a = make_key();
+    write_key(path, a.get());
+    KeyManager keys(path);
+    auto set = keys.keys();
+    ASSERT_EQ(set->keys.size(), 1u);
+    EXPECT_TRUE(decrypts(set->keys[0].get(), encrypt_to(a.get(), "session")));
+    // Nothing changed, so the same set comes back
+    EXPECT_EQ(keys.keys(), set);
+    unlink(path.c_str());
+}
+
+TEST(KeyManagerTest, MissingFileGivesEmptySet) {
+    KeyManager keys("/does/not/exist.pem");
+    EXPECT_TRUE(keys.keys()->keys.empty());
+    std::string err;
+    EXPECT_FALSE(keys.reload(&err));
+    EXPECT_NE(err.find("Failed to open private key file"), std::string::npos);
+}
+
+TEST(KeyManagerTest, ReloadKeepsOldKeyForRotationWindow) {
+    std::string path = temp_key_path();
+    Pkey a = make_key();
+    Pkey b = make_key();
+    write_key(path, a.get());
+    KeyManager keys(path);
+    auto before = keys.keys();
+    ASSERT_EQ(before->keys.size(), 1u);
+
+    write_key(path, b.get());
+    KeyManager::request_reload();
+    auto after = keys.keys();
+    ASSERT_EQ(after->keys.size(), 2u);
+    // New key first, the old one still usable behind it
+    EXPECT_TRUE(decrypts(after->keys[0].get(), encrypt_to(b.get(), "session")));
+    EXPECT_TRUE(decrypts(after->keys[1].get(), encrypt_to(a.get(), "session")));
+    // A holder of the old set is unaffected
+    ASSERT_EQ(before->keys.size(), 1u);
+    EXPECT_TRUE(decrypts(before->keys[0].get(), encrypt_to(a.get(), "session")));
+
+    // Reloading the same file retires nothing
+    std::string err;
+    ASSERT_TRUE(keys.reload(&err)) << err;
+    EXPECT_EQ(keys.keys()->keys.size(), 2u);
+    unlink(path.c_str());
+}
+
+TEST(KeyManagerTest, ZeroWindowDropsOldKey) {
+    std::string path = temp_key_path();
+    Pkey a = make_key();
+    Pkey b = make_key();
+    write_key(path, a.get());
+    KeyManager keys(path, 0);
+    ASSERT_EQ(keys.keys()->keys.size(), 1u);
+    write_key(path, b.get());
+    std::string err;
+    ASSERT_TRUE(keys.reload(&err)) << err;
+    auto set = keys.keys();
+    ASSERT_EQ(set->keys.size(), 1u);
+    EXPECT_TRUE(decrypts(set->keys[0].get(), encrypt_to(b.get(), "session")));
+    unlink(path.c_str());
+}
+
+TEST(KeyManagerTest, BadFileKeepsCurrentKey) {
+    std::string path = temp_key_path();
+    Pkey a = make_key();
+    write_key(path, a.get());
+    KeyManager keys(path);
+    ASSERT_EQ(keys.keys()->keys.size(), 1u);
+    FILE* f = fopen(path.c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    fputs("not a key\n", f);
+    fclose(f);
+    std::string err;
+    EXPECT_FALSE(keys.reload(&err));
+    EXPECT_NE(err.find("Failed to read private key"), std::string::npos);
+    auto set = keys.keys();
+    ASSERT_EQ(set->keys.size(), 1u);
+    EXPECT_TRUE(decrypts(set->keys[0].get(), encrypt_to(a.get(), "session")));
+    unlink(path.c_str());
+}
+
+TEST(KeyManagerTest, ReloadUnderConcurrentUse) {
+    std::string path = temp_key_path();
+    Pkey a = make_key();
+    Pkey b = make_key();
+    write_key(path, a.get());
+    KeyManager keys(path);
+    ASSERT_EQ(keys.keys()->keys.size(), 1u);
+    auto cipher = encrypt_to(a.get(), "session");
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                auto set = keys.keys();
+                bool ok = false;
+                for (const auto& key : set->keys) ok |= decrypts(key.get(), cipher);
+                if (!ok) failures.fetch_add(1);
+            }
+        });
+    }
+    std::string err;
+    for (int i = 0; i < 20; ++i) {
+        write_key(path, (i % 2 ? a : b).get());
+        EXPECT_TRUE(keys.reload(&err)) << err;
+    }
+    stop.store(true);
+    for (auto& t : readers) t.join();
+    EXPECT_EQ(failures.load(), 0);
+    unlink(path.c_str());
+}
+
+TEST(KeyManagerTest, SharedManagerPerPath) {
+    EXPECT_EQ(&KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH), &KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH));
+    EXPECT_NE(&KeyManager::shared(CUSTOM1_PRIVATE_KEY_PATH), &KeyManager::shared("/does/not/exist.pem"));
+}
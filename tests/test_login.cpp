@@ -107,6 +107,31 @@ TEST(LoginTest, CustomerIdFail) {
     EXPECT_NE(resp.find("Could not retrieve customer ID"), std::string::npos);
 }
 
+// Only a wrong username or password may count against the account
+TEST(LoginTest, OutcomeBlamesOnlyCredentials) {
+    TestDBHandler db;
+    char salt[BCRYPT_HASHSIZE];
+    char hash[BCRYPT_HASHSIZE];
+    ASSERT_EQ(bcrypt_gensalt(4, salt), 0);
+    ASSERT_EQ(bcrypt_hashpw("adminpass", salt, hash), 0);
+    db.valid_hash = hash;
+    SessionManager sm;
+    EXPECT_EQ(authenticate_login("admin", "", db, sm).outcome, LoginOutcome::MISSING_PARAMS);
+    EXPECT_EQ(authenticate_login("nobody", "adminpass", db, sm).outcome, LoginOutcome::BAD_CREDENTIALS);
+    EXPECT_EQ(authenticate_login("admin", "wrongpass", db, sm).outcome, LoginOutcome::BAD_CREDENTIALS);
+    EXPECT_EQ(authenticate_login("admin", "adminpass", db, sm).outcome, LoginOutcome::SUCCESS);
+    db.force_customer_id_fail = true;
+    EXPECT_EQ(authenticate_login("admin", "adminpass", db, sm).outcome, LoginOutcome::SERVER_ERROR);
+    db.force_customer_id_fail = false;
+    db.connect_ok = false;
+    LoginResult down = authenticate_login("admin", "adminpass", db, sm);
+    EXPECT_EQ(down.outcome, LoginOutcome::SERVER_ERROR);
+    EXPECT_NE(down.response.find("Database connection error"), std::string::npos);
+    db.connect_ok = true;
+    db.valid_hash = "notbcrypt";
+    EXPECT_EQ(authenticate_login("admin", "adminpass", db, sm).outcome, LoginOutcome::SERVER_ERROR);
+}
+
 TEST(LoginTest, Success) {
     TestDBHandler db;
     char salt[BCRYPT_HASHSIZE];
@@ -0,0 +1,94 @@
+#include "http_handlers.hpp"
+#include "login_limiter.hpp"
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+LoginLimiter::Settings small_settings() {
+    LoginLimiter::Settings s;
+    s.ip_burst = 3;
+    s.ip_refill_ms = 1000;
+    s.max_failures = 2;
+    s.failure_decay_ms = 10000;
+    s.slots = 256;
+    return s;
+}
+
+uint32_t ip(const char* text) {
+    return inet_addr(text);
+}
+
+uint32_t client_of(uint32_t peer, std::string headers) {
+    std::string raw = "GET /AuthLogin?username=u HTTP/1.1\r\n" + headers + "\r\n";
+    HttpRequestView request;
+    EXPECT_TRUE(parse_http_request(&raw[0], raw.size(), request));
+    return login_client_address(peer, request);
+}
+} // namespace
+
+TEST(LoginLimiterTest, AddressBucketRefills) {
+    LoginLimiter limiter(small_settings(), 42);
+    for (int i = 0; i < 3; ++i) EXPECT_EQ(limiter.check(1, "u", 0), LoginLimiter::Verdict::ALLOW);
+    EXPECT_EQ(limiter.check(1, "u", 0), LoginLimiter::Verdict::IP_LIMITED);
+    // Other addresses are unaffected
+    EXPECT_EQ(limiter.check(2, "u", 0), LoginLimiter::Verdict::ALLOW);
+    EXPECT_EQ(limiter.check(1, "u", 999), LoginLimiter::Verdict::IP_LIMITED);
+    EXPECT_EQ(limiter.check(1, "u", 2000), LoginLimiter::Verdict::ALLOW);
+}
+
+TEST(LoginLimiterTest, FailuresLockUsernameUntilTheyDecay) {
+    LoginLimiter::Settings settings = small_settings();
+    settings.ip_burst = 0;
+    LoginLimiter limiter(settings, 42);
+    limiter.record("alice", false, 0);
+    EXPECT_EQ(limiter.check(1, "alice", 0), LoginLimiter::Verdict::ALLOW);
+    limiter.record("alice", false, 0);
+    EXPECT_EQ(limiter.check(1, "alice", 0), LoginLimiter::Verdict::USER_LOCKED);
+    EXPECT_EQ(limiter.check(1, "bob", 0), LoginLimiter::Verdict::ALLOW);
+    // One failure is forgotten per decay interval
+    EXPECT_EQ(limiter.check(1, "alice", 10000), LoginLimiter::Verdict::ALLOW);
+    limiter.record("alice", false, 10000);
+    EXPECT_EQ(limiter.check(1, "alice", 10000), LoginLimiter::Verdict::USER_LOCKED);
+}
+
+TEST(LoginLimiterTest, SuccessClearsFailures) {
+    LoginLimiter::Settings settings = small_settings();
+    settings.ip_burst = 0;
+    LoginLimiter limiter(settings, 42);
+    limiter.record("alice", false, 0);
+    limiter.record("alice", true, 0);
+    limiter.record("alice", false, 0);
+    EXPECT_EQ(limiter.check(1, "alice", 0), LoginLimiter::Verdict::ALLOW);
+}
+
+TEST(LoginLimiterTest, ManyKeysStayWithinFixedTables) {
+    LoginLimiter limiter(small_settings(), 42);
+    size_t capacity = limiter.capacity();
+    EXPECT_GE(capacity, 256u);
+    // A recent offender survives a flood of one-shot addresses touched earlier
+    for (int i = 0; i < 3; ++i) limiter.check(7, "u", 1000);
+    for (uint32_t ip = 100; ip < 200000; ++ip) limiter.check(ip, "u", 0);
+    EXPECT_EQ(limiter.capacity(), capacity);
+    EXPECT_EQ(limiter.check(7, "u", 1000), LoginLimiter::Verdict::IP_LIMITED);
+}
+
+TEST(LoginLimiterTest, ClientAddressComesFromTrustedProxiesOnly) {
+    std::string err;
+    ASSERT_TRUE(set_login_trusted_proxies("10.0.0.1, 10.0.0.2", &err)) << err;
+    // A trusted proxy names the client
+    EXPECT_EQ(client_of(ip("10.0.0.1"), "X-Real-IP: 203.0.113.7\r\n"), ip("203.0.113.7"));
+    // Its own X-Forwarded-For entry is the last one; earlier ones are the client's word
+    EXPECT_EQ(client_of(ip("10.0.0.2"), "X-Forwarded-For: 1.2.3.4, 198.51.100.9\r\n"), ip("198.51.100.9"));
+    // Without a usable header the proxy's address is all there is
+    EXPECT_EQ(client_of(ip("10.0.0.1"), "X-Real-IP: nonsense\r\n"), ip("10.0.0.1"));
+    // Anyone else can't pick their own bucket
+    EXPECT_EQ(client_of(ip("192.0.2.5"), "X-Real-IP: 203.0.113.7\r\n"), ip("192.0.2.5"));
+
+    EXPECT_FALSE(set_login_trusted_proxies("10.0.0.1,proxy", &err));
+    EXPECT_NE(err.find("proxy"), std::string::npos);
+    // A bad list leaves the old one in place
+    EXPECT_EQ(client_of(ip("10.0.0.2"), "X-Real-IP: 203.0.113.7\r\n"), ip("203.0.113.7"));
+    ASSERT_TRUE(set_login_trusted_proxies("", &err));
+    EXPECT_EQ(client_of(ip("10.0.0.1"), "X-Real-IP: 203.0.113.7\r\n"), ip("10.0.0.1"));
+}
@@ -0,0 +1,31 @@
+#include "net_io.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+TEST(NetIoTest, SendsDirectlyWithoutCapture) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    EXPECT_EQ(net_send(sv[0], "abc", 3), 3);
+    char buf[8] = {0};
+    EXPECT_EQ(recv(sv[1], buf, sizeof(buf), 0), 3);
+    EXPECT_EQ(std::string(buf), "abc");
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(NetIoTest, CaptureCollectsOnlyItsFd) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    std::string out;
+    {
+        SendCapture capture(sv[0], out);
+        EXPECT_EQ(net_send(sv[0], "hello ", 6), 6);
+        EXPECT_EQ(net_send(sv[0], "world", 5), 5);
+    }
+    EXPECT_EQ(out, "hello world");
+    char buf[8];
+    // Nothing reached the socket while captured
+    EXPECT_LT(recv(sv[1], buf, sizeof(buf), 0), 0);
+    close(sv[0]); close(sv[1]);
+}
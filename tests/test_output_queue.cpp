@@ -0,0 +1,62 @@
+#include "output_queue.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+namespace {
+std::string drain(int fd) {
+    std::string got;
+    char buf[65536];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) got.append(buf, n);
+    return got;
+}
+} // namespace
+
+TEST(OutputQueueTest, GathersBuffersInOrder) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    OutputQueue q;
+    q.push("hello ");
+    q.push("");
+    q.push("world");
+    EXPECT_EQ(q.size(), 11u);
+    EXPECT_EQ(q.flush(sv[0]), OutputQueue::FlushResult::DRAINED);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(drain(sv[1]), "hello world");
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(OutputQueueTest, KeepsRemainderWhenPeerStopsReading) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    int small = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    std::string expected;
+    OutputQueue q;
+    for (int i = 0; i < 200; ++i) {
+        std::string chunk(1000, static_cast<char>('a' + i % 26));
+        expected += chunk;
+        q.push(std::move(chunk));
+    }
+    EXPECT_EQ(q.flush(sv[0]), OutputQueue::FlushResult::BLOCKED);
+    EXPECT_GT(q.size(), 0u);
+    EXPECT_LT(q.size(), expected.size());
+    // Drain as the peer reads; short writes must resume mid-buffer
+    std::string got;
+    while (q.flush(sv[0]) == OutputQueue::FlushResult::BLOCKED) got += drain(sv[1]);
+    got += drain(sv[1]);
+    EXPECT_EQ(got, expected);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(OutputQueueTest, FailsOnceThePeerIsGone) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    close(sv[1]);
+    OutputQueue q;
+    q.push("late");
+    EXPECT_EQ(q.flush(sv[0]), OutputQueue::FlushResult::FAILED);
+    close(sv[0]);
+}
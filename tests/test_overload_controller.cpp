@@ -0,0 +1,47 @@
+#include "overload_controller.hpp"
+#include <gtest/gtest.h>
+
+using Clock = OverloadController::Clock;
+using std::chrono::milliseconds;
+
+TEST(OverloadControllerTest, NoSheddingBelowTarget) {
+    OverloadController ctl(milliseconds(5), milliseconds(100));
+    Clock::time_point t = Clock::now();
+    for (int i = 0; i < 100; ++i) {
+        t += milliseconds(10);
+        ctl.on_sample(t, milliseconds(1));
+        EXPECT_FALSE(ctl.should_shed(t));
+    }
+    EXPECT_FALSE(ctl.overloaded());
+}
+
+TEST(OverloadControllerTest, ShedsAfterAFullIntervalAboveTarget) {
+    OverloadController ctl(milliseconds(5), milliseconds(100));
+    Clock::time_point t = Clock::now();
+    ctl.on_sample(t, milliseconds(50));
+    EXPECT_FALSE(ctl.should_shed(t));
+    // Still inside the first interval: not yet overloaded
+    t += milliseconds(50);
+    ctl.on_sample(t, milliseconds(50));
+    EXPECT_FALSE(ctl.overloaded());
+    t += milliseconds(60);
+    ctl.on_sample(t, milliseconds(50));
+    EXPECT_TRUE(ctl.overloaded());
+    EXPECT_TRUE(ctl.should_shed(t));
+    // The next shed waits for the control interval
+    EXPECT_FALSE(ctl.should_shed(t + milliseconds(1)));
+    EXPECT_TRUE(ctl.should_shed(t + milliseconds(100)));
+    EXPECT_EQ(ctl.shed_count(), 2u);
+}
+
+TEST(OverloadControllerTest, RecoversWhenDelayDrops) {
+    OverloadController ctl(milliseconds(5), milliseconds(100));
+    Clock::time_point t = Clock::now();
+    ctl.on_sample(t, milliseconds(50));
+    t += milliseconds(150);
+    ctl.on_sample(t, milliseconds(50));
+    ASSERT_TRUE(ctl.overloaded());
+    ctl.on_sample(t, milliseconds(1));
+    EXPECT_FALSE(ctl.overloaded());
+    EXPECT_FALSE(ctl.should_shed(t + milliseconds(500)));
+}
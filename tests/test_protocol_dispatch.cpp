@@ -0,0 +1,250 @@
+#include "protocol_dispatch.hpp"
+#include "custom1_packet.hpp"
+#include "deferred_response.hpp"
+#include "http_handlers.hpp"
+#include "stream_buffer.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+// Smallest frame the Custom1 unpacker accepts: empty fields, message id 0x999
+std::string make_empty_frame() {
+    std::vector<uint8_t> f = {
+        0x09, 0x99, 0x00, 24,           // message id, packet length
+        0x01, 0x01, 0x00, 0x00,         // version, reserved
+        0x00, 0x00, 0x00, 24,           // packet length (4 bytes)
+        0x00, 0x00, 0x00, 0x00,         // field1 len, reserved2
+        0x00, 0x00, 0x00, 0x00,         // field2 len, field3 len
+        0x00, 0x00, 0x00, 0x00          // crc32, filled in below
+    };
+    write_u32(&f[20], custom1_crc_swap(custom1_frame_crc(f.data(), 20)));
+    return std::string(f.begin(), f.end());
+}
+
+std::string read_all(int fd) {
+    std::string all;
+    char buf[512];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) all.append(buf, n);
+    return all;
+}
+
+size_t count_responses(int fd) {
+    std::string all = read_all(fd);
+    size_t count = 0;
+    for (size_t pos = 0; (pos = all.find("Connected\n", pos)) != std::string::npos; ++pos) ++count;
+    return count;
+}
+} // namespace
+
+TEST(StreamBufferTest, GrowsAndConsumesWithoutLosingBytes) {
+    StreamBuffer buf(4);
+    buf.append("hello", 5);
+    buf.append(" world", 6);
+    EXPECT_EQ(buf.view(), "hello world");
+    buf.consume(6);
+    EXPECT_EQ(buf.view(), "world");
+    buf.append("!", 1);
+    EXPECT_EQ(buf.view(), "world!");
+    buf.consume(100);
+    EXPECT_TRUE(buf.empty());
+}
+
+TEST(ProtocolDispatchTest, Custom1FrameLength) {
+    std::string frame = make_empty_frame();
+    EXPECT_EQ(custom1_frame_length(frame.substr(0, 3)), 0u);
+    EXPECT_EQ(custom1_frame_length(frame.substr(0, 10)), 0u);
+    EXPECT_EQ(custom1_frame_length(frame), 24u);
+    EXPECT_EQ(custom1_frame_length(frame + "xx"), 24u);
+    std::string bad = frame;
+    bad[3] = 2;
+    EXPECT_EQ(custom1_frame_length(bad), std::string_view::npos);
+}
+
+TEST(ProtocolDispatchTest, Custom1DispatchesCoalescedAndSplitFrames) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    std::string frame = make_empty_frame();
+    StreamBuffer in;
+    ConnContext ctx;
+    // Two whole frames plus the first half of a third in one read
+    std::string chunk = frame + frame + frame.substr(0, 10);
+    in.append(chunk.data(), chunk.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::CUSTOM1, in, ctx, false), ConnAction::KEEP_READING);
+    EXPECT_EQ(in.size(), 10u);
+    EXPECT_EQ(count_responses(sv[1]), 2u);
+    // The rest of the third frame arrives
+    in.append(frame.data() + 10, frame.size() - 10);
+    EXPECT_EQ(process_input(sv[0], Protocol::CUSTOM1, in, ctx, false), ConnAction::KEEP_READING);
+    EXPECT_TRUE(in.empty());
+    EXPECT_EQ(count_responses(sv[1]), 1u);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolDispatchTest, Custom1InvalidLengthCloses) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    ConnContext ctx;
+    in.append("\x05\x01\x00\x01", 4);
+    EXPECT_EQ(process_input(sv[0], Protocol::CUSTOM1, in, ctx, false), ConnAction::CLOSE);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolDispatchTest, HttpWaitsForEndOfHead) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    ConnContext ctx;
+    std::string part = "GET /nothing HTTP/1.1\r\n";
+    in.append(part.data(), part.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+    EXPECT_EQ(read_all(sv[1]), "");
+    in.append("\r\n", 2);
+    // HTTP/1.1 stays open after the answer
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+    EXPECT_TRUE(in.empty());
+    EXPECT_EQ(read_all(sv[1]).rfind("HTTP/1.1 400", 0), 0u);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolDispatchTest, HttpAnswersPipelinedRequestsInOrder) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    ConnContext ctx;
+    std::string pipelined = "GET /one HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                            "GET /two HTTP/1.1\r\n\r\n"
+                            "GET /three HTTP/1.1\r\nConnection: close\r\n\r\n"
+                            "GET /ignored HTTP/1.1\r\n\r\n";
+    in.append(pipelined.data(), pipelined.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::CLOSE);
+    EXPECT_EQ(ctx.requests_served, 3u);
+    std::string out = read_all(sv[1]);
+    size_t count = 0;
+    for (size_t pos = 0; (pos = out.find("HTTP/1.1 400", pos)) != std::string::npos; ++pos) ++count;
+    EXPECT_EQ(count, 3u);
+    // Only the last answer announces the close
+    EXPECT_GT(out.find("Connection: close"), out.rfind("HTTP/1.1 400"));
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolDispatchTest, HttpClosesAtRequestLimit) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    ConnContext ctx;
+    ctx.max_requests = 2;
+    std::string request = "GET /x HTTP/1.1\r\n\r\n";
+    in.append(request.data(), request.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+    in.append(request.data(), request.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::CLOSE);
+    EXPECT_NE(read_all(sv[1]).find("Connection: close"), std::string::npos);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolDispatchTest, Http10ClosesUnlessAskedToKeepAlive) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    StreamBuffer in;
+    ConnContext ctx;
+    std::string request = "GET /x HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n";
+    in.append(request.data(), request.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+    EXPECT_NE(read_all(sv[1]).find("Connection: keep-alive\r\n"), std::string::npos);
+    request = "GET /x HTTP/1.0\r\n\r\n";
+    in.append(request.data(), request.size());
+    EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::CLOSE);
+    close(sv[0]); close(sv[1]);
+}
+
+namespace {
+// Collects one deferred answer, as a worker's completion queue would
+struct OneShotSink : DeferredSink {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string response;
+    bool posted = false;
+    void post_deferred(int, uint64_t, std::string r, DeliveryHook) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        response = std::move(r);
+        posted = true;
+        cv.notify_all();
+    }
+    std::string wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return posted; });
+        return response;
+    }
+};
+} // namespace
+
+TEST(ProtocolDispatchTest, HttpDeferredAnswerKeepsPipelineOrder) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    TaskPool pool("test auth", 1, 4);
+    set_auth_pool(&pool);
+    OneShotSink sink;
+    StreamBuffer in;
+    ConnContext ctx;
+    std::string pipelined = "GET /AuthLogin?username=nobody&password=x HTTP/1.1\r\n\r\n"
+                            "GET /after HTTP/1.1\r\n\r\n";
+    in.append(pipelined.data(), pipelined.size());
+    {
+        DeferScope scope(sink, sv[0], ctx.id);
+        EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+        EXPECT_TRUE(ctx.awaiting_response);
+        // Nothing behind the deferred request is answered yet
+        EXPECT_EQ(process_input(sv[0], Protocol::HTTP, in, ctx, false), ConnAction::KEEP_READING);
+        EXPECT_EQ(read_all(sv[1]), "");
+    }
+    std::string login = sink.wait();
+    set_auth_pool(nullptr);
+    EXPECT_EQ(complete_deferred(sv[0], Protocol::HTTP, in, ctx, login), ConnAction::KEEP_READING);
+    EXPECT_FALSE(ctx.awaiting_response);
+    std::string out = read_all(sv[1]);
+    size_t login_at = out.find("reasoncode=");
+    size_t after_at = out.find("HTTP/1.1 400");
+    ASSERT_NE(login_at, std::string::npos);
+    ASSERT_NE(after_at, std::string::npos);
+    EXPECT_LT(login_at, after_at);
+    close(sv[0]); close(sv[1]);
+}
+
+TEST(ProtocolSniffTest, HttpMethods) {
+    EXPECT_EQ(sniff_protocol("GET /AuthLogin HTTP/1.1\r\n", false, Protocol::CUSTOM2), Protocol::HTTP);
+    EXPECT_EQ(sniff_protocol("POST /", false, Protocol::AUTO), Protocol::HTTP);
+    // A method prefix needs more bytes, unless the peer is done
+    EXPECT_EQ(sniff_protocol("GE", false, Protocol::AUTO), Protocol::UNKNOWN);
+    EXPECT_EQ(sniff_protocol("OPTIO", false, Protocol::AUTO), Protocol::UNKNOWN);
+    EXPECT_EQ(sniff_protocol("GE", true, Protocol::AUTO), Protocol::CUSTOM2);
+}
+
+TEST(ProtocolSniffTest, NpsHeaderIsCustom1) {
+    std::string frame = make_empty_frame();
+    EXPECT_EQ(sniff_protocol(frame, false, Protocol::HTTP), Protocol::CUSTOM1);
+    EXPECT_EQ(sniff_protocol(frame.substr(0, 3), false, Protocol::HTTP), Protocol::UNKNOWN);
+    EXPECT_EQ(sniff_protocol(std::string("\x05\x01\x00\x02", 4), false, Protocol::HTTP), Protocol::HTTP);
+}
+
+TEST(ProtocolSniffTest, OtherTrafficUsesListenerFallback) {
+    EXPECT_EQ(sniff_protocol("hello there", false, Protocol::CUSTOM2), Protocol::CUSTOM2);
+    EXPECT_EQ(sniff_protocol("hello there", false, Protocol::AUTO), Protocol::CUSTOM2);
+    EXPECT_EQ(sniff_protocol("hello there", false, Protocol::HTTP), Protocol::HTTP);
+    // A Custom2 frame's marker byte keeps it from looking like an NPS header
+    std::string ping("\xC2\x00\x00\x01\x00\x07\x00\x00", 8);
+    EXPECT_EQ(sniff_protocol(ping, false, Protocol::AUTO), Protocol::CUSTOM2);
+}
+
+TEST(ProtocolSniffTest, NamesRoundTrip) {
+    for (Protocol p : {Protocol::HTTP, Protocol::CUSTOM1, Protocol::CUSTOM2, Protocol::AUTO}) {
+        EXPECT_EQ(protocol_from_name(protocol_name(p)), p);
+    }
+    EXPECT_EQ(protocol_from_name("SMTP"), Protocol::UNKNOWN);
+}
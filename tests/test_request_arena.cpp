@@ -0,0 +1,151 @@
+#include "request_arena.hpp"
+#include "buffer_pool.hpp"
+#include "custom1_packet.hpp"
+#include "custom2_protocol.hpp"
+#include "net_io.hpp"
+#include "output_queue.hpp"
+#include "protocol_dispatch.hpp"
+#include "stream_buffer.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts heap allocations made by this thread while `counting` is set
+namespace {
+thread_local bool counting = false;
+thread_local size_t allocations = 0;
+} // namespace
+
+// malloc-backed like the default, so the default operator delete still pairs
+// with it
+void* operator new(size_t n) {
+    if (counting) ++allocations;
+    void* p = std::malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+namespace {
+// Allocations made by fn
+template <typename Fn>
+size_t count_allocations(Fn fn) {
+    allocations = 0;
+    counting = true;
+    fn();
+    counting = false;
+    return allocations;
+}
+
+// A frame no route handles, so nothing but the dispatch path runs
+std::string make_frame() {
+    std::vector<uint8_t> f(24, 0);
+    write_u16(&f[0], 0x999);
+    write_u16(&f[2], 24);
+    write_u16(&f[4], 0x101);
+    write_u32(&f[8], 24);
+    write_u32(&f[20], custom1_crc_swap(custom1_frame_crc(f.data(), 20)));
+    return std::string(f.begin(), f.end());
+}
+
+// One read pass as the epoll worker runs it: dispatch into a pooled buffer,
+// queue it, and write it out
+ConnAction serve(int fd, Protocol protocol, StreamBuffer& in, ConnContext& ctx, OutputQueue& outq) {
+    std::string out = BufferPool::acquire_string();
+    ConnAction action;
+    {
+        SendCapture capture(fd, out);
+        action = process_input(fd, protocol, in, ctx, false);
+    }
+    outq.push(std::move(out));
+    outq.flush(fd);
+    return action;
+}
+
+void drain(int fd) {
+    char buf[4096];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {}
+}
+} // namespace
+
+TEST(RequestArenaTest, AlignsAndRewinds) {
+    RequestArena arena(256);
+    RequestArena::Mark start = arena.mark();
+    char* a = arena.allocate_array<char>(3);
+    uint64_t* b = arena.allocate_array<uint64_t>(2);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(uint64_t), 0u);
+    EXPECT_GT(reinterpret_cast<char*>(b), a);
+    std::string_view copied = arena.copy("hello");
+    EXPECT_EQ(copied, "hello");
+    arena.rewind(start);
+    // The same bytes serve the next request
+    EXPECT_EQ(arena.allocate_array<char>(3), a);
+}
+
+TEST(RequestArenaTest, KeepsGrownBlocksAcrossRequests) {
+    RequestArena arena(256);
+    auto request = [&arena] {
+        RequestArena::Mark mark = arena.mark();
+        for (int i = 0; i < 10; ++i) arena.allocate(200);
+        arena.rewind(mark);
+    };
+    request();
+    size_t grown = arena.capacity();
+    EXPECT_GE(grown, 2000u);
+    EXPECT_EQ(count_allocations(request), 0u);
+    EXPECT_EQ(arena.capacity(), grown);
+}
+
+TEST(RequestArenaTest, GivesBackAnOversizedRequestOnceEmpty) {
+    RequestArena arena(1024);
+    arena.allocate(100);
+    arena.allocate(REQUEST_ARENA_MAX_RETAINED * 2);
+    EXPECT_GT(arena.capacity(), static_cast<size_t>(REQUEST_ARENA_MAX_RETAINED));
+    arena.reset();
+    EXPECT_EQ(arena.capacity(), 1024u);
+}
+
+// Once buffers, arena and log line have grown, a request costs no heap
+// allocation at all
+TEST(RequestAllocationTest, SteadyStateRequestsDoNotAllocate) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    std::string frame = make_frame();
+    std::string http = "GET /ShardList/ HTTP/1.1\r\nHost: test\r\n\r\n";
+    StreamBuffer in;
+    ConnContext ctx;
+    OutputQueue outq;
+
+    auto custom1 = [&] {
+        in.append(frame.data(), frame.size());
+        EXPECT_EQ(serve(sv[0], Protocol::CUSTOM1, in, ctx, outq), ConnAction::KEEP_READING);
+        drain(sv[1]);
+    };
+    auto shard_list = [&] {
+        in.append(http.data(), http.size());
+        EXPECT_EQ(serve(sv[0], Protocol::HTTP, in, ctx, outq), ConnAction::KEEP_READING);
+        drain(sv[1]);
+    };
+    // Pipelined pings, answered together
+    std::string pings;
+    for (uint16_t seq = 0; seq < 4; ++seq) custom2_append_frame(pings, CUSTOM2_PING, seq, "hello");
+    auto custom2 = [&] {
+        in.append(pings.data(), pings.size());
+        EXPECT_EQ(serve(sv[0], Protocol::CUSTOM2, in, ctx, outq), ConnAction::KEEP_READING);
+        drain(sv[1]);
+    };
+    for (int i = 0; i < 3; ++i) {
+        custom1();
+        shard_list();
+        custom2();
+    }
+    EXPECT_EQ(count_allocations([&] { for (int i = 0; i < 50; ++i) custom1(); }), 0u);
+    EXPECT_EQ(count_allocations([&] { for (int i = 0; i < 50; ++i) shard_list(); }), 0u);
+    EXPECT_EQ(count_allocations([&] { for (int i = 0; i < 50; ++i) custom2(); }), 0u);
+    close(sv[0]);
+    close(sv[1]);
+}
@@ -1,5 +1,6 @@
 #include "src/Server.hpp"
 #include <gtest/gtest.h>
+#include <cstdlib>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
@@ -28,6 +29,45 @@ TEST(ServerTest, CreateListenerValidPort) {
 }
 */
 
+// Two SO_REUSEPORT listeners can share a port, and the CPU steering program attaches to the group
+TEST(ServerTest, ReusePortListenersShareAPort) {
+    Server server;
+    int first = server.create_listener(0, true);
+    ASSERT_GT(first, 0);
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(getsockname(first, (sockaddr*)&addr, &len), 0);
+    int second = server.create_listener(ntohs(addr.sin_port), true);
+    ASSERT_GT(second, 0);
+    EXPECT_TRUE(Server::attach_cpu_steering(first));
+    close(second);
+    close(first);
+}
+
+TEST(ServerConfigTest, ResolvesWorkerCount) {
+    ServerConfig cfg;
+    cfg.workers = 3;
+    EXPECT_EQ(cfg.resolved_workers(), 3);
+    cfg.workers = 0;
+    EXPECT_GE(cfg.resolved_workers(), 1);
+}
+
+// A quiet Custom1 client must be reaped (and counted) as idle, not keepalive
+TEST(ServerConfigTest, Custom1KeepaliveOutlastsIdleTimeout) {
+    ServerConfig cfg;
+    EXPECT_GT(cfg.custom1_keepalive_ms, cfg.custom1_idle_timeout_ms);
+}
+
+TEST(ServerConfigTest, AcceptBudgetIsAtLeastOne) {
+    setenv("OXIDE_ACCEPT_BUDGET", "0", 1);
+    EXPECT_EQ(ServerConfig::from_env().accept_budget, 1);
+    setenv("OXIDE_ACCEPT_BUDGET", "-5", 1);
+    EXPECT_EQ(ServerConfig::from_env().accept_budget, 1);
+    setenv("OXIDE_ACCEPT_BUDGET", "8", 1);
+    EXPECT_EQ(ServerConfig::from_env().accept_budget, 8);
+    unsetenv("OXIDE_ACCEPT_BUDGET");
+}
+
 // Main entry for gtest
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,17 @@
+#include "shard_manager.hpp"
+#include <gtest/gtest.h>
+
+TEST(ShardManagerTest, AddShardBumpsGeneration) {
+    ShardManager manager;
+    EXPECT_EQ(manager.generation(), 0u);
+    ShardInfo shard;
+    shard.id = "1";
+    manager.add_shard(shard);
+    uint64_t generation = 0;
+    auto shards = manager.list_shards(generation);
+    EXPECT_EQ(shards.size(), 1u);
+    EXPECT_EQ(generation, 1u);
+    EXPECT_EQ(manager.generation(), 1u);
+    manager.add_shard(shard);
+    EXPECT_EQ(manager.generation(), 2u);
+}
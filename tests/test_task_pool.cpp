@@ -0,0 +1,55 @@
+#include "task_pool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+TEST(TaskPoolTest, RunsSubmittedTasks) {
+    std::atomic<int> ran{0};
+    {
+        TaskPool pool("test", 2, 16);
+        for (int i = 0; i < 8; ++i) {
+            std::function<void()> task = [&ran] { ran.fetch_add(1); };
+            ASSERT_TRUE(pool.submit(task));
+        }
+        while (pool.stats().completed < 8) std::this_thread::yield();
+    }
+    EXPECT_EQ(ran.load(), 8);
+}
+
+TEST(TaskPoolTest, RejectsWhenQueueIsFull) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    bool started = false;
+    TaskPool pool("test", 1, 1);
+    // Occupies the only thread until released
+    std::function<void()> blocker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        started = true;
+        cv.notify_all();
+        cv.wait(lock, [&] { return release; });
+    };
+    ASSERT_TRUE(pool.submit(blocker));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return started; });
+    }
+    std::function<void()> queued = [] {};
+    ASSERT_TRUE(pool.submit(queued));
+    std::function<void()> rejected = [] {};
+    EXPECT_FALSE(pool.submit(rejected));
+    // A refused task is left for the caller
+    EXPECT_TRUE(static_cast<bool>(rejected));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    while (pool.stats().completed < 2) std::this_thread::yield();
+    TaskPool::Stats stats = pool.stats();
+    EXPECT_EQ(stats.submitted, 2u);
+    EXPECT_EQ(stats.rejected, 1u);
+    EXPECT_GT(stats.max_queue_wait_us, 0u);
+}
@@ -0,0 +1,123 @@
+#include "timer_wheel.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+TEST(TimerWheelTest, FiresOnceDeadlinePasses) {
+    std::vector<uint64_t> fired;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer& t) { fired.push_back(t.owner); });
+    TimerWheel::Timer t;
+    t.owner = 7;
+    wheel.schedule(t, 100);
+    EXPECT_TRUE(t.armed());
+    wheel.advance(90);
+    EXPECT_TRUE(fired.empty());
+    wheel.advance(100);
+    ASSERT_EQ(fired.size(), 1u);
+    EXPECT_EQ(fired[0], 7u);
+    EXPECT_FALSE(t.armed());
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, CascadesLongDeadlines) {
+    // Past the root wheel (2.56s at 10ms ticks) and past the first level (~164s)
+    std::vector<uint64_t> fired;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer& t) { fired.push_back(t.owner); });
+    TimerWheel::Timer a, b;
+    a.owner = 1;
+    b.owner = 2;
+    wheel.schedule(a, 5000);
+    wheel.schedule(b, 300000);
+    wheel.advance(4990);
+    EXPECT_TRUE(fired.empty());
+    wheel.advance(5000);
+    ASSERT_EQ(fired.size(), 1u);
+    wheel.advance(299990);
+    EXPECT_EQ(fired.size(), 1u);
+    wheel.advance(300000);
+    ASSERT_EQ(fired.size(), 2u);
+    EXPECT_EQ(fired[1], 2u);
+}
+
+TEST(TimerWheelTest, RescheduleAndCancel) {
+    int fired = 0;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer&) { ++fired; });
+    TimerWheel::Timer t;
+    wheel.schedule(t, 100);
+    wheel.advance(50);
+    wheel.schedule(t, 100);  // re-armed relative to now: due at 150
+    wheel.advance(120);
+    EXPECT_EQ(fired, 0);
+    EXPECT_EQ(wheel.size(), 1u);
+    t.cancel();
+    EXPECT_EQ(wheel.size(), 0u);
+    wheel.advance(1000);
+    EXPECT_EQ(fired, 0);
+}
+
+TEST(TimerWheelTest, DestroyedTimerIsDisarmed) {
+    int fired = 0;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer&) { ++fired; });
+    {
+        TimerWheel::Timer t;
+        wheel.schedule(t, 100);
+        EXPECT_EQ(wheel.size(), 1u);
+    }
+    EXPECT_EQ(wheel.size(), 0u);
+    wheel.advance(200);
+    EXPECT_EQ(fired, 0);
+}
+
+TEST(TimerWheelTest, CallbackMayCancelTimerDueInSameTick) {
+    // A reaped connection takes its other timers with it
+    auto a = std::make_unique<TimerWheel::Timer>();
+    auto b = std::make_unique<TimerWheel::Timer>();
+    int fired = 0;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer&) {
+        ++fired;
+        a.reset();
+        b.reset();
+    });
+    wheel.schedule(*a, 100);
+    wheel.schedule(*b, 100);
+    wheel.advance(100);
+    EXPECT_EQ(fired, 1);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, NextTimeoutTracksNearestRootSlot) {
+    TimerWheel wheel(10, 0, [](TimerWheel::Timer&) {});
+    EXPECT_EQ(wheel.next_timeout_ms(0), -1);
+    TimerWheel::Timer t;
+    wheel.schedule(t, 200);
+    EXPECT_EQ(wheel.next_timeout_ms(0), 200);
+    EXPECT_EQ(wheel.next_timeout_ms(150), 50);
+    // Far deadlines only wake the loop at the next cascade point
+    TimerWheel::Timer far;
+    t.cancel();
+    wheel.schedule(far, 60000);
+    EXPECT_EQ(wheel.next_timeout_ms(0), 2560);
+}
+
+TEST(TimerWheelTest, ManyTimersFireInOrder) {
+    const int count = 100000;
+    std::vector<TimerWheel::Timer> timers(count);
+    uint64_t last = 0;
+    int fired = 0;
+    bool ordered = true;
+    uint64_t now = 0;
+    TimerWheel wheel(10, 0, [&](TimerWheel::Timer& t) {
+        ordered = ordered && t.owner >= last && t.owner <= now;
+        last = t.owner;
+        ++fired;
+    });
+    for (int i = 0; i < count; ++i) {
+        uint64_t delay = 10 + (static_cast<uint64_t>(i) * 7919) % 400000;
+        timers[i].owner = (delay + 9) / 10 * 10;
+        wheel.schedule(timers[i], delay);
+    }
+    EXPECT_EQ(wheel.size(), static_cast<size_t>(count));
+    for (now = 0; now <= 400010; now += 1000) wheel.advance(now);
+    EXPECT_EQ(fired, count);
+    EXPECT_TRUE(ordered);
+}
@@ -0,0 +1,37 @@
+#include "uring.hpp"
+#include "uring_worker.hpp"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+TEST(IoUringTest, MultishotRecvUsesProvidedBuffers) {
+    if (!UringWorker::supported()) GTEST_SKIP() << "io_uring not available";
+    IoUring ring;
+    ASSERT_TRUE(ring.init(8));
+    ASSERT_TRUE(ring.setup_buffer_ring(0, 8, 64));
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ASSERT_EQ(write(sv[1], "hello", 5), 5);
+    io_uring_sqe* sqe = ring.get_sqe();
+    ASSERT_NE(sqe, nullptr);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sv[0];
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = 42;
+    ASSERT_GE(ring.submit_and_wait(1), 0);
+    std::string got;
+    unsigned seen = ring.drain_completions([&](const io_uring_cqe& cqe) {
+        EXPECT_EQ(cqe.user_data, 42u);
+        ASSERT_GT(cqe.res, 0);
+        ASSERT_TRUE(cqe.flags & IORING_CQE_F_BUFFER);
+        uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        got.assign(ring.buffer(bid), cqe.res);
+        ring.recycle_buffer(bid);
+    });
+    EXPECT_EQ(seen, 1u);
+    EXPECT_EQ(got, "hello");
+    close(sv[0]); close(sv[1]);
+}